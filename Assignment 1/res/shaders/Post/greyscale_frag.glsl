@@ -1,15 +1,10 @@
-#version 420
+//Greyscale snippet, gets fused into the post effect chain's shader
+uniform float u_GreyscaleIntensity = 1.0;
 
-layout(location = 0) in vec2 inUV;
-
-out vec4 frag_color;
-
-layout (binding = 0) uniform sampler2D s_screenTex;
-
-void main() 
+vec3 Greyscale(vec3 color)
 {
-	vec4 source = texture(s_screenTex, inUV);
+	//Rec. 709 luminance
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
 
-	frag_color.rgb = source.rgb;
-    frag_color.a = source.a;
-}
\ No newline at end of file
+	return mix(color, vec3(luminance), u_GreyscaleIntensity);
+}
@@ -0,0 +1,20 @@
+//Colour grading snippet, gets fused into the post effect chain's shader
+uniform sampler3D s_LUT;
+uniform float u_LUTSize = 64.0;
+//The range of input colours the cube covers
+uniform vec3 u_LUTDomainMin = vec3(0.0);
+uniform vec3 u_LUTDomainMax = vec3(1.0);
+uniform float u_LUTIntensity = 1.0;
+
+vec3 ColorGrade(vec3 color)
+{
+	//Where the colour sits in the cube's domain
+	vec3 coord = clamp((color - u_LUTDomainMin) / (u_LUTDomainMax - u_LUTDomainMin), 0.0, 1.0);
+
+	//Scale and offset so we sample between the first and last texel centers
+	float scale = (u_LUTSize - 1.0) / u_LUTSize;
+	float offset = 0.5 / u_LUTSize;
+	vec3 graded = texture(s_LUT, coord * scale + offset).rgb;
+
+	return mix(color, graded, u_LUTIntensity);
+}
@@ -1,15 +1,12 @@
-#version 420
+//Sepia snippet, gets fused into the post effect chain's shader
+uniform float u_SepiaIntensity = 1.0;
 
-layout(location = 0) in vec2 inUV;
-
-out vec4 frag_color;
-
-layout (binding = 0) uniform sampler2D s_screenTex;
-
-void main() 
+vec3 Sepia(vec3 color)
 {
-	vec4 source = texture(s_screenTex, inUV);
+	vec3 sepia;
+	sepia.r = dot(color, vec3(0.393, 0.769, 0.189));
+	sepia.g = dot(color, vec3(0.349, 0.686, 0.168));
+	sepia.b = dot(color, vec3(0.272, 0.534, 0.131));
 
-	frag_color.rgb = source.rgb;
-	frag_color.a = source.a;
-}
\ No newline at end of file
+	return mix(color, min(sepia, vec3(1.0)), u_SepiaIntensity);
+}
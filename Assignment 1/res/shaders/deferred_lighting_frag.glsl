@@ -0,0 +1,156 @@
+#version 430
+
+//Lights the G-buffer one pixel at a time, with the same lighting as frag_phong.glsl (point lights come from the same clusters)
+//*Position comes back from depth, so the G-buffer only needs albedo/specular and a packed normal
+
+layout(location = 0) in vec2 inUV;
+
+//Albedo in rgb, specular intensity in a
+uniform sampler2D s_GAlbedo;
+//Octahedral normal in rg, shininess in b
+uniform sampler2D s_GNormal;
+uniform sampler2D s_GDepth;
+
+//Only part of the G-buffer's textures might be drawn to
+uniform vec2 u_UVScale = vec2(1.0);
+uniform mat4 u_InverseViewProjection;
+
+uniform vec3  u_AmbientCol;
+uniform float u_AmbientStrength;
+
+uniform vec3  u_LightPos;
+uniform vec3  u_LightCol;
+uniform float u_AmbientLightStrength;
+uniform float u_SpecularLightStrength;
+uniform vec3  u_CamPos;
+
+uniform float u_LightAttenuationConstant;
+uniform float u_LightAttenuationLinear;
+uniform float u_LightAttenuationQuadratic;
+
+uniform float u_toonShading;
+
+struct PointLight {
+	//xyz is the position, w is the radius
+	vec4 PositionRadius;
+	vec4 Colour;
+};
+
+//Filled by LightBuffer
+layout(std430, binding = 1) readonly buffer PointLightBuffer {
+	PointLight u_PointLights[];
+};
+uniform int u_PointLightCount = 0;
+
+//Filled by LightClusters, each cluster is an offset and count into the light indices
+layout(std430, binding = 2) readonly buffer ClusterBuffer {
+	uvec2 u_Clusters[];
+};
+layout(std430, binding = 3) readonly buffer ClusterIndexBuffer {
+	uint u_ClusterLights[];
+};
+uniform ivec3 u_ClusterCount;
+uniform vec2  u_ClusterTileSize;
+uniform float u_ClusterDepthScale;
+uniform float u_ClusterDepthBias;
+uniform mat4  u_View;
+
+out vec4 frag_color;
+
+//Toon Shading
+const int bands = 5;
+const float scaling = 2.0/bands;
+
+//Unfolds a normal written by frag_phong.glsl's OctahedralEncode
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+//Adds up the point lights in the pixel's cluster, each fading out to nothing at its radius
+vec3 PointLighting(vec3 pos, vec3 N, vec3 camDir, float texSpec, float shininess)
+{
+	vec3 light = vec3(0.0);
+	if (u_PointLightCount == 0)
+		return light;
+
+	//Tiles on screen, exponential slices in depth
+	float depth = -(u_View * vec4(pos, 1.0)).z;
+	ivec3 cell = ivec3(ivec2(gl_FragCoord.xy / u_ClusterTileSize), int(floor(log(max(depth, 0.0001)) * u_ClusterDepthScale + u_ClusterDepthBias)));
+	cell = clamp(cell, ivec3(0), u_ClusterCount - 1);
+	uvec2 cluster = u_Clusters[cell.x + cell.y * u_ClusterCount.x + cell.z * u_ClusterCount.x * u_ClusterCount.y];
+
+	for (uint i = 0; i < cluster.y; i++)
+	{
+		PointLight pointLight = u_PointLights[u_ClusterLights[cluster.x + i]];
+		vec3 toLight = pointLight.PositionRadius.xyz - pos;
+		float radius = pointLight.PositionRadius.w;
+		float lightDist = length(toLight);
+		if (lightDist >= radius)
+			continue;
+
+		vec3 L = toLight / lightDist;
+		float window = clamp(1.0 - pow(lightDist / radius, 4.0), 0.0, 1.0);
+		float falloff = (window * window) / (lightDist * lightDist + 1.0);
+
+		float pointDif = max(dot(N, L), 0.0);
+		float pointSpec = pow(max(dot(camDir, reflect(-L, N)), 0.0), shininess);
+		light += (pointDif + u_SpecularLightStrength * texSpec * pointSpec) * pointLight.Colour.rgb * falloff;
+	}
+	return light;
+}
+
+void main()
+{
+	vec2 uv = inUV * u_UVScale;
+	float depth = texture(s_GDepth, uv).x;
+	//Nothing was drawn here, the sky gets drawn over it after
+	if (depth >= 1.0)
+		discard;
+
+	//Back to world space from the depth
+	vec4 clip = vec4(inUV * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec4 world = u_InverseViewProjection * clip;
+	vec3 pos = world.xyz / world.w;
+
+	vec4 albedoSpec = texture(s_GAlbedo, uv);
+	vec4 normalShininess = texture(s_GNormal, uv);
+	vec3 albedo = albedoSpec.rgb;
+	float texSpec = albedoSpec.a;
+	vec3 N = OctahedralDecode(normalShininess.xy * 2.0 - 1.0);
+	float shininess = exp2(normalShininess.z * 10.0);
+	vec3 camDir = normalize(u_CamPos - pos);
+
+	//The main light, the same as frag_phong.glsl
+	vec3 ambient = ((u_AmbientLightStrength * u_LightCol) + (u_AmbientCol * u_AmbientStrength));
+
+	vec3 lightDir = normalize(u_LightPos - pos);
+	float dif = max(dot(N, lightDir), 0.0);
+	vec3 diffuse = dif * u_LightCol;
+
+	if (u_toonShading == 0)
+	{
+		diffuse = floor(diffuse * bands) * scaling;
+	}
+
+	float dist = length(u_LightPos - pos);
+	float attenuation = 1.0f / (
+		u_LightAttenuationConstant +
+		u_LightAttenuationLinear * dist +
+		u_LightAttenuationQuadratic * dist * dist);
+
+	vec3 reflectDir = reflect(-lightDir, N);
+	float spec = pow(max(dot(camDir, reflectDir), 0.0), shininess);
+	vec3 specular = u_SpecularLightStrength * texSpec * spec * u_LightCol;
+
+	vec3 light = (ambient + diffuse + specular) * attenuation;
+
+	light += PointLighting(pos, N, camDir, texSpec, shininess);
+
+	frag_color = vec4(light * albedo, 1.0);
+}
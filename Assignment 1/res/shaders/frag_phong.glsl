@@ -1,4 +1,4 @@
-#version 410
+#version 430
 
 //Referenced from Richard Pazzi, Computer Graphics: Year 2 Sem 1, Lecture 5
 
@@ -27,14 +27,102 @@ uniform float u_LightAttenuationQuadratic;
 
 uniform float u_toonShading;
 
-out vec4 frag_color;
+struct PointLight {
+    //xyz is the position, w is the radius
+    vec4 PositionRadius;
+    vec4 Colour;
+};
+
+//Filled by LightBuffer
+layout(std430, binding = 1) readonly buffer PointLightBuffer {
+    PointLight u_PointLights[];
+};
+uniform int u_PointLightCount = 0;
+
+//Filled by LightClusters, each cluster is an offset and count into the light indices
+layout(std430, binding = 2) readonly buffer ClusterBuffer {
+    uvec2 u_Clusters[];
+};
+layout(std430, binding = 3) readonly buffer ClusterIndexBuffer {
+    uint u_ClusterLights[];
+};
+uniform ivec3 u_ClusterCount;
+uniform vec2  u_ClusterTileSize;
+uniform float u_ClusterDepthScale;
+uniform float u_ClusterDepthBias;
+uniform mat4  u_View;
+
+//Set when drawing into the G-buffer for deferred shading, the lighting happens in deferred_lighting_frag.glsl instead
+uniform int u_GBufferPass = 0;
+
+//Lit colour, or albedo and specular intensity in the G-buffer
+layout(location = 0) out vec4 frag_color;
+//Octahedral normal and shininess in the G-buffer
+layout(location = 1) out vec4 frag_normal;
 
 //Toon Shading
 const int bands = 5;
 const float scaling = 2.0/bands;
 
+//Folds a unit vector onto an octahedron and flattens it to 2 values in -1 to 1
+vec2 OctahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : folded;
+}
+
+//Adds up the point lights in the pixel's cluster, each fading out to nothing at its radius
+vec3 PointLighting(vec3 pos, vec3 N, vec3 camDir, float texSpec, float shininess)
+{
+    vec3 light = vec3(0.0);
+    if (u_PointLightCount == 0)
+        return light;
+
+    //Tiles on screen, exponential slices in depth
+    float depth = -(u_View * vec4(pos, 1.0)).z;
+    ivec3 cell = ivec3(ivec2(gl_FragCoord.xy / u_ClusterTileSize), int(floor(log(max(depth, 0.0001)) * u_ClusterDepthScale + u_ClusterDepthBias)));
+    cell = clamp(cell, ivec3(0), u_ClusterCount - 1);
+    uvec2 cluster = u_Clusters[cell.x + cell.y * u_ClusterCount.x + cell.z * u_ClusterCount.x * u_ClusterCount.y];
+
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        PointLight pointLight = u_PointLights[u_ClusterLights[cluster.x + i]];
+        vec3 toLight = pointLight.PositionRadius.xyz - pos;
+        float radius = pointLight.PositionRadius.w;
+        float lightDist = length(toLight);
+        if (lightDist >= radius)
+            continue;
+
+        vec3 L = toLight / lightDist;
+        float window = clamp(1.0 - pow(lightDist / radius, 4.0), 0.0, 1.0);
+        float falloff = (window * window) / (lightDist * lightDist + 1.0);
+
+        float pointDif = max(dot(N, L), 0.0);
+        float pointSpec = pow(max(dot(camDir, reflect(-L, N)), 0.0), shininess);
+        light += (pointDif + u_SpecularLightStrength * texSpec * pointSpec) * pointLight.Colour.rgb * falloff;
+    }
+    return light;
+}
+
+//Writes the surface to the G-buffer without lighting it
+void WriteGBuffer()
+{
+    vec4 textureColor = texture(s_Diffuse, inUV);
+    float texSpec = texture(s_Specular, inUV).x;
+
+    frag_color = vec4(inColor * textureColor.rgb, texSpec);
+    //Shininess gets stored as log2 over 0-1024 so the usual range keeps its precision
+    frag_normal = vec4(OctahedralEncode(normalize(inNormal)) * 0.5 + 0.5, clamp(log2(max(u_Shininess, 1.0)) / 10.0, 0.0, 1.0), 1.0);
+}
 
 void main() {
+    if (u_GBufferPass != 0)
+    {
+        WriteGBuffer();
+        return;
+    }
+
     // Lecture 5
     vec3 ambient = ((u_AmbientLightStrength * u_LightCol) + (u_AmbientCol * u_AmbientStrength));
 
@@ -71,7 +159,10 @@ void main() {
     vec4 textureColor1 = texture(s_Diffuse, inUV);
     vec4 textureColor = mix(textureColor1, textureColor1, u_TextureMix);
 
-    vec3 result = ((ambient + diffuse + specular)* attenuation) * inColor * textureColor.rgb;
+    vec3 pointLights = PointLighting(inPos, N, camDir, texSpec, u_Shininess);
+
+    vec3 result = (((ambient + diffuse + specular)* attenuation) + pointLights) * inColor * textureColor.rgb;
 
     frag_color = vec4(result, textureColor.a);
+    frag_normal = vec4(0.0);
 }
\ No newline at end of file
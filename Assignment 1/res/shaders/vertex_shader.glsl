@@ -1,32 +1,45 @@
-#version 410
+#version 430
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
+// Which transform to use, advances per instance (the base instance picks the first one)
+layout(location = 4) in uint inDrawID;
 
 layout(location = 0) out vec3 outPos;
 layout(location = 1) out vec3 outColor;
 layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
 
-uniform mat4 u_ModelViewProjection;
+uniform mat4 u_ViewProjection;
 uniform mat4 u_View;
-uniform mat4 u_Model;
-uniform mat3 u_NormalMatrix;
 uniform vec3 u_LightPos;
 
+struct InstanceData {
+	mat4 Model;
+	mat4 NormalMatrix;
+};
+
+// Either this frame's transform stream or an instance batch
+layout(std430, binding = 0) readonly buffer InstanceBuffer {
+	InstanceData u_Instances[];
+};
+
 
 void main() {
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+	mat4 model = u_Instances[inDrawID].Model;
+	mat3 normalMatrix = mat3(u_Instances[inDrawID].NormalMatrix);
+
+	gl_Position = u_ViewProjection * model * vec4(inPosition, 1.0);
 
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outPos = (u_Model * vec4(inPosition, 1.0)).xyz;
+	outPos = (model * vec4(inPosition, 1.0)).xyz;
 
 	// Normals
-	outNormal = u_NormalMatrix * inNormal;
+	outNormal = normalMatrix * inNormal;
 
 	// Pass our UV coords to the fragment shader
 	outUV = inUV;
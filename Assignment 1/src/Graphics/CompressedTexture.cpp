@@ -0,0 +1,94 @@
+#include "CompressedTexture.h"
+#include <cstring>
+#include <Logging.h>
+#include "Graphics/StreamedTexture.h"
+
+bool CompressedTexture::Parse(const MappedFile& file, GLenum& format, std::vector<Level>& levels)
+{
+	levels.clear();
+
+	if (!file.IsOpen() || file.GetSize() < sizeof(CTexHeader))
+		return false;
+
+	CTexHeader header;
+	memcpy(&header, file.GetData(), sizeof(CTexHeader));
+	if (memcmp(header.Magic, TextureBaker::MAGIC, 4) != 0 || header.Version != TextureBaker::VERSION || header.MipCount == 0)
+		return false;
+
+	format = GetGLFormat((BlockFormat)header.Format);
+	if (format == GL_NONE)
+		return false;
+
+	size_t tableEnd = sizeof(CTexHeader) + (size_t)header.MipCount * sizeof(CTexMip);
+	if (file.GetSize() < tableEnd)
+		return false;
+
+	for (uint32_t i = 0; i < header.MipCount; i++)
+	{
+		CTexMip mip;
+		memcpy(&mip, file.GetData() + sizeof(CTexHeader) + i * sizeof(CTexMip), sizeof(CTexMip));
+
+		//Don't trust a truncated file
+		if ((size_t)mip.Offset + mip.Size > file.GetSize())
+		{
+			levels.clear();
+			return false;
+		}
+
+		Level level;
+		level.Width = (GLsizei)mip.Width;
+		level.Height = (GLsizei)mip.Height;
+		level.Data = file.GetData() + mip.Offset;
+		level.Size = (GLsizei)mip.Size;
+		levels.push_back(level);
+	}
+
+	return true;
+}
+
+GLenum CompressedTexture::GetGLFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	default: return GL_NONE;
+	}
+}
+
+Texture2D::sptr CompressedTexture::LoadFromFile(const std::string& path)
+{
+	MappedFile file(path);
+	GLenum format;
+	std::vector<Level> levels;
+	if (!Parse(file, format, levels))
+	{
+		LOG_WARN("Failed to load compressed texture {}", path);
+		return nullptr;
+	}
+
+	GLuint handle;
+	glGenTextures(1, &handle);
+	glBindTexture(GL_TEXTURE_2D, handle);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, format, levels[i].Width, levels[i].Height, 0, levels[i].Size, levels[i].Data);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+	//Swap our texture in under a Texture2D so it works with materials like any other
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.Format = InternalFormat::RGBA8;
+	StreamedTexture::sptr texture = StreamedTexture::Create(desc);
+	texture->Adopt(handle, levels[0].Width, levels[0].Height, format);
+
+	return texture;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <glad/glad.h>
+#include <Texture2D.h>
+#include "Utilities/TextureBaker.h"
+#include "Utilities/MappedFile.h"
+
+//Not every glad build has the S3TC extension in it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//Loads the .ctex files TextureBaker makes
+class CompressedTexture abstract
+{
+public:
+	//One mip level's blocks inside a mapped .ctex
+	struct Level
+	{
+		GLsizei Width;
+		GLsizei Height;
+		const uint8_t* Data;
+		GLsizei Size;
+	};
+
+	//Checks a mapped .ctex and finds its mip levels
+	//*The levels point into the mapping, so it has to stay open while they're used
+	static bool Parse(const MappedFile& file, GLenum& format, std::vector<Level>& levels);
+
+	//The OpenGL format for a block format
+	static GLenum GetGLFormat(BlockFormat format);
+
+	//Loads a .ctex straight into a texture, every mip uploaded with glCompressedTexImage2D
+	static Texture2D::sptr LoadFromFile(const std::string& path);
+};
@@ -0,0 +1,301 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <Logging.h>
+#include "Utilities/Profiler.h"
+
+//How many bytes a pixel of a format takes (3 channel formats get padded to 4 by drivers)
+static size_t GetPixelBytes(GLenum format)
+{
+	switch (format)
+	{
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16F:
+	case GL_RGB16F:
+	case GL_RG32F:
+		return 8;
+	case GL_RGBA32F:
+	case GL_RGB32F:
+		return 16;
+	default:
+		//RGBA8, RGB8, RGB10_A2, R11F_G11F_B10F, RG16F, R32F and the 24/32 bit depth formats
+		return 4;
+	}
+}
+
+bool TargetDesc::SameLayout(const TargetDesc& other) const
+{
+	return Depth == other.Depth && ColorFormats == other.ColorFormats;
+}
+
+size_t TargetDesc::GetBytes() const
+{
+	size_t pixelBytes = Depth ? GetPixelBytes(GL_DEPTH_COMPONENT24) : 0;
+	for (GLenum format : ColorFormats)
+	{
+		pixelBytes += GetPixelBytes(format);
+	}
+	return pixelBytes * Width * Height;
+}
+
+FrameGraph::FrameGraph()
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+	Unload();
+}
+
+void FrameGraph::Unload()
+{
+	_targets.clear();
+	_passes.clear();
+	_pool.clear();
+	_allocatedBytes = 0;
+	_peakBytes = 0;
+	_unaliasedBytes = 0;
+}
+
+void FrameGraph::BeginFrame()
+{
+	_targets.clear();
+	_passes.clear();
+	_frame++;
+	Trim();
+}
+
+FrameGraph::Target FrameGraph::CreateTarget(const char* name, const TargetDesc& desc)
+{
+	VirtualTarget target;
+	target.Name = name;
+	target.Desc = desc;
+	target.Imported = nullptr;
+	target.Pooled = -1;
+	target.FirstPass = -1;
+	target.LastPass = -1;
+	target.FirstWrite = -1;
+	_targets.push_back(target);
+	return (Target)_targets.size() - 1;
+}
+
+FrameGraph::Target FrameGraph::Import(const char* name, Framebuffer& buffer)
+{
+	TargetDesc desc;
+	desc.Width = buffer._width;
+	desc.Height = buffer._height;
+	Target target = CreateTarget(name, desc);
+	_targets[target].Imported = &buffer;
+	return target;
+}
+
+int FrameGraph::AddPass(const char* name, const std::function<void()>& execute)
+{
+	_passes.push_back({ name, execute });
+	return (int)_passes.size() - 1;
+}
+
+void FrameGraph::Write(int pass, Target target)
+{
+	Use(pass, target);
+	VirtualTarget& virtualTarget = _targets[target];
+	if (virtualTarget.FirstWrite < 0 || pass < virtualTarget.FirstWrite)
+	{
+		virtualTarget.FirstWrite = pass;
+	}
+}
+
+void FrameGraph::Read(int pass, Target target)
+{
+	Use(pass, target);
+}
+
+void FrameGraph::Use(int pass, Target target)
+{
+	VirtualTarget& virtualTarget = _targets[target];
+	if (virtualTarget.FirstPass < 0 || pass < virtualTarget.FirstPass)
+	{
+		virtualTarget.FirstPass = pass;
+	}
+	virtualTarget.LastPass = std::max(virtualTarget.LastPass, pass);
+}
+
+void FrameGraph::Execute()
+{
+	//Hand out framebuffers in the order targets come alive, so each can take one whose last user is already done
+	std::vector<Target> order;
+	_unaliasedBytes = 0;
+	for (size_t i = 0; i < _targets.size(); i++)
+	{
+		const VirtualTarget& target = _targets[i];
+		if (target.Imported != nullptr || target.FirstPass < 0)
+			continue;
+		//Shared framebuffers hold whatever the last target left in them
+		if (target.FirstWrite != target.FirstPass && !_warnedUnwritten)
+		{
+			_warnedUnwritten = true;
+			LOG_WARN("Frame graph target {} is read by {} before anything writes it", target.Name, _passes[target.FirstPass].Name);
+		}
+		order.push_back((Target)i);
+		_unaliasedBytes += target.Desc.GetBytes();
+	}
+	std::stable_sort(order.begin(), order.end(), [&](Target a, Target b) {
+		return _targets[a].FirstPass < _targets[b].FirstPass;
+	});
+
+	for (PooledTarget& pooled : _pool)
+	{
+		pooled.BusyUntil = -1;
+	}
+	for (Target index : order)
+	{
+		VirtualTarget& target = _targets[index];
+		target.Pooled = Allocate(target);
+		PooledTarget& pooled = _pool[target.Pooled];
+		pooled.BusyUntil = target.LastPass;
+		pooled.LastUsedFrame = _frame;
+
+		//Only reallocates if it doesn't fit (see Framebuffer::Reshape)
+		Framebuffer& buffer = *pooled.Buffer;
+		if (buffer._width != target.Desc.Width || buffer._height != target.Desc.Height)
+		{
+			buffer.Reshape(target.Desc.Width, target.Desc.Height);
+		}
+	}
+
+	//What the framebuffers in use really take, and the most the targets needed at once
+	_allocatedBytes = 0;
+	for (const PooledTarget& pooled : _pool)
+	{
+		if (pooled.LastUsedFrame != _frame)
+			continue;
+		TargetDesc allocated = pooled.Layout;
+		allocated.Width = pooled.Buffer->GetAllocatedWidth();
+		allocated.Height = pooled.Buffer->GetAllocatedHeight();
+		_allocatedBytes += allocated.GetBytes();
+	}
+	_peakBytes = 0;
+	for (int pass = 0; pass < (int)_passes.size(); pass++)
+	{
+		size_t alive = 0;
+		for (Target index : order)
+		{
+			const VirtualTarget& target = _targets[index];
+			if (target.FirstPass <= pass && pass <= target.LastPass)
+			{
+				alive += target.Desc.GetBytes();
+			}
+		}
+		_peakBytes = std::max(_peakBytes, alive);
+	}
+
+	//Each pass gets timed on its own, on both the CPU and the GPU
+	for (const Pass& pass : _passes)
+	{
+		Profiler::BeginScope(pass.Name);
+		Profiler::BeginGPU(pass.Name);
+		pass.Execute();
+		Profiler::EndGPU();
+		Profiler::EndScope();
+	}
+}
+
+Framebuffer& FrameGraph::Get(Target target)
+{
+	const VirtualTarget& virtualTarget = _targets[target];
+	if (virtualTarget.Imported != nullptr)
+		return *virtualTarget.Imported;
+	return *_pool[virtualTarget.Pooled].Buffer;
+}
+
+const TargetDesc& FrameGraph::GetDesc(Target target) const
+{
+	return _targets[target].Desc;
+}
+
+int FrameGraph::Allocate(const VirtualTarget& target)
+{
+	const TargetDesc& desc = target.Desc;
+	int free = -1;
+	for (size_t i = 0; i < _pool.size(); i++)
+	{
+		const PooledTarget& pooled = _pool[i];
+		if (pooled.BusyUntil >= target.FirstPass || !pooled.Layout.SameLayout(desc))
+			continue;
+
+		//Best is one it fits in without Reshape wanting to shrink it
+		unsigned width = pooled.Buffer->GetAllocatedWidth();
+		unsigned height = pooled.Buffer->GetAllocatedHeight();
+		if (desc.Width <= width && desc.Height <= height &&
+			(float)desc.Width * desc.Height >= (float)width * height * Framebuffer::SHRINK_THRESHOLD)
+		{
+			return (int)i;
+		}
+		if (free < 0)
+		{
+			free = (int)i;
+		}
+	}
+	//Otherwise grow one that's free
+	if (free >= 0)
+		return free;
+
+	PooledTarget pooled;
+	pooled.Buffer = std::make_unique<Framebuffer>();
+	for (GLenum format : desc.ColorFormats)
+	{
+		pooled.Buffer->AddColorTarget(format);
+	}
+	if (desc.Depth)
+	{
+		pooled.Buffer->AddDepthTarget();
+	}
+	pooled.Buffer->Init(desc.Width, desc.Height);
+	pooled.Layout = desc;
+	pooled.BusyUntil = -1;
+	pooled.LastUsedFrame = _frame;
+	_pool.push_back(std::move(pooled));
+	return (int)_pool.size() - 1;
+}
+
+void FrameGraph::Trim()
+{
+	_pool.erase(std::remove_if(_pool.begin(), _pool.end(), [&](const PooledTarget& pooled) {
+		return _frame - pooled.LastUsedFrame > MAX_UNUSED_FRAMES;
+	}), _pool.end());
+}
+
+size_t FrameGraph::GetAllocatedBytes() const
+{
+	return _allocatedBytes;
+}
+
+size_t FrameGraph::GetPeakBytes() const
+{
+	return _peakBytes;
+}
+
+size_t FrameGraph::GetUnaliasedBytes() const
+{
+	return _unaliasedBytes;
+}
+
+int FrameGraph::GetTargetCount() const
+{
+	int count = 0;
+	for (const VirtualTarget& target : _targets)
+	{
+		if (target.Imported == nullptr)
+			count++;
+	}
+	return count;
+}
+
+int FrameGraph::GetPooledCount() const
+{
+	return (int)_pool.size();
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <glad/glad.h>
+#include "Graphics/Framebuffer.h"
+
+//What a transient render target looks like
+struct TargetDesc
+{
+	unsigned Width = 0;
+	unsigned Height = 0;
+	//A colour texture per format, in attachment order
+	std::vector<GLenum> ColorFormats;
+	bool Depth = false;
+
+	//Can a framebuffer made for one be used for the other (sizes can differ, Framebuffer reshapes in place)
+	bool SameLayout(const TargetDesc& other) const;
+	//Bytes a target this size takes
+	size_t GetBytes() const;
+};
+
+//Runs a frame's render passes, handing out render targets that only live for part of the frame
+//*Passes get declared up front along with the targets they write and read, then Execute runs them in order
+//*A target lives from the first pass that uses it to the last, and targets with the same layout whose lifetimes
+// don't overlap share one framebuffer (so a chain of post passes ends up bouncing between two)
+//*The framebuffers are pooled across frames, and get freed after going unused for MAX_UNUSED_FRAMES
+//*Targets that live outside the graph (like the scene's buffer) can be imported, they're never shared
+class FrameGraph
+{
+public:
+	//Handle to a target declared this frame
+	typedef int Target;
+	//Not a target (like a pass drawing to the back buffer)
+	static constexpr Target NONE = -1;
+
+	FrameGraph();
+	~FrameGraph();
+
+	//Frees every pooled framebuffer
+	void Unload();
+
+	//Forgets last frame's passes and targets (the pooled framebuffers stay)
+	void BeginFrame();
+
+	//Declares a target that only has to live while this frame's passes use it
+	Target CreateTarget(const char* name, const TargetDesc& desc);
+	//Lets passes use a framebuffer that lives outside the graph
+	Target Import(const char* name, Framebuffer& buffer);
+
+	//Declares a pass, and the targets it writes and reads (returns the pass's index)
+	int AddPass(const char* name, const std::function<void()>& execute);
+	void Write(int pass, Target target);
+	void Read(int pass, Target target);
+
+	//Works out lifetimes, gives every target a framebuffer and runs the passes in the order they were added
+	//*Every pass is a profiler scope and GPU pass named after it, so don't call it inside a GPU pass
+	void Execute();
+
+	//The framebuffer a target was given (only valid inside the passes that use it)
+	Framebuffer& Get(Target target);
+	//What a target was declared as (imported ones just have their size)
+	const TargetDesc& GetDesc(Target target) const;
+
+	//How much render target memory the last frame's targets took (with aliasing and headroom), the most that was
+	//alive at once, and how much they would take with a framebuffer each
+	size_t GetAllocatedBytes() const;
+	size_t GetPeakBytes() const;
+	size_t GetUnaliasedBytes() const;
+	//How many transient targets were declared last frame, and how many framebuffers are pooled
+	int GetTargetCount() const;
+	int GetPooledCount() const;
+
+	//Frames a pooled framebuffer can go unused before it's freed
+	static const int MAX_UNUSED_FRAMES = 120;
+private:
+	//A target declared this frame
+	struct VirtualTarget
+	{
+		const char* Name;
+		TargetDesc Desc;
+		//Imported framebuffers skip the pool
+		Framebuffer* Imported;
+		//Which pooled framebuffer it got
+		int Pooled;
+		//The first and last pass that use it (-1 if nothing does)
+		int FirstPass;
+		int LastPass;
+		//The first pass that writes it
+		int FirstWrite;
+	};
+
+	struct Pass
+	{
+		const char* Name;
+		std::function<void()> Execute;
+	};
+
+	//A framebuffer that targets get given
+	struct PooledTarget
+	{
+		std::unique_ptr<Framebuffer> Buffer;
+		TargetDesc Layout;
+		//The last pass this frame that uses it (-1 if it's free all frame)
+		int BusyUntil;
+		uint64_t LastUsedFrame;
+	};
+
+	//Marks a pass as using a target
+	void Use(int pass, Target target);
+	//Finds (or makes) a pooled framebuffer for a target
+	int Allocate(const VirtualTarget& target);
+	//Frees the framebuffers that haven't been used for a while
+	void Trim();
+
+	std::vector<VirtualTarget> _targets;
+	std::vector<Pass> _passes;
+	std::vector<PooledTarget> _pool;
+
+	uint64_t _frame = 0;
+	//Have we warned about a target being read before it's written (so it doesn't fill the log every frame)
+	bool _warnedUnwritten = false;
+	size_t _allocatedBytes = 0;
+	size_t _peakBytes = 0;
+	size_t _unaliasedBytes = 0;
+};
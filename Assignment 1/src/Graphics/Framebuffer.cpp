@@ -1,10 +1,12 @@
 #include "Framebuffer.h"
+#include <algorithm>
 
 GLuint Framebuffer::_fullscreenQuadVBO = 0;
 GLuint Framebuffer::_fullscreenQuadVAO = 0;
 
 int Framebuffer::_maxColorAttachments = 0;
 bool Framebuffer::_isInitFSQ = false;
+int Framebuffer::_allocationCount = 0;
 
 DepthTarget::~DepthTarget()
 {
@@ -26,7 +28,11 @@ ColorTarget::~ColorTarget()
 
 void ColorTarget::Unload()
 {
-	glDeleteTextures(_numAttachments, &_textures[0].GetHandle());
+	//Depth only framebuffers have no colour textures
+	if (_numAttachments)
+	{
+		glDeleteTextures(_numAttachments, &_textures[0].GetHandle());
+	}
 }
 
 Framebuffer::Framebuffer()
@@ -57,6 +63,14 @@ void Framebuffer::Init(unsigned width, unsigned height)
 
 void Framebuffer::Init()
 {
+	//The textures have to at least fit the size
+	if (_allocatedWidth < _width || _allocatedHeight < _height)
+	{
+		_allocatedWidth = _width;
+		_allocatedHeight = _height;
+	}
+	_allocationCount++;
+
 	//Generates the FBO
 	glGenFramebuffers(1, &_FBO);
 	//Bind it
@@ -72,7 +86,7 @@ void Framebuffer::Init()
 		//Binds the texture
 		glBindTexture(GL_TEXTURE_2D, _depth._texture.GetHandle());
 		//Sets the texture data
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, _width, _height);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, _allocatedWidth, _allocatedHeight);
 
 		//Set texture parameters
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_MIN_FILTER, _filter);
@@ -105,7 +119,7 @@ void Framebuffer::Init()
 			//Binds the texture
 			glBindTexture(GL_TEXTURE_2D, _color._textures[i].GetHandle());
 			//Sets the texture storage
-			glTexStorage2D(GL_TEXTURE_2D, 1, _color._formats[i], _width, _height);
+			glTexStorage2D(GL_TEXTURE_2D, 1, _color._formats[i], _allocatedWidth, _allocatedHeight);
 
 			//Set texture parameters
 			glTextureParameteri(_color._textures[i].GetHandle(), GL_TEXTURE_MIN_FILTER, _filter);
@@ -170,8 +184,22 @@ void Framebuffer::UnbindTexture(int textureSlot) const
 
 void Framebuffer::Reshape(unsigned width, unsigned height)
 {
+	//Nothing can be drawn at 0, so hang on to what we have until it comes back
+	if (width == 0 || height == 0)
+		return;
+
 	//Set size
 	SetSize(width, height);
+
+	//If it still fits, and isn't using too little of the textures, just draw into less of them
+	if (_isInit && width <= _allocatedWidth && height <= _allocatedHeight &&
+		(float)width * height >= (float)_allocatedWidth * _allocatedHeight * SHRINK_THRESHOLD)
+		return;
+
+	//Leave some room to grow into
+	_allocatedWidth = GetPaddedSize(width);
+	_allocatedHeight = GetPaddedSize(height);
+
 	//Unloads the framebuffer
 	Unload();
 	//Unload the depth target
@@ -194,6 +222,46 @@ void Framebuffer::SetViewport() const
 	glViewport(0, 0, _width, _height);
 }
 
+glm::vec2 Framebuffer::GetUVScale() const
+{
+	if (_allocatedWidth == 0 || _allocatedHeight == 0)
+		return glm::vec2(1.0f);
+	return glm::vec2((float)_width / _allocatedWidth, (float)_height / _allocatedHeight);
+}
+
+unsigned Framebuffer::GetAllocatedWidth() const
+{
+	return _allocatedWidth;
+}
+
+unsigned Framebuffer::GetAllocatedHeight() const
+{
+	return _allocatedHeight;
+}
+
+int Framebuffer::GetAllocationCount()
+{
+	return _allocationCount;
+}
+
+unsigned Framebuffer::GetPaddedSize(unsigned size)
+{
+	//Can't go past the biggest texture the driver allows
+	static GLint maxSize = 0;
+	if (maxSize == 0)
+	{
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	}
+
+	unsigned padded = (unsigned)(size * HEADROOM);
+	padded = (padded + SIZE_ALIGNMENT - 1) / SIZE_ALIGNMENT * SIZE_ALIGNMENT;
+	if (maxSize > 0)
+	{
+		padded = std::min(padded, std::max((unsigned)maxSize, size));
+	}
+	return padded;
+}
+
 void Framebuffer::Bind() const
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
@@ -231,6 +299,15 @@ void Framebuffer::DrawToBackbuffer()
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, GL_NONE);
 }
 
+void Framebuffer::CopyDepthTo(const Framebuffer& target) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _FBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target._FBO);
+
+	glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+}
+
 void Framebuffer::Clear()
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <GLM/glm.hpp>
 #include <Texture2D.h>
 #include <Shader.h>
 
@@ -29,6 +30,9 @@ struct ColorTarget
 	unsigned int _numAttachments = 0;
 };
 
+//The size a framebuffer is drawn at (_width, _height) can be smaller than its textures (_allocatedWidth, _allocatedHeight)
+//*Reshape only reallocates when the new size doesn't fit, or is well below what's allocated, and grows with headroom
+//*Everything gets drawn into the bottom left of the textures, so sample them with GetUVScale
 class Framebuffer
 {
 public:
@@ -60,12 +64,20 @@ public:
 	void UnbindTexture(int textureSlot) const;
 
 	//Reshapes the framebuffer
+	//*Keeps the textures when the new size fits in them, a size of 0 (a minimized window) is ignored
 	void Reshape(unsigned width, unsigned height);
 	//Sets the size of the framebuffer
 	void SetSize(unsigned width, unsigned height);
 
 	//Sets the viewport to fullscreen (using the size of framebuffer)
 	void SetViewport() const;
+	//What to multiply 0-1 UVs by to sample just the part of the textures being drawn to
+	glm::vec2 GetUVScale() const;
+	//The size of the textures (at least the size being drawn at)
+	unsigned GetAllocatedWidth() const;
+	unsigned GetAllocatedHeight() const;
+	//How many times any framebuffer has allocated its textures
+	static int GetAllocationCount();
 	
 	//Binds the framebuffer
 	void Bind() const;
@@ -77,6 +89,8 @@ public:
 
 	//Draws the contents of the framebuffer to the back buffer
 	void DrawToBackbuffer();
+	//Copies the depth of the part being drawn to into target's depth (both need a depth target)
+	void CopyDepthTo(const Framebuffer& target) const;
 
 	//Clears the framebuffer using our clear flag
 	void Clear();
@@ -93,7 +107,21 @@ public:
 	//Initial width and height is zero
 	unsigned int _width = 0;
 	unsigned int _height = 0;
+
+	//Reallocating grows the textures by this much, so a window being dragged bigger doesn't reallocate every frame
+	static constexpr float HEADROOM = 1.25f;
+	//Reallocate when the size covers less than this much of the allocated area
+	static constexpr float SHRINK_THRESHOLD = 0.25f;
+	//Allocated sizes get rounded up to a multiple of this
+	static const unsigned SIZE_ALIGNMENT = 64;
 protected:
+	//How big a reallocation should make a side to fit size in
+	static unsigned GetPaddedSize(unsigned size);
+
+	//The size of the textures
+	unsigned int _allocatedWidth = 0;
+	unsigned int _allocatedHeight = 0;
+
 	//OpenGL framebuffer handle
 	GLuint _FBO;
 	//Depth attachment (either one or none)
@@ -123,4 +151,6 @@ protected:
 	static int _maxColorAttachments;
 	//Is the fullscreen quad initialized
 	static bool _isInitFSQ;
+	//How many times the textures have been allocated
+	static int _allocationCount;
 };
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "FrustumCuller.h"
+#include <cfloat>
+#include "Graphics/MeshCache.h"
+#include "Utilities/SpatialIndex.h"
+#include "Utilities/Profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+void FrustumCuller::UpdateBounds(entt::registry& registry)
+{
+	PROFILE_SCOPE("Bounds");
+	_refitted.clear();
+	auto view = registry.view<RendererComponent, Transform>();
+	for (entt::entity entity : view)
+	{
+		RendererComponent& renderer = view.get<RendererComponent>(entity);
+		WorldBounds* bounds = registry.try_get<WorldBounds>(entity);
+		if (bounds != nullptr && bounds->Mesh == renderer.Mesh.get())
+			continue;
+
+		bool swapped = bounds != nullptr;
+		if (bounds == nullptr)
+		{
+			bounds = &registry.emplace<WorldBounds>(entity);
+		}
+
+		//Sphere around the mesh's box
+		bounds->Mesh = renderer.Mesh.get();
+		MeshBounds meshBounds;
+		if (renderer.Mesh != nullptr && MeshCache::GetBounds(renderer.Mesh, meshBounds))
+		{
+			bounds->LocalCentre = (meshBounds.Min + meshBounds.Max) * 0.5f;
+			bounds->LocalRadius = glm::length(meshBounds.Max - meshBounds.Min) * 0.5f;
+		}
+		else
+		{
+			bounds->LocalRadius = -1.0f;
+		}
+		//The spatial index only holds known bounds, so Cull has to find these itself
+		if (bounds->LocalRadius < 0.0f)
+		{
+			_unbounded.insert(entity);
+		}
+		else
+		{
+			_unbounded.erase(entity);
+		}
+		bounds->Refit(view.get<Transform>(entity).WorldTransform());
+		//Lets anything following the bounds (like the spatial index) know they changed
+		if (swapped)
+		{
+			TransformSystem::MarkDirty(registry, entity);
+			_refitted.push_back(entity);
+		}
+	}
+}
+
+void FrustumCuller::Cull(entt::registry& registry, const RenderQueue& queue, const glm::mat4& viewProjection, const SpatialIndex* index)
+{
+	PROFILE_SCOPE("Frustum Cull");
+	const std::vector<entt::entity>& entities = queue.GetSorted();
+	size_t count = entities.size();
+	_visible.assign(count, 1);
+	_visibleCount = (int)count;
+	_culledCount = 0;
+	if (!_enabled)
+		return;
+
+	ExtractPlanes(viewProjection, _planes);
+
+	//Work out which draw indices need the sphere test
+	_candidates.clear();
+	if (index != nullptr)
+	{
+		//Everything the tree doesn't hand back is in a subtree that's off screen, so it never gets looked at
+		_visible.assign(count, 0);
+		{
+			PROFILE_SCOPE("Tree");
+			_treeResults.clear();
+			index->QueryFrustum(viewProjection, _treeResults);
+		}
+		for (entt::entity entity : _treeResults)
+		{
+			int drawIndex = queue.GetDrawIndex(entity);
+			if (drawIndex >= 0)
+			{
+				_candidates.push_back((uint32_t)drawIndex);
+			}
+		}
+
+		//The tree can't hold anything without bounds, those always draw
+		for (auto it = _unbounded.begin(); it != _unbounded.end();)
+		{
+			if (!registry.valid(*it))
+			{
+				it = _unbounded.erase(it);
+				continue;
+			}
+			int drawIndex = queue.GetDrawIndex(*it);
+			if (drawIndex >= 0)
+			{
+				_candidates.push_back((uint32_t)drawIndex);
+			}
+			++it;
+		}
+	}
+	else
+	{
+		_candidates.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			_candidates[i] = (uint32_t)i;
+		}
+	}
+	TestCandidates(registry, entities);
+
+	_visibleCount = 0;
+	for (uint32_t drawIndex : _candidates)
+	{
+		_visibleCount += _visible[drawIndex];
+	}
+	_culledCount = (int)count - _visibleCount;
+}
+
+void FrustumCuller::TestCandidates(entt::registry& registry, const std::vector<entt::entity>& entities)
+{
+	//Gather the spheres, anything without bounds gets one nothing can be outside of
+	//*Things LOD hid get one everything is outside of
+	size_t count = _candidates.size();
+	size_t padded = (count + 3) & ~(size_t)3;
+	_x.assign(padded, 0.0f);
+	_y.assign(padded, 0.0f);
+	_z.assign(padded, 0.0f);
+	_radius.assign(padded, FLT_MAX);
+	for (size_t i = 0; i < count; i++)
+	{
+		entt::entity entity = entities[_candidates[i]];
+		if (registry.has<LODHidden>(entity))
+		{
+			_radius[i] = -FLT_MAX;
+			continue;
+		}
+
+		const WorldBounds* bounds = registry.try_get<WorldBounds>(entity);
+		if (bounds == nullptr || bounds->Radius < 0.0f)
+			continue;
+
+		_x[i] = bounds->Centre.x;
+		_y[i] = bounds->Centre.y;
+		_z[i] = bounds->Centre.z;
+		_radius[i] = bounds->Radius;
+	}
+
+#ifdef FRUSTUM_USE_SSE
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&_x[i]);
+		__m128 y = _mm_loadu_ps(&_y[i]);
+		__m128 z = _mm_loadu_ps(&_z[i]);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&_radius[i]));
+
+		//A sphere is out if it's further than its radius behind any plane
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(_planes[p].x)), _mm_mul_ps(y, _mm_set1_ps(_planes[p].y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(_planes[p].z)), _mm_set1_ps(_planes[p].w)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < 4 && i + lane < count; lane++)
+		{
+			_visible[_candidates[i + lane]] = (uint8_t)((mask >> lane) & 1);
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		_visible[_candidates[i]] = TestSphere(glm::vec3(_x[i], _y[i], _z[i]), _radius[i]) ? 1 : 0;
+	}
+#endif
+}
+
+bool FrustumCuller::IsVisible(size_t index) const
+{
+	return index >= _visible.size() || _visible[index] != 0;
+}
+
+bool FrustumCuller::TestSphere(const glm::vec3& centre, float radius) const
+{
+	if (!_enabled)
+		return true;
+
+	for (int p = 0; p < 6; p++)
+	{
+		if (glm::dot(glm::vec3(_planes[p]), centre) + _planes[p].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+void FrustumCuller::SetEnabled(bool enabled)
+{
+	_enabled = enabled;
+}
+
+bool FrustumCuller::GetEnabled() const
+{
+	return _enabled;
+}
+
+int FrustumCuller::GetVisibleCount() const
+{
+	return _visibleCount;
+}
+
+int FrustumCuller::GetCulledCount() const
+{
+	return _culledCount;
+}
+
+const std::vector<entt::entity>& FrustumCuller::GetRefitted() const
+{
+	return _refitted;
+}
+
+void FrustumCuller::ExtractPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+{
+	//Gribb/Hartmann, each plane is the last row plus or minus one of the others (glm is column major)
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[3] + rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	//Normalized so distances come out in world units
+	for (int p = 0; p < 6; p++)
+	{
+		planes[p] = planes[p] * (1.0f / glm::length(glm::vec3(planes[p])));
+	}
+}
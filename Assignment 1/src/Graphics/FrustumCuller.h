@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <RendererComponent.h>
+#include "Utilities/TransformSystem.h"
+#include "Graphics/LODChain.h"
+#include "Graphics/RenderQueue.h"
+
+class SpatialIndex;
+
+//Throws out renderers whose bounding sphere is completely outside the camera's view
+//*Bounds come from MeshCache, and TransformSystem keeps the world spheres up to date
+//*Spheres are copied into separate x/y/z/radius arrays so 4 get tested against a plane at once
+//*Meshes that didn't come through MeshCache have no bounds and always draw, anything LOD hid never does
+//*Given a SpatialIndex, its tree throws out whole subtrees first, and only what it hands back (plus anything without bounds) gets the sphere test
+class FrustumCuller
+{
+public:
+	//Gives every renderer a WorldBounds, and refits the ones that swapped meshes
+	//*Call after TransformSystem::Update, so new renderers fit to this frame's matrices
+	void UpdateBounds(entt::registry& registry);
+
+	//Tests the queue's renderers (in the order they'll be drawn) against the frustum of a view projection matrix
+	//*index has to be up to date with the bounds (SpatialIndex::Update), without one every renderer gets tested
+	void Cull(entt::registry& registry, const RenderQueue& queue, const glm::mat4& viewProjection, const SpatialIndex* index = nullptr);
+	//Whether the entity at index in the queue's sorted order is on screen
+	bool IsVisible(size_t index) const;
+	//Tests a single sphere against the frustum from the last Cull
+	bool TestSphere(const glm::vec3& centre, float radius) const;
+
+	//Turning culling off draws everything
+	void SetEnabled(bool enabled);
+	bool GetEnabled() const;
+
+	//How many entities passed and failed the last Cull
+	int GetVisibleCount() const;
+	int GetCulledCount() const;
+	//The renderers UpdateBounds refit for a new mesh this frame
+	const std::vector<entt::entity>& GetRefitted() const;
+
+	//Pulls the 6 frustum planes out of a view projection matrix (normals point inwards)
+	static void ExtractPlanes(const glm::mat4& viewProjection, glm::vec4* planes);
+private:
+	//Runs the sphere test on the candidates' bounds, writing to their slots in _visible
+	void TestCandidates(entt::registry& registry, const std::vector<entt::entity>& entities);
+
+	//Left, right, bottom, top, near, far as (normal, distance)
+	glm::vec4 _planes[6];
+
+	//The candidates' spheres, one array per component (padded to a multiple of 4)
+	std::vector<float> _x;
+	std::vector<float> _y;
+	std::vector<float> _z;
+	std::vector<float> _radius;
+	//Whether each entity passed
+	std::vector<uint8_t> _visible;
+	//The draw indices that need the sphere test, and what the tree handed back
+	std::vector<uint32_t> _candidates;
+	std::vector<entt::entity> _treeResults;
+	//Renderers whose mesh has no bounds (the tree can't hold them)
+	std::unordered_set<entt::entity> _unbounded;
+	std::vector<entt::entity> _refitted;
+
+	bool _enabled = true;
+	int _visibleCount = 0;
+	int _culledCount = 0;
+};
@@ -0,0 +1,226 @@
+#include "InstanceBatch.h"
+#include <cfloat>
+#include "Graphics/TransformStream.h"
+#include "Graphics/MeshCache.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/BackendHandler.h"
+
+InstanceBatch::sptr InstanceBatch::Create(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material)
+{
+	return std::make_shared<InstanceBatch>(mesh, material);
+}
+
+InstanceBatch::InstanceBatch(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material)
+	: _mesh(mesh), _material(material)
+{
+}
+
+InstanceBatch::~InstanceBatch()
+{
+	Unload();
+}
+
+void InstanceBatch::Unload()
+{
+	//Deletes the instance buffer
+	if (_instanceBuffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_instanceBuffer);
+		_instanceBuffer = GL_NONE;
+	}
+	_instanceCount = 0;
+}
+
+void InstanceBatch::SetInstances(const std::vector<glm::mat4>& transforms)
+{
+	//Builds the per instance data
+	_instances.resize(transforms.size());
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		_instances[i].Model = transforms[i];
+		_instances[i].NormalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(transforms[i]))));
+	}
+
+	//Each instance's sphere, then a box around all of them, then a sphere around that
+	_boundsRadius = -1.0f;
+	_spheres.clear();
+	MeshBounds meshBounds;
+	if (!transforms.empty() && MeshCache::GetBounds(_mesh, meshBounds))
+	{
+		WorldBounds bounds;
+		bounds.LocalCentre = (meshBounds.Min + meshBounds.Max) * 0.5f;
+		bounds.LocalRadius = glm::length(meshBounds.Max - meshBounds.Min) * 0.5f;
+
+		_spheres.resize(transforms.size());
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			bounds.Refit(transforms[i]);
+			_spheres[i] = glm::vec4(bounds.Centre, bounds.Radius);
+			min = glm::min(min, bounds.Centre - glm::vec3(bounds.Radius));
+			max = glm::max(max, bounds.Centre + glm::vec3(bounds.Radius));
+		}
+		_boundsCentre = (min + max) * 0.5f;
+		_boundsRadius = glm::length(max - min) * 0.5f;
+	}
+
+	//Levels get picked again on the next LOD update
+	_levels.assign(_instances.size(), -2);
+	_ranges.clear();
+
+	Upload(_instances);
+}
+
+void InstanceBatch::SetLODChain(const LODChain::sptr& chain)
+{
+	_lodChain = chain;
+	_levels.assign(_instances.size(), -2);
+	_ranges.clear();
+	//Back to everything at full detail until the next update
+	Upload(_instances);
+}
+
+void InstanceBatch::UpdateLOD(const glm::vec3& cameraPos, const glm::mat4& projection)
+{
+	//Needs the instance spheres to know how big they are
+	if (_lodChain == nullptr || _spheres.size() != _instances.size())
+		return;
+
+	bool changed = _ranges.empty();
+	for (size_t i = 0; i < _instances.size(); i++)
+	{
+		float screenSize = LODChain::GetScreenSize(glm::vec3(_spheres[i]), _spheres[i].w, cameraPos, projection);
+		int level = _lodChain->SelectLevel(screenSize, _levels[i]);
+		if (level != _levels[i])
+		{
+			_levels[i] = (int8_t)level;
+			changed = true;
+		}
+	}
+	if (!changed)
+		return;
+
+	//Regroup the instances by level, each level starting where the buffer can be bound from
+	static GLsizei alignment = 0;
+	if (alignment == 0)
+	{
+		GLint bytes = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &bytes);
+		alignment = glm::max((GLsizei)((bytes + sizeof(InstanceData) - 1) / sizeof(InstanceData)), 1);
+	}
+
+	int levelCount = _lodChain->GetLevelCount();
+	std::vector<GLsizei> counts(levelCount, 0);
+	for (int8_t level : _levels)
+	{
+		if (level >= 0)
+			counts[level]++;
+	}
+
+	_ranges.assign(levelCount, Range());
+	GLsizei size = 0;
+	for (int level = 0; level < levelCount; level++)
+	{
+		size = (size + alignment - 1) / alignment * alignment;
+		_ranges[level].First = size;
+		size += counts[level];
+	}
+
+	//Gaps between levels are never drawn
+	std::vector<InstanceData> grouped(size);
+	std::vector<GLsizei> next(levelCount);
+	for (int level = 0; level < levelCount; level++)
+	{
+		next[level] = _ranges[level].First;
+	}
+	for (size_t i = 0; i < _instances.size(); i++)
+	{
+		if (_levels[i] >= 0)
+		{
+			grouped[next[_levels[i]]++] = _instances[i];
+		}
+	}
+	for (int level = 0; level < levelCount; level++)
+	{
+		_ranges[level].Count = counts[level];
+	}
+
+	Upload(grouped);
+}
+
+bool InstanceBatch::GetBounds(glm::vec3& centre, float& radius) const
+{
+	if (_boundsRadius < 0.0f)
+		return false;
+
+	centre = _boundsCentre;
+	radius = _boundsRadius;
+	return true;
+}
+
+void InstanceBatch::Render() const
+{
+	if (_ranges.empty())
+	{
+		RenderRange(_mesh, 0, _instanceCount);
+	}
+	else
+	{
+		//One go per level, with that level's mesh
+		for (int level = 0; level < (int)_ranges.size(); level++)
+		{
+			RenderRange(_lodChain->GetMesh(level), _ranges[level].First, _ranges[level].Count);
+		}
+	}
+
+	//Gives the transform stream its binding back
+	TransformStream::Bind();
+}
+
+int InstanceBatch::GetDrawnCount() const
+{
+	if (_ranges.empty())
+		return _instanceCount;
+
+	GLsizei drawn = 0;
+	for (const Range& range : _ranges)
+	{
+		drawn += range.Count;
+	}
+	return drawn;
+}
+
+void InstanceBatch::Upload(const std::vector<InstanceData>& instances)
+{
+	//Generates the buffer the first time around
+	if (_instanceBuffer == GL_NONE)
+	{
+		glGenBuffers(1, &_instanceBuffer);
+	}
+
+	//Uploads all the instances in one go
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+
+	_instanceCount = (GLsizei)_instances.size();
+}
+
+void InstanceBatch::RenderRange(const VertexArrayObject::sptr& mesh, GLsizei first, GLsizei count) const
+{
+	//Nothing to draw
+	if (count == 0)
+		return;
+
+	//Each instance reads its draw ID, so we can only draw as many as there are IDs at once
+	GLsizei maxPerDraw = (GLsizei)TransformStream::GetMaxDraws();
+	for (GLsizei offset = 0; offset < count; offset += maxPerDraw)
+	{
+		GLsizei drawCount = glm::min(maxPerDraw, count - offset);
+
+		//Points the shader at our instances instead of the transform stream
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, _instanceBuffer, (first + offset) * sizeof(InstanceData), drawCount * sizeof(InstanceData));
+		BackendHandler::RenderVAOInstanced(mesh, drawCount);
+	}
+}
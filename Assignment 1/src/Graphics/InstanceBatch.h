@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+#include <ShaderMaterial.h>
+#include "Graphics/LODChain.h"
+
+//Per instance data read by the vertex shader (std430 layout)
+struct InstanceData
+{
+	glm::mat4 Model;
+	//Stored as a mat4 so it lines up with std430 (only the 3x3 is used)
+	glm::mat4 NormalMatrix;
+};
+
+class InstanceBatch
+{
+public:
+	typedef std::shared_ptr<InstanceBatch> sptr;
+
+	//Creates an instance batch for a mesh and material
+	static sptr Create(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material);
+
+	InstanceBatch(const VertexArrayObject::sptr& mesh, const ShaderMaterial::sptr& material);
+	~InstanceBatch();
+
+	//Unloads the instance buffer
+	void Unload();
+
+	//Sets the model matrices of every instance
+	//*Computes the normal matrices and uploads both to the instance buffer
+	void SetInstances(const std::vector<glm::mat4>& transforms);
+
+	//Draws each instance with a level of a LOD chain instead of the batch's mesh (nullptr goes back to the mesh)
+	//*Needs the mesh to come through MeshCache, so the instances have bounds
+	void SetLODChain(const LODChain::sptr& chain);
+	//Picks each instance's level, and regroups the buffer by level if any of them switched
+	void UpdateLOD(const glm::vec3& cameraPos, const glm::mat4& projection);
+
+	//A sphere around every instance, for culling the whole batch
+	//*Returns false if the mesh's bounds aren't known (didn't come through MeshCache)
+	bool GetBounds(glm::vec3& centre, float& radius) const;
+
+	//Draws every instance with one instanced draw call
+	//*Expects the material's shader and material to already be applied
+	//*Splits into more draws if there are more instances than draw IDs
+	void Render() const;
+
+	const VertexArrayObject::sptr& GetMesh() const { return _mesh; }
+	const ShaderMaterial::sptr& GetMaterial() const { return _material; }
+	GLsizei GetInstanceCount() const { return _instanceCount; }
+	//How many instances aren't hidden by LOD
+	int GetDrawnCount() const;
+
+	//The shader storage binding the instance buffer gets bound to
+	static const GLuint INSTANCE_BINDING = 0;
+protected:
+	//Uploads instance data to the buffer
+	void Upload(const std::vector<InstanceData>& instances);
+	//Draws count instances starting at first in the buffer
+	void RenderRange(const VertexArrayObject::sptr& mesh, GLsizei first, GLsizei count) const;
+
+	//The mesh every instance uses
+	VertexArrayObject::sptr _mesh;
+	//The material every instance uses
+	ShaderMaterial::sptr _material;
+
+	//OpenGL shader storage buffer handle
+	GLuint _instanceBuffer = GL_NONE;
+	//How many instances are in the buffer
+	GLsizei _instanceCount = 0;
+
+	//The instances as they were set, and their spheres (centre, radius), empty if the mesh has no bounds
+	std::vector<InstanceData> _instances;
+	std::vector<glm::vec4> _spheres;
+
+	//LOD, the level each instance is at and where each level's instances are in the buffer
+	struct Range
+	{
+		GLsizei First = 0;
+		GLsizei Count = 0;
+	};
+	LODChain::sptr _lodChain;
+	std::vector<int8_t> _levels;
+	std::vector<Range> _ranges;
+
+	//Sphere around every instance (negative radius if we don't know it)
+	glm::vec3 _boundsCentre = glm::vec3(0.0f);
+	float _boundsRadius = -1.0f;
+};
@@ -0,0 +1,133 @@
+#include "LODChain.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/JobSystem.h"
+#include "Utilities/Profiler.h"
+
+std::vector<entt::entity> LODSystem::_entities;
+std::vector<int> LODSystem::_levels;
+int LODSystem::_lastSwitchCount = 0;
+int LODSystem::_hiddenCount = 0;
+
+LODChain::sptr LODChain::Create(const std::vector<VertexArrayObject::sptr>& meshes, const std::vector<float>& screenSizes)
+{
+	return std::make_shared<LODChain>(meshes, screenSizes);
+}
+
+LODChain::LODChain(const std::vector<VertexArrayObject::sptr>& meshes, const std::vector<float>& screenSizes)
+	: _meshes(meshes), _screenSizes(screenSizes)
+{
+	//Levels without a size never get too small
+	_screenSizes.resize(_meshes.size(), 0.0f);
+}
+
+int LODChain::SelectLevel(float screenSize, int current) const
+{
+	int count = (int)_meshes.size();
+
+	//Nothing to stick to yet
+	if (current == -2)
+	{
+		int level = 0;
+		while (level < count && screenSize < _screenSizes[level])
+		{
+			level++;
+		}
+		return level == count ? -1 : level;
+	}
+
+	//Hidden is one past the coarsest level
+	int level = current < 0 ? count : current;
+	//Finer while it's well past where the finer level stops
+	while (level > 0 && screenSize > _screenSizes[level - 1] * (1.0f + HYSTERESIS))
+	{
+		level--;
+	}
+	//Coarser while it's well short of where this level stops
+	while (level < count && screenSize < _screenSizes[level] * (1.0f - HYSTERESIS))
+	{
+		level++;
+	}
+	return level == count ? -1 : level;
+}
+
+float LODChain::GetScreenSize(const glm::vec3& centre, float radius, const glm::vec3& cameraPos, const glm::mat4& projection)
+{
+	//Orthographic cameras don't shrink things with distance
+	if (projection[3][3] == 1.0f)
+		return radius * projection[1][1];
+
+	float distance = glm::length(centre - cameraPos);
+	//Inside the sphere covers the whole screen
+	if (distance <= radius)
+		return 1.0f;
+	return radius * projection[1][1] / distance;
+}
+
+void LODSystem::Update(entt::registry& registry, const glm::vec3& cameraPos, const glm::mat4& projection)
+{
+	PROFILE_SCOPE("LOD");
+	auto view = registry.view<LODGroup, WorldBounds, RendererComponent>();
+	_entities.clear();
+	for (entt::entity entity : view)
+	{
+		_entities.push_back(entity);
+	}
+	_levels.resize(_entities.size());
+
+	//Picking only reads, so it can go wide
+	auto pick = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			const LODGroup& group = view.get<LODGroup>(_entities[i]);
+			const WorldBounds& bounds = view.get<WorldBounds>(_entities[i]);
+			//No known size means it keeps full detail
+			float screenSize = bounds.Radius < 0.0f ? 1.0f : LODChain::GetScreenSize(bounds.Centre, bounds.Radius, cameraPos, projection);
+			_levels[i] = group.Chain != nullptr ? group.Chain->SelectLevel(screenSize, group.Level) : group.Level;
+		}
+	};
+	if (_entities.size() >= PARALLEL_THRESHOLD)
+	{
+		JobSystem::ParallelFor(_entities.size(), 256, pick);
+	}
+	else
+	{
+		pick(0, _entities.size());
+	}
+
+	//Swapping touches the registry, so that stays on this thread
+	_lastSwitchCount = 0;
+	for (size_t i = 0; i < _entities.size(); i++)
+	{
+		LODGroup& group = view.get<LODGroup>(_entities[i]);
+		int level = _levels[i];
+		if (level == group.Level)
+			continue;
+
+		if (level == -1)
+		{
+			registry.emplace_or_replace<LODHidden>(_entities[i]);
+		}
+		else
+		{
+			if (group.Level == -1)
+			{
+				registry.remove_if_exists<LODHidden>(_entities[i]);
+			}
+			view.get<RendererComponent>(_entities[i]).Mesh = group.Chain->GetMesh(level);
+		}
+		group.Level = level;
+		_lastSwitchCount++;
+	}
+
+	_hiddenCount = (int)registry.view<LODHidden>().size();
+}
+
+int LODSystem::GetLastSwitchCount()
+{
+	return _lastSwitchCount;
+}
+
+int LODSystem::GetHiddenCount()
+{
+	return _hiddenCount;
+}
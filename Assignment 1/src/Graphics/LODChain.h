@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+#include <RendererComponent.h>
+
+//A mesh at a few levels of detail, and how big on screen each one is used down to
+//*Screen size is how much of the screen's height the bounding sphere covers (1 fills it)
+//*Levels only switch once the size gets a margin past the switch point, so something sitting right on it doesn't flicker
+class LODChain
+{
+public:
+	typedef std::shared_ptr<LODChain> sptr;
+
+	//meshes[i] gets used down to screenSizes[i], anything smaller than the last one isn't drawn (0 draws it at any size)
+	static sptr Create(const std::vector<VertexArrayObject::sptr>& meshes, const std::vector<float>& screenSizes);
+
+	LODChain(const std::vector<VertexArrayObject::sptr>& meshes, const std::vector<float>& screenSizes);
+
+	//Picks the level for a screen size, given the level it's at now
+	//*Returns -1 when it's too small to draw, current is -2 if it doesn't have a level yet
+	int SelectLevel(float screenSize, int current) const;
+
+	const VertexArrayObject::sptr& GetMesh(int level) const { return _meshes[level]; }
+	int GetLevelCount() const { return (int)_meshes.size(); }
+
+	//How much of the screen's height a sphere covers
+	static float GetScreenSize(const glm::vec3& centre, float radius, const glm::vec3& cameraPos, const glm::mat4& projection);
+
+	//How far past a switch point the size has to get before it switches (as a fraction of the switch point)
+	static constexpr float HYSTERESIS = 0.15f;
+private:
+	std::vector<VertexArrayObject::sptr> _meshes;
+	std::vector<float> _screenSizes;
+};
+
+//Swaps an entity's mesh through a LOD chain
+struct LODGroup
+{
+	LODChain::sptr Chain;
+	//-2 until it's been picked, -1 when it's too small to draw
+	int Level = -2;
+};
+
+//Tag for entities too small on screen to draw (the frustum culler skips them)
+struct LODHidden {};
+
+//Picks the level of every LODGroup from the camera each frame
+class LODSystem abstract
+{
+public:
+	//Picks levels and swaps meshes
+	//*Call before FrustumCuller::UpdateBounds, so swapped meshes get their bounds checked the same frame
+	static void Update(entt::registry& registry, const glm::vec3& cameraPos, const glm::mat4& projection);
+
+	//How many entities switched level last update, and how many are hidden
+	static int GetLastSwitchCount();
+	static int GetHiddenCount();
+private:
+	//The groups being updated, and the levels they picked
+	static std::vector<entt::entity> _entities;
+	static std::vector<int> _levels;
+	static int _lastSwitchCount;
+	static int _hiddenCount;
+
+	//How many groups there need to be before picking goes wide
+	static const size_t PARALLEL_THRESHOLD = 1024;
+};
@@ -1,5 +1,30 @@
 #include "LUT.h"
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include "glm/gtc/packing.hpp"
+#include "Utilities/MappedFile.h"
+#include "Utilities/Util.h"
 #pragma warning(disable : 4996)
+
+//Sits at the start of a LUT cache, followed by size^3 RGB half floats
+struct LUTCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t Size;
+	uint32_t Format;
+	//The input range from the .cube
+	glm::vec3 DomainMin;
+	glm::vec3 DomainMax;
+	//The .cube the cache was built from, so editing it rebuilds the cache
+	int64_t SourceTime;
+	uint64_t SourceSize;
+};
+
+static const char LUT_CACHE_MAGIC[4] = { 'L', 'U', 'T', '3' };
+static const uint32_t LUT_CACHE_VERSION = 2;
+
 LUT3D::LUT3D()
 {
 }
@@ -12,36 +37,192 @@ LUT3D::LUT3D(std::string path)
 void LUT3D::loadFromFile(std::string path)
 {
 	std::string filePath = "./Resources/cube/" + path;
-	std::ifstream LUTstream;
-	LUTstream.open(filePath);
+	std::string cachePath = std::filesystem::path(filePath).replace_extension(".lutcache").string();
+
+	//Fast path, straight from the cache into the texture
+	if (loadFromCache(cachePath, filePath))
+		return;
+
+	std::vector<uint16_t> halfData;
+	if (!parseCube(filePath, halfData))
+	{
+		printf("LUT %s couldn't be loaded\n", filePath.c_str());
+		return;
+	}
+
+	writeCache(cachePath, filePath, halfData);
+	upload(halfData.data());
+}
+
+bool LUT3D::loadFromCache(const std::string& cachePath, const std::string& sourcePath)
+{
+	MappedFile cache(cachePath);
+	if (!cache.IsOpen() || cache.GetSize() < sizeof(LUTCacheHeader))
+		return false;
+
+	LUTCacheHeader header;
+	memcpy(&header, cache.GetData(), sizeof(LUTCacheHeader));
+
+	if (memcmp(header.Magic, LUT_CACHE_MAGIC, 4) != 0 || header.Version != LUT_CACHE_VERSION || header.Format != GL_RGB16F)
+		return false;
+
+	//Rebuild if the .cube changed (a cache without its .cube is still fine to use)
+	int64_t sourceTime;
+	uint64_t sourceSize;
+	if (Util::GetFileStamp(sourcePath, sourceTime, sourceSize) && (sourceTime != header.SourceTime || sourceSize != header.SourceSize))
+		return false;
+
+	//Check the size before using it, a corrupt one could overflow the byte count
+	if (header.Size < (uint32_t)MIN_SIZE || header.Size > (uint32_t)MAX_SIZE)
+		return false;
+	size_t dataSize = (size_t)header.Size * header.Size * header.Size * 3 * sizeof(uint16_t);
+	if (cache.GetSize() < sizeof(LUTCacheHeader) + dataSize)
+		return false;
+
+	_size = (int)header.Size;
+	_domainMin = header.DomainMin;
+	_domainMax = header.DomainMax;
+	upload(cache.GetData() + sizeof(LUTCacheHeader));
+	return true;
+}
+
+bool LUT3D::parseCube(const std::string& sourcePath, std::vector<uint16_t>& halfData)
+{
+	std::ifstream LUTstream(sourcePath, std::ios::binary);
+	if (!LUTstream)
+		return false;
+
+	//Read it all in one go instead of line by line
+	std::string contents((std::istreambuf_iterator<char>(LUTstream)), std::istreambuf_iterator<char>());
+
+	int size = 0;
+	size_t entries = 0;
+	size_t maxEntries = 0;
+	glm::vec3 domainMin = glm::vec3(0.0f);
+	glm::vec3 domainMax = glm::vec3(1.0f);
+
+	const char* cursor = contents.c_str();
+	const char* end = cursor + contents.size();
+	while (cursor < end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+			cursor++;
+
+		if (cursor == lineEnd || *cursor == '#')
+		{
+			//Blank line or comment
+		}
+		else if ((*cursor >= '0' && *cursor <= '9') || *cursor == '-' || *cursor == '+' || *cursor == '.')
+		{
+			//Data line, red changes fastest which is the same order glTexImage3D wants
+			char* next;
+			glm::vec3 value;
+			value.x = strtof(cursor, &next);
+			value.y = strtof(next, &next);
+			value.z = strtof(next, &next);
+
+			//The domain is the range of inputs, the outputs go in as they are
+			if (entries < maxEntries)
+			{
+				halfData[entries * 3 + 0] = glm::packHalf1x16(value.x);
+				halfData[entries * 3 + 1] = glm::packHalf1x16(value.y);
+				halfData[entries * 3 + 2] = glm::packHalf1x16(value.z);
+			}
+			entries++;
+		}
+		else if (strncmp(cursor, "LUT_3D_SIZE", 11) == 0)
+		{
+			size = atoi(cursor + 11);
+			if (size < MIN_SIZE || size > MAX_SIZE)
+			{
+				printf("LUT %s has LUT_3D_SIZE %d, it has to be between %d and %d\n", sourcePath.c_str(), size, MIN_SIZE, MAX_SIZE);
+				return false;
+			}
+			maxEntries = (size_t)size * size * size;
+			halfData.resize(maxEntries * 3);
+		}
+		else if (strncmp(cursor, "DOMAIN_MIN", 10) == 0)
+		{
+			sscanf(cursor + 10, "%f %f %f", &domainMin.x, &domainMin.y, &domainMin.z);
+		}
+		else if (strncmp(cursor, "DOMAIN_MAX", 10) == 0)
+		{
+			sscanf(cursor + 10, "%f %f %f", &domainMax.x, &domainMax.y, &domainMax.z);
+		}
+		//Anything else (TITLE, etc.) doesn't matter to us
+
+		cursor = lineEnd + 1;
+	}
+
+	if (size < 2 || entries != maxEntries)
+	{
+		printf("LUT %s has %d entries but LUT_3D_SIZE %d needs %d\n", sourcePath.c_str(), (int)entries, size, (int)maxEntries);
+		return false;
+	}
 
-	while (!LUTstream.eof())
+	//The shader divides by the domain's size to find where a colour lands in the cube
+	if (domainMax.x <= domainMin.x || domainMax.y <= domainMin.y || domainMax.z <= domainMin.z)
 	{
-		std::string _line;
-		std::getline(LUTstream, _line);
+		printf("LUT %s has an empty domain, DOMAIN_MIN %g %g %g DOMAIN_MAX %g %g %g\n", sourcePath.c_str(),
+			domainMin.x, domainMin.y, domainMin.z, domainMax.x, domainMax.y, domainMax.z);
+		return false;
+	}
+
+	_size = size;
+	_domainMin = domainMin;
+	_domainMax = domainMax;
+	return true;
+}
 
-		if (_line.empty())
-			continue;
+void LUT3D::writeCache(const std::string& cachePath, const std::string& sourcePath, const std::vector<uint16_t>& halfData)
+{
+	LUTCacheHeader header;
+	memcpy(header.Magic, LUT_CACHE_MAGIC, 4);
+	header.Version = LUT_CACHE_VERSION;
+	header.Size = (uint32_t)_size;
+	header.Format = GL_RGB16F;
+	header.DomainMin = _domainMin;
+	header.DomainMax = _domainMax;
+	header.SourceTime = 0;
+	header.SourceSize = 0;
+	Util::GetFileStamp(sourcePath, header.SourceTime, header.SourceSize);
 
-		glm::vec3 lineData;
-		if (sscanf(_line.c_str(), "%f %f %f", &lineData.x, &lineData.y, &lineData.z) == 3)
-			data.push_back(lineData);
+	std::ofstream cache(cachePath, std::ios::binary);
+	if (!cache)
+	{
+		printf("LUT cache %s couldn't be written\n", cachePath.c_str());
+		return;
 	}
 
-	glEnable(GL_TEXTURE_3D);
+	cache.write(reinterpret_cast<const char*>(&header), sizeof(LUTCacheHeader));
+	cache.write(reinterpret_cast<const char*>(halfData.data()), halfData.size() * sizeof(uint16_t));
+}
+
+void LUT3D::upload(const void* halfData)
+{
+	//Reloading replaces the old texture
+	if (_handle != GL_NONE)
+	{
+		glDeleteTextures(1, &_handle);
+	}
 
 	glGenTextures(1, &_handle);
 	bind();
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB, 64, 64, 64, 0, GL_RGB, GL_FLOAT, &data[0]);
+	//RGB16F rows aren't always a multiple of 4 bytes (33 wide cubes for one)
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, _size, _size, _size, 0, GL_RGB, GL_HALF_FLOAT, halfData);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	unbind();
-
-	glDisable(GL_TEXTURE_3D);
 }
 
 void LUT3D::bind()
@@ -64,4 +245,24 @@ void LUT3D::unbind(int textureSlot)
 {
 	glActiveTexture(GL_TEXTURE0 + textureSlot);
 	unbind();
-}
\ No newline at end of file
+}
+
+int LUT3D::getSize() const
+{
+	return _size;
+}
+
+glm::vec3 LUT3D::getDomainMin() const
+{
+	return _domainMin;
+}
+
+glm::vec3 LUT3D::getDomainMax() const
+{
+	return _domainMax;
+}
+
+bool LUT3D::isLoaded() const
+{
+	return _handle != GL_NONE;
+}
@@ -2,21 +2,51 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <cstdint>
 #include <glad/glad.h>
 #include "glm/common.hpp"
+#include "glm/vec3.hpp"
 
+//A 3D colour lookup table loaded from a .cube file
+//*The first load writes a binary RGB16F cache next to the .cube, later loads map the cache straight into the texture
 class LUT3D
 {
 public:
 	LUT3D();
 	LUT3D(std::string path);
+	//Loads the cube from the cache if it's still up to date, otherwise parses the .cube and rebuilds the cache
 	void loadFromFile(std::string path);
 	void bind();
 	void unbind();
 
 	void bind(int textureSlot);
 	void unbind(int textureSlot);
+
+	//How many entries the cube has along each side
+	int getSize() const;
+	//The range of input colours the cube covers (DOMAIN_MIN and DOMAIN_MAX, 0 to 1 if the file doesn't say)
+	glm::vec3 getDomainMin() const;
+	glm::vec3 getDomainMax() const;
+	//Did a cube get uploaded
+	bool isLoaded() const;
+
+	//Cubes outside this many entries along each side get rejected (anything bigger is a broken file, not a real LUT)
+	static const int MIN_SIZE = 2;
+	static const int MAX_SIZE = 256;
 private:
+	//Maps the cache and uploads it, returns false if it's missing or out of date
+	bool loadFromCache(const std::string& cachePath, const std::string& sourcePath);
+	//Parses the .cube into half floats, returns false if it couldn't be read
+	bool parseCube(const std::string& sourcePath, std::vector<uint16_t>& halfData);
+	//Writes the parsed cube out as a cache
+	void writeCache(const std::string& cachePath, const std::string& sourcePath, const std::vector<uint16_t>& halfData);
+	//Uploads size^3 RGB half floats
+	void upload(const void* halfData);
+
 	GLuint _handle = GL_NONE;
-	std::vector<glm::vec3> data;
+	//Read from LUT_3D_SIZE
+	int _size = 0;
+	//Read from DOMAIN_MIN and DOMAIN_MAX, colours get moved into this range before the lookup
+	glm::vec3 _domainMin = glm::vec3(0.0f);
+	glm::vec3 _domainMax = glm::vec3(1.0f);
 };
\ No newline at end of file
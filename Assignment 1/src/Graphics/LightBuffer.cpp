@@ -0,0 +1,72 @@
+#include "LightBuffer.h"
+#include <algorithm>
+#include <Transform.h>
+#include <Logging.h>
+
+LightBuffer::LightBuffer()
+{
+}
+
+LightBuffer::~LightBuffer()
+{
+	Unload();
+}
+
+void LightBuffer::Unload()
+{
+	if (_buffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_buffer);
+		_buffer = GL_NONE;
+	}
+	_capacity = 0;
+	_lights.clear();
+}
+
+void LightBuffer::Update(entt::registry& registry)
+{
+	_lights.clear();
+	registry.view<PointLight, Transform>().each([&](entt::entity, PointLight& light, Transform& transform) {
+		if (_lights.size() >= (size_t)MAX_LIGHTS)
+			return;
+		PointLightData data;
+		data.PositionRadius = glm::vec4(glm::vec3(transform.WorldTransform()[3]), light.Radius);
+		data.Colour = glm::vec4(light.Colour, 1.0f);
+		_lights.push_back(data);
+	});
+
+	//Generates the buffer the first time around
+	if (_buffer == GL_NONE)
+	{
+		glGenBuffers(1, &_buffer);
+	}
+
+	//Only reallocates when there are more lights than fit, otherwise the lights just get written over the old ones
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _buffer);
+	if (_lights.size() > _capacity || _capacity == 0)
+	{
+		_capacity = std::max(_lights.size(), (size_t)16);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, _capacity * sizeof(PointLightData), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (!_lights.empty())
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _lights.size() * sizeof(PointLightData), _lights.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
+
+void LightBuffer::Bind(const Shader::sptr& shader) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, _buffer);
+	shader->SetUniform("u_PointLightCount", GetCount());
+}
+
+const std::vector<PointLightData>& LightBuffer::GetLights() const
+{
+	return _lights;
+}
+
+int LightBuffer::GetCount() const
+{
+	return (int)_lights.size();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <glad/glad.h>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <Shader.h>
+
+//A light that shines in every direction from its entity's position
+struct PointLight
+{
+	glm::vec3 Colour = glm::vec3(1.0f);
+	//Fades out to nothing at this distance
+	float Radius = 5.0f;
+};
+
+//How a point light is laid out in the light buffer (std430)
+struct PointLightData
+{
+	//xyz is the world position, w is the radius
+	glm::vec4 PositionRadius;
+	glm::vec4 Colour;
+};
+
+//Gathers every PointLight in a registry into a shader storage buffer once a frame
+//*Lighting shaders read it at LIGHT_BINDING, with the count in u_PointLightCount
+class LightBuffer
+{
+public:
+	LightBuffer();
+	~LightBuffer();
+
+	//Deletes the buffer
+	void Unload();
+
+	//Copies every light's position, radius and colour into the buffer
+	//*Call after TransformSystem::Update
+	void Update(entt::registry& registry);
+	//Binds the buffer and sets the count on a shader (the shader has to be bound)
+	void Bind(const Shader::sptr& shader) const;
+
+	//The lights from the last update
+	const std::vector<PointLightData>& GetLights() const;
+	int GetCount() const;
+
+	//The shader storage binding the lights go in (0 is the transforms)
+	static const GLuint LIGHT_BINDING = 1;
+	//Most lights that get uploaded
+	static const int MAX_LIGHTS = 1024;
+private:
+	std::vector<PointLightData> _lights;
+	GLuint _buffer = GL_NONE;
+	//How many lights the buffer has room for
+	size_t _capacity = 0;
+};
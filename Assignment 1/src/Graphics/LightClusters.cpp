@@ -0,0 +1,268 @@
+#include "LightClusters.h"
+#include <cmath>
+#include <algorithm>
+#include "Utilities/JobSystem.h"
+#include "Utilities/Profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTERS_USE_SSE
+#endif
+
+LightClusters::LightClusters()
+{
+	_binned.resize(CLUSTER_COUNT);
+	_clusters.resize(CLUSTER_COUNT);
+}
+
+LightClusters::~LightClusters()
+{
+	Unload();
+}
+
+void LightClusters::Unload()
+{
+	if (_clusterBuffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_clusterBuffer);
+		_clusterBuffer = GL_NONE;
+	}
+	if (_indexBuffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_indexBuffer);
+		_indexBuffer = GL_NONE;
+	}
+	_clusterCapacity = 0;
+	_indexCapacity = 0;
+}
+
+void LightClusters::Build(const std::vector<PointLightData>& lights, const glm::mat4& view, const glm::mat4& projection, unsigned width, unsigned height)
+{
+	//A perspective projection puts -z in w, an orthographic one leaves w at 1
+	_perspective = projection[2][3] != 0.0f;
+	if (_perspective)
+	{
+		_near = projection[3][2] / (projection[2][2] - 1.0f);
+		_far = projection[3][2] / (projection[2][2] + 1.0f);
+		_projection = glm::vec4(projection[0][0], projection[1][1], -projection[2][0], -projection[2][1]);
+	}
+	else
+	{
+		_near = (projection[3][2] + 1.0f) / projection[2][2];
+		_far = (projection[3][2] - 1.0f) / projection[2][2];
+		_projection = glm::vec4(projection[0][0], projection[1][1], projection[3][0], projection[3][1]);
+	}
+	_near = std::max(_near, MIN_NEAR);
+	_far = std::max(_far, _near * 2.0f);
+	_depthScale = CLUSTERS_Z / std::log(_far / _near);
+	_depthBias = -std::log(_near) * _depthScale;
+	_tileSize = glm::vec2(std::max(width, 1u) / (float)CLUSTERS_X, std::max(height, 1u) / (float)CLUSTERS_Y);
+
+	//Copy the lights out, padded so the last group of 4 doesn't read past the end
+	size_t count = lights.size();
+	size_t padded = (count + 3) & ~(size_t)3;
+	_x.assign(padded, 0.0f);
+	_y.assign(padded, 0.0f);
+	_z.assign(padded, 0.0f);
+	_radius.assign(padded, 0.0f);
+	for (size_t i = 0; i < count; i++)
+	{
+		_x[i] = lights[i].PositionRadius.x;
+		_y[i] = lights[i].PositionRadius.y;
+		_z[i] = lights[i].PositionRadius.z;
+		_radius[i] = lights[i].PositionRadius.w;
+	}
+
+	//Move them into view space, and flip z so it's the distance in front of the camera
+#ifdef CLUSTERS_USE_SSE
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&_x[i]);
+		__m128 y = _mm_loadu_ps(&_y[i]);
+		__m128 z = _mm_loadu_ps(&_z[i]);
+		__m128 result[3];
+		for (int row = 0; row < 3; row++)
+		{
+			result[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0][row])), _mm_mul_ps(y, _mm_set1_ps(view[1][row]))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[2][row])), _mm_set1_ps(view[3][row])));
+		}
+		_mm_storeu_ps(&_x[i], result[0]);
+		_mm_storeu_ps(&_y[i], result[1]);
+		_mm_storeu_ps(&_z[i], _mm_sub_ps(_mm_setzero_ps(), result[2]));
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 position = glm::vec3(view * glm::vec4(_x[i], _y[i], _z[i], 1.0f));
+		_x[i] = position.x;
+		_y[i] = position.y;
+		_z[i] = -position.z;
+	}
+#endif
+
+	//Only the lights that reach into the slices can land in a cluster
+	_inRange.clear();
+	_firstSlice.clear();
+	_lastSlice.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (_z[i] + _radius[i] <= _near || _z[i] - _radius[i] >= _far)
+			continue;
+		_inRange.push_back((uint32_t)i);
+		_firstSlice.push_back(GetSlice(_z[i] - _radius[i]));
+		_lastSlice.push_back(GetSlice(_z[i] + _radius[i]));
+	}
+
+	//Every slice only writes its own clusters, so they can all bin at once
+	{
+		PROFILE_SCOPE("Bin Lights");
+		JobSystem::ParallelFor(CLUSTERS_Z, 1, [this](size_t begin, size_t end) {
+			for (size_t slice = begin; slice < end; slice++)
+			{
+				BinSlice((int)slice);
+			}
+		});
+	}
+
+	//Flatten the clusters' lists into one
+	_indices.clear();
+	_occupiedCount = 0;
+	_maxPerCluster = 0;
+	for (int i = 0; i < CLUSTER_COUNT; i++)
+	{
+		const std::vector<uint32_t>& binned = _binned[i];
+		_clusters[i].Offset = (GLuint)_indices.size();
+		_clusters[i].Count = (GLuint)binned.size();
+		_indices.insert(_indices.end(), binned.begin(), binned.end());
+		if (!binned.empty())
+		{
+			_occupiedCount++;
+			_maxPerCluster = std::max(_maxPerCluster, (int)binned.size());
+		}
+	}
+
+	Upload(_clusterBuffer, _clusterCapacity, _clusters);
+	Upload(_indexBuffer, _indexCapacity, _indices);
+}
+
+void LightClusters::BinSlice(int slice)
+{
+	const int tiles = CLUSTERS_X * CLUSTERS_Y;
+	std::vector<uint32_t>* binned = &_binned[slice * tiles];
+	for (int i = 0; i < tiles; i++)
+	{
+		binned[i].clear();
+	}
+
+	//Where the slice starts and ends
+	float sliceNear = _near * std::pow(_far / _near, (float)slice / CLUSTERS_Z);
+	float sliceFar = _near * std::pow(_far / _near, (float)(slice + 1) / CLUSTERS_Z);
+
+	for (size_t i = 0; i < _inRange.size(); i++)
+	{
+		if (slice < _firstSlice[i] || slice > _lastSlice[i])
+			continue;
+		uint32_t light = _inRange[i];
+		float radius = _radius[light];
+
+		//The light's bounding box, cut down to the slice
+		float minX = _x[light] - radius;
+		float maxX = _x[light] + radius;
+		float minY = _y[light] - radius;
+		float maxY = _y[light] + radius;
+		float nearDepth = std::max(_z[light] - radius, sliceNear);
+		float farDepth = std::min(_z[light] + radius, sliceFar);
+
+		//Project the box onto the screen, dividing by depth moves the edges the most at whichever end is closer
+		float left, right, bottom, top;
+		if (_perspective)
+		{
+			left = std::min(minX / nearDepth, minX / farDepth);
+			right = std::max(maxX / nearDepth, maxX / farDepth);
+			bottom = std::min(minY / nearDepth, minY / farDepth);
+			top = std::max(maxY / nearDepth, maxY / farDepth);
+		}
+		else
+		{
+			left = minX;
+			right = maxX;
+			bottom = minY;
+			top = maxY;
+		}
+		left = left * _projection.x + _projection.z;
+		right = right * _projection.x + _projection.z;
+		bottom = bottom * _projection.y + _projection.w;
+		top = top * _projection.y + _projection.w;
+		if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+			continue;
+
+		//From -1 to 1 over to tiles
+		int firstX = std::max((int)std::floor((left * 0.5f + 0.5f) * CLUSTERS_X), 0);
+		int lastX = std::min((int)std::floor((right * 0.5f + 0.5f) * CLUSTERS_X), (int)CLUSTERS_X - 1);
+		int firstY = std::max((int)std::floor((bottom * 0.5f + 0.5f) * CLUSTERS_Y), 0);
+		int lastY = std::min((int)std::floor((top * 0.5f + 0.5f) * CLUSTERS_Y), (int)CLUSTERS_Y - 1);
+		for (int y = firstY; y <= lastY; y++)
+		{
+			for (int x = firstX; x <= lastX; x++)
+			{
+				binned[y * CLUSTERS_X + x].push_back(light);
+			}
+		}
+	}
+}
+
+int LightClusters::GetSlice(float depth) const
+{
+	if (depth <= _near)
+		return 0;
+	int slice = (int)std::floor(std::log(depth) * _depthScale + _depthBias);
+	return std::min(std::max(slice, 0), (int)CLUSTERS_Z - 1);
+}
+
+template <typename T>
+void LightClusters::Upload(GLuint& buffer, size_t& capacity, const std::vector<T>& data)
+{
+	//Generates the buffer the first time around
+	if (buffer == GL_NONE)
+	{
+		glGenBuffers(1, &buffer);
+	}
+
+	//Only reallocates when it grows, otherwise the new data just gets written over the old
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (data.size() > capacity || capacity == 0)
+	{
+		capacity = std::max(data.size() + data.size() / 2, (size_t)64);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (!data.empty())
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, data.size() * sizeof(T), data.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+}
+
+void LightClusters::Bind(const Shader::sptr& shader) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, _clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, _indexBuffer);
+	shader->SetUniform("u_ClusterCount", glm::ivec3(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z));
+	shader->SetUniform("u_ClusterTileSize", _tileSize);
+	shader->SetUniform("u_ClusterDepthScale", _depthScale);
+	shader->SetUniform("u_ClusterDepthBias", _depthBias);
+}
+
+int LightClusters::GetIndexCount() const
+{
+	return (int)_indices.size();
+}
+
+int LightClusters::GetOccupiedCount() const
+{
+	return _occupiedCount;
+}
+
+int LightClusters::GetMaxPerCluster() const
+{
+	return _maxPerCluster;
+}
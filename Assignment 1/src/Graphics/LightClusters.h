@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <Shader.h>
+#include "Graphics/LightBuffer.h"
+
+//A cluster's range in the light index list (std430)
+struct LightCluster
+{
+	GLuint Offset;
+	GLuint Count;
+};
+
+//Bins the point lights into a grid of clusters over the view frustum every frame, so shaders only loop over the lights near each pixel
+//*The grid is CLUSTERS_X by CLUSTERS_Y tiles on screen, by CLUSTERS_Z slices spaced exponentially in depth (thin near the camera)
+//*Lights are copied into separate x/y/z/radius arrays so 4 get moved into view space at once
+//*Each slice is binned on its own job, a light goes in every cluster its bounding box touches
+//*The clusters and the light index list they point into are uploaded as shader storage buffers, next to LightBuffer's lights
+class LightClusters
+{
+public:
+	LightClusters();
+	~LightClusters();
+
+	//Deletes the buffers
+	void Unload();
+
+	//Bins the lights for a camera, and uploads the clusters
+	//*width and height are the size being drawn at, the tiles cover it
+	void Build(const std::vector<PointLightData>& lights, const glm::mat4& view, const glm::mat4& projection, unsigned width, unsigned height);
+	//Binds the clusters and sets how to find a pixel's cluster on a shader (the shader has to be bound)
+	void Bind(const Shader::sptr& shader) const;
+
+	//How many entries the light index list had, how many clusters had a light and the most any one had
+	int GetIndexCount() const;
+	int GetOccupiedCount() const;
+	int GetMaxPerCluster() const;
+
+	//The size of the grid
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+	//The shader storage bindings the clusters and light indices go in (after LightBuffer::LIGHT_BINDING)
+	static const GLuint CLUSTER_BINDING = 2;
+	static const GLuint INDEX_BINDING = 3;
+	//Slices start here even if the camera's near plane is closer, so the first slice isn't tiny
+	static constexpr float MIN_NEAR = 0.1f;
+private:
+	//The slice a view space depth lands in (clamped to the grid)
+	int GetSlice(float depth) const;
+	//Bins the lights that reach into a slice into its clusters
+	void BinSlice(int slice);
+	//Uploads a vector to a buffer, only reallocating when it grows
+	template <typename T>
+	static void Upload(GLuint& buffer, size_t& capacity, const std::vector<T>& data);
+
+	//The lights in view space, one array per component (padded to a multiple of 4)
+	std::vector<float> _x;
+	std::vector<float> _y;
+	std::vector<float> _z;
+	std::vector<float> _radius;
+	//The lights that reach into the view's depth range, and the first and last slice each touches
+	std::vector<uint32_t> _inRange;
+	std::vector<int> _firstSlice;
+	std::vector<int> _lastSlice;
+
+	//Every cluster's lights, kept between frames so they don't reallocate
+	std::vector<std::vector<uint32_t>> _binned;
+	std::vector<LightCluster> _clusters;
+	std::vector<GLuint> _indices;
+
+	//The projection's scale and offset for x and y, and whether it divides by depth
+	glm::vec4 _projection = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	bool _perspective = true;
+	float _near = 0.1f;
+	float _far = 100.0f;
+	//Slice = log(depth) * scale + bias
+	float _depthScale = 1.0f;
+	float _depthBias = 0.0f;
+	glm::vec2 _tileSize = glm::vec2(1.0f);
+
+	GLuint _clusterBuffer = GL_NONE;
+	GLuint _indexBuffer = GL_NONE;
+	size_t _clusterCapacity = 0;
+	size_t _indexCapacity = 0;
+
+	int _occupiedCount = 0;
+	int _maxPerCluster = 0;
+};
@@ -0,0 +1,696 @@
+#include "MeshCache.h"
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <filesystem>
+#include <Logging.h>
+#include "Utilities/MappedFile.h"
+#include "Utilities/Util.h"
+
+std::unordered_map<const VertexArrayObject*, MeshCache::MeshEntry> MeshCache::_meshes;
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+
+//A corner of an OBJ face, the position/uv/normal indices it uses (-1 if missing)
+struct ObjCorner
+{
+	int Position;
+	int UV;
+	int Normal;
+
+	bool operator==(const ObjCorner& other) const
+	{
+		return Position == other.Position && UV == other.UV && Normal == other.Normal;
+	}
+};
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& corner) const
+	{
+		return ((size_t)corner.Position * 73856093) ^ ((size_t)corner.UV * 19349663) ^ ((size_t)corner.Normal * 83492791);
+	}
+};
+
+//Reads an OBJ index, turning negative (relative) ones absolute and making it 0 based
+static int ReadObjIndex(const char*& cursor, size_t count)
+{
+	char* end;
+	long index = strtol(cursor, &end, 10);
+	if (end == cursor)
+		return -1;
+
+	cursor = end;
+	return index < 0 ? (int)(count + index) : (int)(index - 1);
+}
+
+VertexArrayObject::sptr MeshCache::LoadFromFile(const std::string& path, const glm::vec4& color)
+{
+	std::string cachePath = GetCachePath(path);
+
+	//Fast path, straight from the cache into the buffers
+	VertexArrayObject::sptr vao = LoadFromCache(cachePath, path, color);
+	if (vao != nullptr)
+		return vao;
+
+	std::vector<VertexPosNormTexCol> vertices;
+	std::vector<uint32_t> indices;
+	if (!ParseObj(path, color, vertices, indices))
+	{
+		LOG_WARN("Failed to load mesh {}", path);
+		return nullptr;
+	}
+
+	return BuildMesh(cachePath, path, color, vertices, indices, ComputeBounds(vertices));
+}
+
+VertexArrayObject::sptr MeshCache::LoadLOD(const std::string& path, int level, const glm::vec4& color)
+{
+	if (level <= 0)
+		return LoadFromFile(path, color);
+
+	std::string cachePath = GetCachePath(path, level);
+	VertexArrayObject::sptr vao = LoadFromCache(cachePath, path, color);
+	if (vao != nullptr)
+		return vao;
+
+	std::vector<VertexPosNormTexCol> vertices;
+	std::vector<uint32_t> indices;
+	if (!ParseObj(path, color, vertices, indices))
+	{
+		LOG_WARN("Failed to load mesh {}", path);
+		return nullptr;
+	}
+
+	//Every level keeps the full mesh's bounds, so swapping levels doesn't move the bounding sphere
+	MeshBounds bounds = ComputeBounds(vertices);
+	size_t targetTriangles = (indices.size() / 3) >> level;
+	Simplify(vertices, indices, targetTriangles);
+	return BuildMesh(cachePath, path, color, vertices, indices, bounds);
+}
+
+bool MeshCache::GetBounds(const VertexArrayObject::sptr& vao, MeshBounds& bounds)
+{
+	const MeshEntry* entry = FindMesh(vao);
+	if (entry == nullptr)
+		return false;
+
+	bounds = entry->Bounds;
+	return true;
+}
+
+bool MeshCache::GetBuffers(const VertexArrayObject::sptr& vao, MeshBuffers& buffers)
+{
+	const MeshEntry* entry = FindMesh(vao);
+	if (entry == nullptr)
+		return false;
+
+	buffers = entry->Buffers;
+	return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& path, int level)
+{
+	std::string extension = level > 0 ? ".lod" + std::to_string(level) + ".meshcache" : ".meshcache";
+	return std::filesystem::path(path).replace_extension(extension).generic_string();
+}
+
+int MeshCache::EvictUnused()
+{
+	int evicted = 0;
+	for (auto it = _meshes.begin(); it != _meshes.end();)
+	{
+		if (it->second.Mesh.expired())
+		{
+			it = _meshes.erase(it);
+			evicted++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return evicted;
+}
+
+void MeshCache::Clear()
+{
+	_meshes.clear();
+}
+
+int MeshCache::GetMeshCount()
+{
+	return (int)_meshes.size();
+}
+
+VertexArrayObject::sptr MeshCache::LoadFromCache(const std::string& cachePath, const std::string& sourcePath, const glm::vec4& color)
+{
+	MappedFile cache(cachePath);
+	if (!cache.IsOpen() || cache.GetSize() < sizeof(MeshCacheHeader))
+		return nullptr;
+
+	MeshCacheHeader header;
+	memcpy(&header, cache.GetData(), sizeof(MeshCacheHeader));
+
+	if (memcmp(header.Magic, MESH_CACHE_MAGIC, 4) != 0 || header.Version != VERSION || memcmp(&header.Color, &color, sizeof(glm::vec4)) != 0)
+		return nullptr;
+	if (header.IndexSize != 2 && header.IndexSize != 4)
+		return nullptr;
+
+	//Rebuild if the .obj changed (a cache without its .obj is still fine to use)
+	int64_t sourceTime;
+	uint64_t sourceSize;
+	if (Util::GetFileStamp(sourcePath, sourceTime, sourceSize) && (sourceTime != header.SourceTime || sourceSize != header.SourceSize))
+		return nullptr;
+
+	size_t vertexBytes = (size_t)header.VertexCount * sizeof(VertexPosNormTexCol);
+	size_t indexBytes = (size_t)header.IndexCount * header.IndexSize;
+	if (cache.GetSize() < sizeof(MeshCacheHeader) + vertexBytes + indexBytes)
+		return nullptr;
+
+	//The header keeps the vertices 4 byte aligned, so they can be read in place
+	const uint8_t* data = cache.GetData() + sizeof(MeshCacheHeader);
+	return CreateVAO(reinterpret_cast<const VertexPosNormTexCol*>(data), header.VertexCount,
+		data + vertexBytes, header.IndexCount, header.IndexSize, { header.Min, header.Max });
+}
+
+bool MeshCache::ParseObj(const std::string& path, const glm::vec4& color, std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	//Read it all in one go instead of line by line
+	std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	//Welds corners that use the same position/uv/normal into one vertex
+	std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> welded;
+	std::vector<uint32_t> face;
+	bool missingNormals = false;
+
+	const char* cursor = contents.c_str();
+	const char* end = cursor + contents.size();
+	while (cursor < end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t'))
+			cursor++;
+
+		if (cursor + 1 < lineEnd && cursor[0] == 'v' && cursor[1] == ' ')
+		{
+			char* next;
+			glm::vec3 position;
+			position.x = strtof(cursor + 2, &next);
+			position.y = strtof(next, &next);
+			position.z = strtof(next, &next);
+			positions.push_back(position);
+		}
+		else if (cursor + 2 < lineEnd && cursor[0] == 'v' && cursor[1] == 't' && cursor[2] == ' ')
+		{
+			char* next;
+			glm::vec2 uv;
+			uv.x = strtof(cursor + 3, &next);
+			uv.y = strtof(next, &next);
+			uvs.push_back(uv);
+		}
+		else if (cursor + 2 < lineEnd && cursor[0] == 'v' && cursor[1] == 'n' && cursor[2] == ' ')
+		{
+			char* next;
+			glm::vec3 normal;
+			normal.x = strtof(cursor + 3, &next);
+			normal.y = strtof(next, &next);
+			normal.z = strtof(next, &next);
+			normals.push_back(normal);
+		}
+		else if (cursor + 1 < lineEnd && cursor[0] == 'f' && cursor[1] == ' ')
+		{
+			//Corners are v, v/vt, v//vn or v/vt/vn
+			face.clear();
+			cursor += 2;
+			while (cursor < lineEnd)
+			{
+				while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+					cursor++;
+				if (cursor >= lineEnd)
+					break;
+
+				ObjCorner corner = { ReadObjIndex(cursor, positions.size()), -1, -1 };
+				if (corner.Position < 0 || corner.Position >= (int)positions.size())
+					break;
+
+				if (*cursor == '/')
+				{
+					cursor++;
+					if (*cursor != '/')
+						corner.UV = ReadObjIndex(cursor, uvs.size());
+					if (*cursor == '/')
+					{
+						cursor++;
+						corner.Normal = ReadObjIndex(cursor, normals.size());
+					}
+				}
+
+				if (corner.UV >= (int)uvs.size())
+					corner.UV = -1;
+				if (corner.Normal >= (int)normals.size())
+					corner.Normal = -1;
+
+				auto it = welded.find(corner);
+				if (it == welded.end())
+				{
+					VertexPosNormTexCol vertex;
+					vertex.Position = positions[corner.Position];
+					vertex.Color = color;
+					vertex.Normal = corner.Normal >= 0 ? normals[corner.Normal] : glm::vec3(0.0f);
+					vertex.UV = corner.UV >= 0 ? uvs[corner.UV] : glm::vec2(0.0f);
+					missingNormals |= corner.Normal < 0;
+
+					it = welded.emplace(corner, (uint32_t)vertices.size()).first;
+					vertices.push_back(vertex);
+				}
+				face.push_back(it->second);
+
+				//Skip anything we don't understand in the corner
+				while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r')
+					cursor++;
+			}
+
+			//Fans polygons into triangles
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+		//Anything else (comments, groups, materials) doesn't matter to us
+
+		cursor = lineEnd + 1;
+	}
+
+	//Smooth normals for any corners that didn't come with one
+	if (missingNormals)
+	{
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			VertexPosNormTexCol& a = vertices[indices[i]];
+			VertexPosNormTexCol& b = vertices[indices[i + 1]];
+			VertexPosNormTexCol& c = vertices[indices[i + 2]];
+			glm::vec3 faceNormal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+			a.Normal += faceNormal;
+			b.Normal += faceNormal;
+			c.Normal += faceNormal;
+		}
+		for (VertexPosNormTexCol& vertex : vertices)
+		{
+			float length = glm::length(vertex.Normal);
+			if (length > 0.0f)
+				vertex.Normal /= length;
+		}
+	}
+
+	return !indices.empty();
+}
+
+void MeshCache::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const int CACHE_SIZE = 32;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//Scores a vertex by where it is in the cache and how many triangles still need it
+	auto scoreVertex = [CACHE_SIZE](int cachePosition, int remaining) {
+		if (remaining == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			//The last triangle's vertices all score the same so we don't favour one of them
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = std::pow(1.0f - (float)(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+		}
+
+		//Vertices with only a few triangles left get finished off first
+		return score + 2.0f * std::pow((float)remaining, -0.5f);
+	};
+
+	//Which triangles use each vertex
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices)
+	{
+		remaining[index]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		offsets[i + 1] = offsets[i] + remaining[i];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		vertexTriangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexScore[i] = scoreVertex(-1, remaining[i]);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+	int64_t best = 0;
+	while (true)
+	{
+		//Nothing in the cache helps, so take the next triangle we haven't done
+		if (best < 0)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+			if (scanCursor == triangleCount)
+				break;
+			best = (int64_t)scanCursor;
+		}
+
+		uint32_t triangle = (uint32_t)best;
+		emitted[triangle] = true;
+
+		//Emit it and take it off its vertices' lists
+		newCache.clear();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			result.push_back(vertex);
+			newCache.push_back(vertex);
+
+			uint32_t* list = vertexTriangles.data() + offsets[vertex];
+			for (uint32_t i = 0; i < remaining[vertex]; i++)
+			{
+				if (list[i] == triangle)
+				{
+					list[i] = list[remaining[vertex] - 1];
+					break;
+				}
+			}
+			remaining[vertex]--;
+		}
+
+		//Its vertices go to the front of the cache
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+				newCache.push_back(vertex);
+		}
+		cache.swap(newCache);
+
+		//Anything that fell out of the cache loses its cache score
+		for (size_t i = CACHE_SIZE; i < cache.size(); i++)
+		{
+			cachePosition[cache[i]] = -1;
+			vertexScore[cache[i]] = scoreVertex(-1, remaining[cache[i]]);
+		}
+		if (cache.size() > (size_t)CACHE_SIZE)
+			cache.resize(CACHE_SIZE);
+
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			cachePosition[cache[i]] = (int)i;
+			vertexScore[cache[i]] = scoreVertex((int)i, remaining[cache[i]]);
+		}
+
+		//Only triangles touching the cache changed, so the next best is one of them
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : cache)
+		{
+			const uint32_t* list = vertexTriangles.data() + offsets[vertex];
+			for (uint32_t i = 0; i < remaining[vertex]; i++)
+			{
+				uint32_t other = list[i];
+				float score = vertexScore[indices[other * 3]] + vertexScore[indices[other * 3 + 1]] + vertexScore[indices[other * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = other;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshCache::OptimizeVertexFetch(std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<VertexPosNormTexCol> reordered;
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	//Unused vertices get dropped
+	vertices.swap(reordered);
+}
+
+void MeshCache::Simplify(std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices, size_t targetTriangles)
+{
+	if (indices.size() / 3 <= targetTriangles || vertices.empty())
+		return;
+
+	MeshBounds bounds = ComputeBounds(vertices);
+	glm::vec3 size = bounds.Max - bounds.Min;
+	float longest = glm::max(glm::max(size.x, size.y), glm::max(size.z, 1e-6f));
+
+	//Which cell of an n wide grid (along the longest side) each vertex lands in
+	std::vector<uint32_t> cells(vertices.size());
+	auto assignCells = [&](int n) {
+		float scale = (float)n / longest;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			glm::vec3 cell = (vertices[i].Position - bounds.Min) * scale;
+			uint32_t x = (uint32_t)glm::clamp((int)cell.x, 0, n - 1);
+			uint32_t y = (uint32_t)glm::clamp((int)cell.y, 0, n - 1);
+			uint32_t z = (uint32_t)glm::clamp((int)cell.z, 0, n - 1);
+			cells[i] = x + (uint32_t)n * (y + (uint32_t)n * z);
+		}
+	};
+	//How many triangles survive with every vertex in a cell merged (ones with two corners in a cell collapse)
+	auto countTriangles = [&]() {
+		size_t count = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			uint32_t a = cells[indices[i]];
+			uint32_t b = cells[indices[i + 1]];
+			uint32_t c = cells[indices[i + 2]];
+			if (a != b && b != c && a != c)
+				count++;
+		}
+		return count;
+	};
+
+	//Find the finest grid that gets under the target (coarser grids merge more)
+	int low = 1;
+	int high = MAX_SIMPLIFY_GRID;
+	int best = 1;
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		assignCells(middle);
+		if (countTriangles() <= targetTriangles)
+		{
+			best = middle;
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle - 1;
+		}
+	}
+	assignCells(best);
+
+	//One vertex per cell, at the average of everything merged into it
+	std::unordered_map<uint32_t, uint32_t> clusterOf;
+	std::vector<VertexPosNormTexCol> clustered;
+	std::vector<int> merged;
+	std::vector<uint32_t> remap(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		auto it = clusterOf.find(cells[i]);
+		if (it == clusterOf.end())
+		{
+			it = clusterOf.emplace(cells[i], (uint32_t)clustered.size()).first;
+			clustered.push_back(vertices[i]);
+			merged.push_back(1);
+		}
+		else
+		{
+			VertexPosNormTexCol& cluster = clustered[it->second];
+			cluster.Position += vertices[i].Position;
+			cluster.Normal += vertices[i].Normal;
+			merged[it->second]++;
+		}
+		remap[i] = it->second;
+	}
+	for (size_t i = 0; i < clustered.size(); i++)
+	{
+		clustered[i].Position = clustered[i].Position * (1.0f / (float)merged[i]);
+		float length = glm::length(clustered[i].Normal);
+		clustered[i].Normal = length > 1e-6f ? clustered[i].Normal * (1.0f / length) : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	//Keep the triangles that still have 3 different corners, once each
+	std::unordered_set<uint64_t> kept;
+	std::vector<uint32_t> simplified;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t a = remap[indices[i]];
+		uint32_t b = remap[indices[i + 1]];
+		uint32_t c = remap[indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		//Same corners in any order is the same triangle
+		uint64_t sorted[3] = { a, b, c };
+		std::sort(sorted, sorted + 3);
+		if (!kept.insert((sorted[0] << 42) | (sorted[1] << 21) | sorted[2]).second)
+			continue;
+
+		simplified.push_back(a);
+		simplified.push_back(b);
+		simplified.push_back(c);
+	}
+
+	vertices.swap(clustered);
+	indices.swap(simplified);
+}
+
+MeshBounds MeshCache::ComputeBounds(const std::vector<VertexPosNormTexCol>& vertices)
+{
+	MeshBounds bounds;
+	if (!vertices.empty())
+	{
+		bounds.Min = vertices[0].Position;
+		bounds.Max = vertices[0].Position;
+		for (const VertexPosNormTexCol& vertex : vertices)
+		{
+			bounds.Min = glm::min(bounds.Min, vertex.Position);
+			bounds.Max = glm::max(bounds.Max, vertex.Position);
+		}
+	}
+	return bounds;
+}
+
+VertexArrayObject::sptr MeshCache::BuildMesh(const std::string& cachePath, const std::string& sourcePath, const glm::vec4& color,
+	std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices, const MeshBounds& bounds)
+{
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeVertexFetch(vertices, indices);
+
+	MeshCacheHeader header;
+	memcpy(header.Magic, MESH_CACHE_MAGIC, 4);
+	header.Version = VERSION;
+	header.VertexCount = (uint32_t)vertices.size();
+	header.IndexCount = (uint32_t)indices.size();
+	header.IndexSize = vertices.size() <= 0xFFFF ? 2 : 4;
+	header.Reserved = 0;
+	header.Color = color;
+	header.Min = bounds.Min;
+	header.Max = bounds.Max;
+	header.SourceTime = 0;
+	header.SourceSize = 0;
+	Util::GetFileStamp(sourcePath, header.SourceTime, header.SourceSize);
+
+	//Small meshes get 16 bit indices
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = indices.data();
+	if (header.IndexSize == 2)
+	{
+		shortIndices.assign(indices.begin(), indices.end());
+		indexData = shortIndices.data();
+	}
+
+	WriteCache(cachePath, header, vertices, indexData);
+
+	return CreateVAO(vertices.data(), vertices.size(), indexData, indices.size(), header.IndexSize, bounds);
+}
+
+void MeshCache::WriteCache(const std::string& cachePath, const MeshCacheHeader& header, const std::vector<VertexPosNormTexCol>& vertices, const void* indices)
+{
+	std::ofstream cache(cachePath, std::ios::binary);
+	if (!cache)
+	{
+		LOG_WARN("Couldn't write mesh cache {}", cachePath);
+		return;
+	}
+
+	cache.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+	cache.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(VertexPosNormTexCol));
+	cache.write(reinterpret_cast<const char*>(indices), (size_t)header.IndexCount * header.IndexSize);
+}
+
+VertexArrayObject::sptr MeshCache::CreateVAO(const VertexPosNormTexCol* vertices, size_t vertexCount, const void* indices, size_t indexCount, uint32_t indexSize,
+	const MeshBounds& bounds)
+{
+	VertexBuffer::sptr vbo = VertexBuffer::Create();
+	vbo->LoadData(vertices, vertexCount);
+
+	IndexBuffer::sptr ibo = IndexBuffer::Create();
+	if (indexSize == 2)
+		ibo->LoadData(static_cast<const uint16_t*>(indices), indexCount);
+	else
+		ibo->LoadData(static_cast<const uint32_t*>(indices), indexCount);
+
+	VertexArrayObject::sptr vao = VertexArrayObject::Create();
+	vao->AddVertexBuffer(vbo, VertexPosNormTexCol::V_DECL);
+	vao->SetIndexBuffer(ibo);
+
+	MeshEntry& entry = _meshes[vao.get()];
+	entry.Mesh = vao;
+	entry.Bounds = bounds;
+	entry.Buffers.VertexBuffer = vbo->GetHandle();
+	entry.Buffers.IndexBuffer = ibo->GetHandle();
+	entry.Buffers.VertexCount = (uint32_t)vertexCount;
+	entry.Buffers.IndexCount = (uint32_t)indexCount;
+	entry.Buffers.IndexSize = indexSize;
+	return vao;
+}
+
+const MeshCache::MeshEntry* MeshCache::FindMesh(const VertexArrayObject::sptr& vao)
+{
+	auto it = _meshes.find(vao.get());
+	if (it == _meshes.end() || it->second.Mesh.lock() != vao)
+		return nullptr;
+
+	return &it->second;
+}
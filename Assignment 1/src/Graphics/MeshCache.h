@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+#include <VertexTypes.h>
+
+//Axis aligned box around a mesh in its local space
+struct MeshBounds
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+};
+
+//The GPU buffers behind a mesh we loaded, for copying it somewhere else (like StaticGeometry's merged buffers)
+//*Handles are only good while the mesh's VAO is alive
+struct MeshBuffers
+{
+	GLuint VertexBuffer = 0;
+	GLuint IndexBuffer = 0;
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	//2 or 4 bytes
+	uint32_t IndexSize = 0;
+};
+
+//Sits at the start of a .meshcache, followed by the vertices and then the indices
+struct MeshCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	//2 or 4 bytes, 16 bit indices whenever the vertices fit
+	uint32_t IndexSize;
+	uint32_t Reserved;
+	//The colour every vertex was baked with
+	glm::vec4 Color;
+	glm::vec3 Min;
+	glm::vec3 Max;
+	//The .obj the cache was built from, so editing it rebuilds the cache
+	int64_t SourceTime;
+	uint64_t SourceSize;
+};
+
+//Loads .obj files through a binary cache
+//*The first load parses the .obj, welds it into indexed VertexPosNormTexCol, reorders it for the post transform cache and writes a .meshcache next to it
+//*Later loads map the .meshcache and upload it straight into the VBO/IBO
+class MeshCache abstract
+{
+public:
+	//Drop in for ObjLoader::LoadFromFile
+	static VertexArrayObject::sptr LoadFromFile(const std::string& path, const glm::vec4& color = glm::vec4(1.0f));
+
+	//Loads a simplified version of an .obj, with about half the triangles of the level before it (level 0 is the full mesh)
+	//*Simplified levels get their own cache next to the .obj, so simplifying only happens once
+	//*Every level has the full mesh's bounds
+	static VertexArrayObject::sptr LoadLOD(const std::string& path, int level, const glm::vec4& color = glm::vec4(1.0f));
+
+	//The bounds of a mesh we loaded, returns false if it didn't come from us
+	static bool GetBounds(const VertexArrayObject::sptr& vao, MeshBounds& bounds);
+	//The buffers of a mesh we loaded (every one is indexed VertexPosNormTexCol), returns false if it didn't come from us
+	static bool GetBuffers(const VertexArrayObject::sptr& vao, MeshBuffers& buffers);
+
+	//Where the cache for an .obj (or one of its simplified levels) goes
+	static std::string GetCachePath(const std::string& path, int level = 0);
+
+	//Forgets the bounds and buffers of meshes that have been freed, returns how many went
+	static int EvictUnused();
+	//Forgets every mesh we've loaded (GetBounds and GetBuffers fail for them afterwards)
+	static void Clear();
+	//How many meshes we're keeping bounds and buffers for
+	static int GetMeshCount();
+
+	static const uint32_t VERSION = 1;
+	//Finest grid simplifying will try (cells along the mesh's longest side)
+	static const int MAX_SIMPLIFY_GRID = 256;
+private:
+	//Maps and uploads the cache, returns nullptr if it's missing or out of date
+	static VertexArrayObject::sptr LoadFromCache(const std::string& cachePath, const std::string& sourcePath, const glm::vec4& color);
+	//Parses the .obj into welded vertices and triangle indices
+	static bool ParseObj(const std::string& path, const glm::vec4& color, std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices);
+	//Reorders the triangles so shared vertices stay in the post transform cache (Forsyth's algorithm)
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	//Reorders the vertices into the order the triangles first use them
+	static void OptimizeVertexFetch(std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices);
+	//Cuts a mesh down to at most targetTriangles by merging every vertex in a grid cell into one (vertex clustering)
+	//*Picks the finest grid that gets under the target, triangles that lose a corner to the merge go
+	static void Simplify(std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices, size_t targetTriangles);
+	//Box around the vertices
+	static MeshBounds ComputeBounds(const std::vector<VertexPosNormTexCol>& vertices);
+	//Optimizes the mesh, writes its cache and makes its VAO
+	static VertexArrayObject::sptr BuildMesh(const std::string& cachePath, const std::string& sourcePath, const glm::vec4& color,
+		std::vector<VertexPosNormTexCol>& vertices, std::vector<uint32_t>& indices, const MeshBounds& bounds);
+	//Writes the cache
+	static void WriteCache(const std::string& cachePath, const MeshCacheHeader& header, const std::vector<VertexPosNormTexCol>& vertices, const void* indices);
+	//Makes the VAO from vertex and index data, and remembers its bounds and buffers
+	static VertexArrayObject::sptr CreateVAO(const VertexPosNormTexCol* vertices, size_t vertexCount, const void* indices, size_t indexCount, uint32_t indexSize,
+		const MeshBounds& bounds);
+	//Bounds and buffers of a mesh we've loaded (the weak pointer catches a freed VAO's address getting reused)
+	struct MeshEntry
+	{
+		std::weak_ptr<VertexArrayObject> Mesh;
+		MeshBounds Bounds;
+		MeshBuffers Buffers;
+	};
+	static std::unordered_map<const VertexArrayObject*, MeshEntry> _meshes;
+	//Finds a mesh we've loaded, nullptr if it didn't come from us
+	static const MeshEntry* FindMesh(const VertexArrayObject::sptr& vao);
+};
@@ -0,0 +1,42 @@
+#include "GreyscaleEffect.h"
+
+GreyscaleEffect::sptr GreyscaleEffect::Create()
+{
+	return std::make_shared<GreyscaleEffect>();
+}
+
+const char* GreyscaleEffect::GetName() const
+{
+	return "Greyscale";
+}
+
+bool GreyscaleEffect::IsPerPixel() const
+{
+	return true;
+}
+
+std::string GreyscaleEffect::GetSnippetPath() const
+{
+	return "shaders/Post/greyscale_frag.glsl";
+}
+
+std::string GreyscaleEffect::GetFunctionName() const
+{
+	return "Greyscale";
+}
+
+int GreyscaleEffect::SetUniforms(const Shader::sptr& shader, int textureSlot)
+{
+	shader->SetUniform("u_GreyscaleIntensity", _intensity);
+	return textureSlot;
+}
+
+void GreyscaleEffect::SetIntensity(float intensity)
+{
+	_intensity = intensity;
+}
+
+float GreyscaleEffect::GetIntensity() const
+{
+	return _intensity;
+}
@@ -2,9 +2,24 @@
 
 #include "Graphics/Post/PostEffect.h"
 
+//Blends the image towards its luminance
 class GreyscaleEffect : public PostEffect
 {
 public:
+	typedef std::shared_ptr<GreyscaleEffect> sptr;
 
+	static sptr Create();
 
-};
\ No newline at end of file
+	const char* GetName() const override;
+
+	bool IsPerPixel() const override;
+	std::string GetSnippetPath() const override;
+	std::string GetFunctionName() const override;
+	int SetUniforms(const Shader::sptr& shader, int textureSlot) override;
+
+	//How much greyscale gets blended in (0 - 1)
+	void SetIntensity(float intensity);
+	float GetIntensity() const;
+private:
+	float _intensity = 1.0f;
+};
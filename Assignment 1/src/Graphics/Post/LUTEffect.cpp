@@ -0,0 +1,67 @@
+#include "LUTEffect.h"
+
+LUTEffect::sptr LUTEffect::Create(const std::shared_ptr<LUT3D>& lut)
+{
+	return std::make_shared<LUTEffect>(lut);
+}
+
+LUTEffect::LUTEffect(const std::shared_ptr<LUT3D>& lut)
+	: _lut(lut)
+{
+}
+
+const char* LUTEffect::GetName() const
+{
+	return "Colour Grading";
+}
+
+bool LUTEffect::IsActive() const
+{
+	return _enabled && _lut != nullptr && _lut->isLoaded();
+}
+
+bool LUTEffect::IsPerPixel() const
+{
+	return true;
+}
+
+std::string LUTEffect::GetSnippetPath() const
+{
+	return "shaders/Post/lut_frag.glsl";
+}
+
+std::string LUTEffect::GetFunctionName() const
+{
+	return "ColorGrade";
+}
+
+int LUTEffect::SetUniforms(const Shader::sptr& shader, int textureSlot)
+{
+	_lut->bind(textureSlot);
+	shader->SetUniform("s_LUT", textureSlot);
+	shader->SetUniform("u_LUTSize", (float)_lut->getSize());
+	shader->SetUniform("u_LUTDomainMin", _lut->getDomainMin());
+	shader->SetUniform("u_LUTDomainMax", _lut->getDomainMax());
+	shader->SetUniform("u_LUTIntensity", _intensity);
+	return textureSlot + 1;
+}
+
+void LUTEffect::SetLUT(const std::shared_ptr<LUT3D>& lut)
+{
+	_lut = lut;
+}
+
+const std::shared_ptr<LUT3D>& LUTEffect::GetLUT() const
+{
+	return _lut;
+}
+
+void LUTEffect::SetIntensity(float intensity)
+{
+	_intensity = intensity;
+}
+
+float LUTEffect::GetIntensity() const
+{
+	return _intensity;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Graphics/Post/PostEffect.h"
+#include "Graphics/LUT.h"
+
+//Colour grades the image through a 3D lookup table
+class LUTEffect : public PostEffect
+{
+public:
+	typedef std::shared_ptr<LUTEffect> sptr;
+
+	static sptr Create(const std::shared_ptr<LUT3D>& lut = nullptr);
+
+	LUTEffect(const std::shared_ptr<LUT3D>& lut);
+
+	const char* GetName() const override;
+
+	//Only active once it has a loaded cube
+	bool IsActive() const override;
+
+	bool IsPerPixel() const override;
+	std::string GetSnippetPath() const override;
+	std::string GetFunctionName() const override;
+	int SetUniforms(const Shader::sptr& shader, int textureSlot) override;
+
+	//The cube to grade with
+	void SetLUT(const std::shared_ptr<LUT3D>& lut);
+	const std::shared_ptr<LUT3D>& GetLUT() const;
+
+	//How much of the graded colour gets blended in (0 - 1)
+	void SetIntensity(float intensity);
+	float GetIntensity() const;
+private:
+	std::shared_ptr<LUT3D> _lut;
+	float _intensity = 1.0f;
+};
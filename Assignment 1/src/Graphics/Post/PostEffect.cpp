@@ -0,0 +1,45 @@
+#include "PostEffect.h"
+
+PostEffect::~PostEffect()
+{
+}
+
+void PostEffect::SetEnabled(bool enabled)
+{
+	_enabled = enabled;
+}
+
+bool PostEffect::GetEnabled() const
+{
+	return _enabled;
+}
+
+bool PostEffect::IsActive() const
+{
+	return _enabled;
+}
+
+bool PostEffect::IsPerPixel() const
+{
+	return false;
+}
+
+std::string PostEffect::GetSnippetPath() const
+{
+	return "";
+}
+
+std::string PostEffect::GetFunctionName() const
+{
+	return "";
+}
+
+int PostEffect::SetUniforms(const Shader::sptr& shader, int textureSlot)
+{
+	return textureSlot;
+}
+
+void PostEffect::Draw(const Framebuffer& source)
+{
+	//Per-pixel effects get drawn by the chain, everything else overrides this
+}
@@ -1,10 +1,45 @@
 #pragma once
 
+#include <string>
+#include <memory>
 #include "Graphics/Framebuffer.h"
 #include "Shader.h"
 
+//Base for every effect in a PostEffectChain
+//*Per-pixel effects hand the chain a GLSL snippet so adjacent ones can share one pass
+//*Everything else draws its own full screen pass
 class PostEffect
 {
 public:
+	typedef std::shared_ptr<PostEffect> sptr;
 
-};
\ No newline at end of file
+	virtual ~PostEffect();
+
+	//The name shown in the UI
+	virtual const char* GetName() const = 0;
+
+	//Turns the effect on or off (disabled effects don't cost a pass)
+	void SetEnabled(bool enabled);
+	bool GetEnabled() const;
+	//Is the effect enabled and ready to draw
+	virtual bool IsActive() const;
+
+	//Does the effect only read the pixel it's writing
+	//*If so the chain fuses it with its per-pixel neighbours into one pass
+	virtual bool IsPerPixel() const;
+	//The file holding the effect's uniforms and its "vec3 Function(vec3 color)"
+	virtual std::string GetSnippetPath() const;
+	//The name of the function in the snippet
+	virtual std::string GetFunctionName() const;
+	//Sets the effect's uniforms on the shader it's being drawn with
+	//*Extra textures get bound starting at textureSlot, returns the next free slot
+	virtual int SetUniforms(const Shader::sptr& shader, int textureSlot);
+
+	//Draws the effect as its own pass (effects that aren't per-pixel)
+	//*The source colour is bound to slot 0 and the output is already bound
+	//*Only part of the source's texture may be drawn to, so scale UVs by source.GetUVScale()
+	virtual void Draw(const Framebuffer& source);
+protected:
+	//Is the effect turned on
+	bool _enabled = true;
+};
@@ -0,0 +1,251 @@
+#include "PostEffectChain.h"
+#include <fstream>
+#include <sstream>
+
+PostEffectChain::PostEffectChain()
+{
+}
+
+PostEffectChain::~PostEffectChain()
+{
+	Unload();
+}
+
+void PostEffectChain::Unload()
+{
+	_graph.Unload();
+	_fusedShaders.clear();
+}
+
+void PostEffectChain::AddEffect(const PostEffect::sptr& effect)
+{
+	_effects.push_back(effect);
+}
+
+const std::vector<PostEffect::sptr>& PostEffectChain::GetEffects() const
+{
+	return _effects;
+}
+
+void PostEffectChain::Apply(Framebuffer& source)
+{
+	_graph.BeginFrame();
+	AddPasses(_graph, _graph.Import("Post Source", source));
+	_graph.Execute();
+}
+
+void PostEffectChain::AddPasses(FrameGraph& graph, FrameGraph::Target source)
+{
+	BuildPasses();
+	_passCount = (int)_passes.size();
+
+	//Nothing to do, so just copy it over
+	if (_passes.empty())
+	{
+		int pass = graph.AddPass("Post Copy", [&graph, source]() {
+			graph.Get(source).DrawToBackbuffer();
+		});
+		graph.Read(pass, source);
+		return;
+	}
+
+	//Every pass but the last gets its own target, the graph works out that they only need two framebuffers
+	TargetDesc desc;
+	desc.Width = graph.GetDesc(source).Width;
+	desc.Height = graph.GetDesc(source).Height;
+	desc.ColorFormats = { GL_RGBA8 };
+
+	FrameGraph::Target input = source;
+	for (size_t i = 0; i < _passes.size(); i++)
+	{
+		FrameGraph::Target output = i + 1 < _passes.size() ? graph.CreateTarget("Post Effect", desc) : FrameGraph::NONE;
+		const char* name = _passes[i].Fused ? "Fused Post Effects" : _active[_passes[i].Begin]->GetName();
+		int pass = graph.AddPass(name, [this, &graph, i, input, output]() {
+			RunPass(graph, i, input, output);
+		});
+		graph.Read(pass, input);
+		if (output != FrameGraph::NONE)
+		{
+			graph.Write(pass, output);
+		}
+		input = output;
+	}
+}
+
+void PostEffectChain::RunPass(FrameGraph& graph, size_t index, FrameGraph::Target input, FrameGraph::Target output)
+{
+	const Pass& pass = _passes[index];
+	Framebuffer& source = graph.Get(input);
+
+	glDisable(GL_DEPTH_TEST);
+
+	//The last pass goes straight to the back buffer
+	if (output != FrameGraph::NONE)
+	{
+		Framebuffer& target = graph.Get(output);
+		target.Bind();
+		target.SetViewport();
+	}
+	else
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+		glViewport(0, 0, source._width, source._height);
+	}
+
+	source.BindColorAsTexture(0, 0);
+
+	if (pass.Fused)
+	{
+		Shader::sptr shader = GetFusedShader(pass);
+		shader->Bind();
+
+		//Only part of the source's texture might be drawn to
+		shader->SetUniform("u_UVScale", source.GetUVScale());
+		//Slot 0 is the source
+		int textureSlot = 1;
+		for (size_t j = pass.Begin; j < pass.End; j++)
+		{
+			textureSlot = _active[j]->SetUniforms(shader, textureSlot);
+		}
+
+		Framebuffer::DrawFullscreenQuad();
+	}
+	else
+	{
+		_active[pass.Begin]->Draw(source);
+	}
+
+	source.UnbindTexture(0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+	glEnable(GL_DEPTH_TEST);
+}
+
+int PostEffectChain::GetPassCount() const
+{
+	return _passCount;
+}
+
+int PostEffectChain::GetShaderCount() const
+{
+	return (int)_fusedShaders.size();
+}
+
+void PostEffectChain::BuildPasses()
+{
+	_active.clear();
+	_passes.clear();
+
+	for (const PostEffect::sptr& effect : _effects)
+	{
+		if (effect->IsActive())
+		{
+			_active.push_back(effect.get());
+		}
+	}
+
+	size_t begin = 0;
+	while (begin < _active.size())
+	{
+		Pass pass;
+		pass.Begin = begin;
+		pass.End = begin + 1;
+		pass.Fused = _active[begin]->IsPerPixel();
+
+		if (pass.Fused)
+		{
+			//Keep going until we hit an effect that needs its own pass
+			//*Also stops at a repeat of an effect already in the pass, since their uniforms would clash
+			while (pass.End < _active.size() && _active[pass.End]->IsPerPixel())
+			{
+				bool repeat = false;
+				for (size_t i = pass.Begin; i < pass.End; i++)
+				{
+					if (_active[i]->GetFunctionName() == _active[pass.End]->GetFunctionName())
+					{
+						repeat = true;
+						break;
+					}
+				}
+
+				if (repeat)
+					break;
+
+				pass.End++;
+			}
+		}
+
+		_passes.push_back(pass);
+		begin = pass.End;
+	}
+}
+
+Shader::sptr PostEffectChain::GetFusedShader(const Pass& pass)
+{
+	//Effects in the same order always make the same shader
+	std::string key;
+	for (size_t i = pass.Begin; i < pass.End; i++)
+	{
+		key += _active[i]->GetFunctionName() + ";";
+	}
+
+	auto it = _fusedShaders.find(key);
+	if (it != _fusedShaders.end())
+	{
+		return it->second;
+	}
+
+	//Same inputs and outputs as the passthrough shader
+	std::string source =
+		"#version 420\n\n"
+		"layout(location = 0) in vec2 inUV;\n\n"
+		"out vec4 frag_color;\n\n"
+		"layout (binding = 0) uniform sampler2D s_screenTex;\n"
+		"uniform vec2 u_UVScale = vec2(1.0);\n\n";
+
+	for (size_t i = pass.Begin; i < pass.End; i++)
+	{
+		source += GetSnippet(_active[i]->GetSnippetPath()) + "\n";
+	}
+
+	//Each effect's function gets applied to the colour in order
+	source +=
+		"void main()\n"
+		"{\n"
+		"\tvec4 source = texture(s_screenTex, inUV * u_UVScale);\n"
+		"\tvec3 color = source.rgb;\n";
+	for (size_t i = pass.Begin; i < pass.End; i++)
+	{
+		source += "\tcolor = " + _active[i]->GetFunctionName() + "(color);\n";
+	}
+	source +=
+		"\tfrag_color = vec4(color, source.a);\n"
+		"}\n";
+
+	Shader::sptr shader = Shader::Create();
+	shader->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
+	shader->LoadShaderPart(source.c_str(), GL_FRAGMENT_SHADER);
+	shader->Link();
+
+	_fusedShaders[key] = shader;
+	return shader;
+}
+
+const std::string& PostEffectChain::GetSnippet(const std::string& path)
+{
+	auto it = _snippets.find(path);
+	if (it != _snippets.end())
+	{
+		return it->second;
+	}
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		printf("Post effect snippet %s couldn't be opened\n", path.c_str());
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return _snippets[path] = contents.str();
+}
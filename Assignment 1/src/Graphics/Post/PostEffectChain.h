@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include "Graphics/Post/PostEffect.h"
+#include "Graphics/FrameGraph.h"
+
+//Runs an ordered list of post effects over a framebuffer and draws the result to the back buffer
+//*Every pass but the last writes a transient frame graph target, which end up sharing two framebuffers (the last pass writes to the back buffer)
+//*Disabled effects are skipped, and runs of per-pixel effects get fused into one generated shader
+class PostEffectChain
+{
+public:
+	PostEffectChain();
+	~PostEffectChain();
+
+	//Deletes the pooled targets and generated shaders
+	void Unload();
+
+	//Adds an effect to the end of the chain
+	void AddEffect(const PostEffect::sptr& effect);
+	//The effects in the order they run
+	const std::vector<PostEffect::sptr>& GetEffects() const;
+
+	//Runs the active effects over source's first colour target and draws the result to the back buffer
+	//*With nothing active this is just a blit
+	void Apply(Framebuffer& source);
+	//Adds the passes for the active effects to a frame graph, reading from source's first colour target
+	void AddPasses(FrameGraph& graph, FrameGraph::Target source);
+
+	//How many full screen passes the last Apply took
+	int GetPassCount() const;
+	//How many fused shaders have been generated
+	int GetShaderCount() const;
+private:
+	//A range of active effects that get drawn in one full screen pass
+	struct Pass
+	{
+		size_t Begin;
+		size_t End;
+		//Are they per-pixel effects drawn with a generated shader
+		bool Fused;
+	};
+
+	//Groups the active effects into passes
+	void BuildPasses();
+	//Draws one of this frame's passes from input to output (or the back buffer if output is FrameGraph::NONE)
+	void RunPass(FrameGraph& graph, size_t index, FrameGraph::Target input, FrameGraph::Target output);
+	//Gets (or generates) the shader for a run of per-pixel effects
+	Shader::sptr GetFusedShader(const Pass& pass);
+	//Gets the contents of a snippet file (read once)
+	const std::string& GetSnippet(const std::string& path);
+
+	//Every effect in order
+	std::vector<PostEffect::sptr> _effects;
+	//The effects that are active this frame
+	std::vector<PostEffect*> _active;
+	//The passes for this frame
+	std::vector<Pass> _passes;
+
+	//The graph Apply runs passes through, when the chain isn't part of a bigger one
+	FrameGraph _graph;
+
+	//Generated shaders, keyed by the functions they call in order
+	std::unordered_map<std::string, Shader::sptr> _fusedShaders;
+	//Snippet files we've already read
+	std::unordered_map<std::string, std::string> _snippets;
+
+	int _passCount = 0;
+};
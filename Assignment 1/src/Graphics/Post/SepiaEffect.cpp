@@ -0,0 +1,42 @@
+#include "SepiaEffect.h"
+
+SepiaEffect::sptr SepiaEffect::Create()
+{
+	return std::make_shared<SepiaEffect>();
+}
+
+const char* SepiaEffect::GetName() const
+{
+	return "Sepia";
+}
+
+bool SepiaEffect::IsPerPixel() const
+{
+	return true;
+}
+
+std::string SepiaEffect::GetSnippetPath() const
+{
+	return "shaders/Post/sepia_frag.glsl";
+}
+
+std::string SepiaEffect::GetFunctionName() const
+{
+	return "Sepia";
+}
+
+int SepiaEffect::SetUniforms(const Shader::sptr& shader, int textureSlot)
+{
+	shader->SetUniform("u_SepiaIntensity", _intensity);
+	return textureSlot;
+}
+
+void SepiaEffect::SetIntensity(float intensity)
+{
+	_intensity = intensity;
+}
+
+float SepiaEffect::GetIntensity() const
+{
+	return _intensity;
+}
@@ -0,0 +1,253 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include "Utilities/Profiler.h"
+
+const float RenderQueue::MAX_SORT_DEPTH = 1000.0f;
+
+//Bit layout of the key
+static const int LAYER_BITS = 8;
+static const int SHADER_BITS = 12;
+static const int MATERIAL_BITS = 16;
+static const int DEPTH_BITS = 28;
+
+static const int MATERIAL_SHIFT = DEPTH_BITS;
+static const int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static const int LAYER_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+	Unload();
+}
+
+void RenderQueue::Init(entt::registry& registry)
+{
+	//Makes sure we aren't hooked into another registry
+	Unload();
+
+	_registry = &registry;
+	//Any renderer being added or removed means we need to re-sort
+	_registry->on_construct<RendererComponent>().connect<&RenderQueue::OnRendererChanged>(*this);
+	_registry->on_destroy<RendererComponent>().connect<&RenderQueue::OnRendererChanged>(*this);
+
+	_dirty = true;
+}
+
+void RenderQueue::Unload()
+{
+	if (_registry != nullptr)
+	{
+		_registry->on_construct<RendererComponent>().disconnect<&RenderQueue::OnRendererChanged>(*this);
+		_registry->on_destroy<RendererComponent>().disconnect<&RenderQueue::OnRendererChanged>(*this);
+		_registry = nullptr;
+	}
+
+	_entries.clear();
+	_scratch.clear();
+	_sorted.clear();
+	_drawIndices.clear();
+	_materials.clear();
+	_shaderIDs.clear();
+	_materialIDs.clear();
+}
+
+void RenderQueue::MarkDirty()
+{
+	_dirty = true;
+}
+
+void RenderQueue::SetDepthSorting(bool depthSorting)
+{
+	_depthSorting = depthSorting;
+	_dirty = true;
+}
+
+bool RenderQueue::GetDepthSorting() const
+{
+	return _depthSorting;
+}
+
+void RenderQueue::Update(const glm::vec3& cameraPos)
+{
+	if (_registry == nullptr)
+		return;
+
+	//Looks for renderers that swapped materials since we last sorted
+	//*Only compares pointers, walking the pool in order
+	if (!_dirty)
+	{
+		size_t index = 0;
+		_registry->view<RendererComponent>().each([&](RendererComponent& renderer) {
+			if (index >= _materials.size() || _materials[index] != renderer.Material.get())
+			{
+				_dirty = true;
+			}
+			index++;
+		});
+	}
+
+	if (_dirty || _depthSorting)
+	{
+		Rebuild(cameraPos);
+	}
+}
+
+const std::vector<entt::entity>& RenderQueue::GetSorted() const
+{
+	return _sorted;
+}
+
+int RenderQueue::GetDrawIndex(entt::entity entity) const
+{
+	auto iter = _drawIndices.find(entity);
+	if (iter == _drawIndices.end())
+		return -1;
+
+	return (int)iter->second;
+}
+
+int RenderQueue::GetSortCount() const
+{
+	return _sortCount;
+}
+
+uint64_t RenderQueue::BuildKey(const RendererComponent& renderer, float depth)
+{
+	//Render layers can be negative, so we offset them into range
+	uint64_t layer = (uint64_t)glm::clamp(renderer.Material->RenderLayer + 128, 0, (1 << LAYER_BITS) - 1);
+	uint64_t shader = GetShaderID(renderer.Material->Shader.get());
+	uint64_t material = GetMaterialID(renderer.Material.get());
+
+	uint64_t depthBits = 0;
+	if (_depthSorting)
+	{
+		//Closer objects get smaller keys so they draw first
+		//*In double, a float can't hold 2^28 - 1 and rounds up into the material's bits
+		double normalized = std::min(std::max((double)depth / MAX_SORT_DEPTH, 0.0), 1.0);
+		const uint64_t maxDepth = (1ull << DEPTH_BITS) - 1;
+		depthBits = std::min((uint64_t)(normalized * (double)maxDepth), maxDepth);
+	}
+
+	return (layer << LAYER_SHIFT) | (shader << SHADER_SHIFT) | (material << MATERIAL_SHIFT) | depthBits;
+}
+
+uint64_t RenderQueue::GetShaderID(const Shader* shader)
+{
+	auto iter = _shaderIDs.find(shader);
+	if (iter != _shaderIDs.end())
+		return iter->second;
+
+	//Wraps around if we somehow run out, which only makes the sort a bit worse
+	uint64_t id = _shaderIDs.size() & ((1 << SHADER_BITS) - 1);
+	_shaderIDs[shader] = id;
+	return id;
+}
+
+uint64_t RenderQueue::GetMaterialID(const ShaderMaterial* material)
+{
+	auto iter = _materialIDs.find(material);
+	if (iter != _materialIDs.end())
+		return iter->second;
+
+	//Wraps around if we somehow run out, which only makes the sort a bit worse
+	uint64_t id = _materialIDs.size() & ((1 << MATERIAL_BITS) - 1);
+	_materialIDs[material] = id;
+	return id;
+}
+
+void RenderQueue::Rebuild(const glm::vec3& cameraPos)
+{
+	PROFILE_SCOPE("Rebuild Sort Keys");
+	_entries.clear();
+	_materials.clear();
+
+	//Builds a key for every renderer, remembering its material so we can spot swaps later
+	_registry->view<RendererComponent>().each([&](entt::entity entity, RendererComponent& renderer) {
+		_materials.push_back(renderer.Material.get());
+
+		float depth = 0.0f;
+		if (_depthSorting)
+		{
+			depth = glm::length(glm::vec3(_registry->get<Transform>(entity).WorldTransform()[3]) - cameraPos);
+		}
+
+		_entries.push_back({ BuildKey(renderer, depth), entity });
+	});
+
+	RadixSort(_entries, _scratch);
+
+	_sorted.resize(_entries.size());
+	_drawIndices.clear();
+	for (size_t i = 0; i < _entries.size(); i++)
+	{
+		_sorted[i] = _entries[i].Entity;
+		_drawIndices[_entries[i].Entity] = (uint32_t)i;
+	}
+
+	_dirty = false;
+	_sortCount++;
+}
+
+void RenderQueue::OnRendererChanged(entt::registry& registry, entt::entity entity)
+{
+	_dirty = true;
+}
+
+void RenderQueue::RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+{
+	const int DIGITS = sizeof(uint64_t);
+	const int BUCKETS = 256;
+
+	size_t count = entries.size();
+	if (count < 2)
+		return;
+
+	//Counts every digit in a single pass
+	size_t histograms[DIGITS][BUCKETS] = {};
+	for (const Entry& entry : entries)
+	{
+		for (int digit = 0; digit < DIGITS; digit++)
+		{
+			histograms[digit][(entry.Key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	scratch.resize(count);
+	std::vector<Entry>* from = &entries;
+	std::vector<Entry>* to = &scratch;
+
+	for (int digit = 0; digit < DIGITS; digit++)
+	{
+		size_t* histogram = histograms[digit];
+
+		//If every key shares this digit the pass wouldn't move anything
+		if (histogram[((*from)[0].Key >> (digit * 8)) & 0xFF] == count)
+			continue;
+
+		//Turns the counts into starting offsets
+		size_t offset = 0;
+		for (int bucket = 0; bucket < BUCKETS; bucket++)
+		{
+			size_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		//Stable scatter into the other buffer
+		for (const Entry& entry : *from)
+		{
+			(*to)[histogram[(entry.Key >> (digit * 8)) & 0xFF]++] = entry;
+		}
+
+		std::swap(from, to);
+	}
+
+	//Makes sure the result ends up back in entries
+	if (from != &entries)
+	{
+		entries.swap(scratch);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <Transform.h>
+#include <RendererComponent.h>
+
+//Keeps the renderers of a registry sorted by a packed 64 bit key
+//*Key is layer (8) | shader id (12) | material id (16) | depth (28)
+//*Only re-sorts when renderers get added, removed or change material (or every frame with depth sorting on)
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	//Starts tracking the renderers in the registry
+	void Init(entt::registry& registry);
+	//Stops tracking the registry
+	void Unload();
+
+	//Forces a re-sort on the next update
+	//*Needed after changing a material's shader or render layer, since we don't chase those every frame
+	void MarkDirty();
+
+	//Sorts front to back within each material
+	//*Positions change every frame so this re-sorts every frame
+	void SetDepthSorting(bool depthSorting);
+	bool GetDepthSorting() const;
+
+	//Checks for changes and re-sorts if needed
+	void Update(const glm::vec3& cameraPos);
+
+	//Calls func(entity, renderer, transform) for every renderer in sorted order
+	template <typename Func>
+	void Each(Func func)
+	{
+		for (entt::entity entity : _sorted)
+		{
+			func(entity, _registry->get<RendererComponent>(entity), _registry->get<Transform>(entity));
+		}
+	}
+
+	//The entities in sorted order
+	const std::vector<entt::entity>& GetSorted() const;
+	//Where an entity is in the sorted order (-1 if it isn't a renderer we've sorted)
+	int GetDrawIndex(entt::entity entity) const;
+	//How many times we had to sort (for debugging)
+	int GetSortCount() const;
+
+	//How far away depth sorting can tell objects apart
+	static const float MAX_SORT_DEPTH;
+private:
+	//Packs a key for a renderer
+	uint64_t BuildKey(const RendererComponent& renderer, float depth);
+	//Gets a small id for a shader/material (assigned the first time we see it)
+	uint64_t GetShaderID(const Shader* shader);
+	uint64_t GetMaterialID(const ShaderMaterial* material);
+
+	//Rebuilds every key and sorts
+	void Rebuild(const glm::vec3& cameraPos);
+
+	//Registry callbacks for renderers being added and removed
+	void OnRendererChanged(entt::registry& registry, entt::entity entity);
+
+	struct Entry
+	{
+		uint64_t Key;
+		entt::entity Entity;
+	};
+	//Least significant digit radix sort on the keys (skips digits every key shares)
+	static void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+
+	//The registry we're tracking
+	entt::registry* _registry = nullptr;
+
+	//The keys and entities (scratch is for the radix sort)
+	std::vector<Entry> _entries;
+	std::vector<Entry> _scratch;
+	//The sorted entities, and where each one is in the order
+	std::vector<entt::entity> _sorted;
+	std::unordered_map<entt::entity, uint32_t> _drawIndices;
+	//The material each renderer had when we sorted (in the renderer pool's order)
+	std::vector<const ShaderMaterial*> _materials;
+
+	//Small ids for the shaders and materials
+	std::unordered_map<const Shader*, uint64_t> _shaderIDs;
+	std::unordered_map<const ShaderMaterial*, uint64_t> _materialIDs;
+
+	//Do we need to re-sort
+	bool _dirty = true;
+	//Are we sorting by depth too
+	bool _depthSorting = false;
+	//How many times we sorted
+	int _sortCount = 0;
+};
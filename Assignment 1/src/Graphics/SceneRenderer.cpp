@@ -0,0 +1,345 @@
+#include "SceneRenderer.h"
+#include <Camera.h>
+#include "Graphics/LODChain.h"
+#include "Graphics/TransformStream.h"
+#include "Graphics/TextureStreamer.h"
+#include "Utilities/EnvironmentGenerator.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/Profiler.h"
+#include "Utilities/BackendHandler.h"
+#include "Utilities/AssetCache.h"
+
+SceneRenderer::SceneRenderer()
+{
+	_staticGeometry.SetEnabled(true);
+}
+
+SceneRenderer::~SceneRenderer()
+{
+	Unload();
+}
+
+void SceneRenderer::Init(entt::registry& registry)
+{
+	_registry = &registry;
+	//The render queue keeps our renderers sorted, and only re-sorts when they change
+	_renderQueue.Init(registry);
+	_spatialIndex.Init(registry);
+	_staticGeometry.Init(registry);
+}
+
+void SceneRenderer::Unload()
+{
+	_renderQueue.Unload();
+	_spatialIndex.Unload();
+	_staticGeometry.Unload();
+	_postEffects.Unload();
+	_frameGraph.Unload();
+	_lightBuffer.Unload();
+	_lightClusters.Unload();
+	_currentShader = nullptr;
+	_currentMaterial = nullptr;
+	_registry = nullptr;
+}
+
+void SceneRenderer::Render(entt::entity camera, Framebuffer& target)
+{
+	if (_registry == nullptr)
+		return;
+	entt::registry& registry = *_registry;
+
+	//Clear the screen
+	target.Clear();
+
+	glClearColor(_clearColor.x, _clearColor.y, _clearColor.z, _clearColor.w);
+	glEnable(GL_DEPTH_TEST);
+	glClearDepth(1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//Upload a few more rows of any textures that are streaming in, and load and unload the environment tiles around the camera
+	Profiler::BeginScope("Streaming");
+	TextureStreamer::Poll();
+	EnvironmentGenerator::UpdateStreaming(registry.get<Transform>(camera).GetLocalPosition());
+	Profiler::EndScope();
+
+	//Update the world matrices that can change this frame (static ones only when they're marked dirty)
+	Profiler::BeginScope("Transforms");
+	TransformSystem::Update(registry);
+	Profiler::EndScope();
+
+	Transform& camTransform = registry.get<Transform>(camera);
+	glm::mat4 view = glm::inverse(camTransform.LocalTransform());
+	glm::mat4 projection = registry.get<Camera>(camera).GetProjection();
+	glm::mat4 viewProjection = projection * view;
+	glm::vec3 cameraPos = glm::vec3(camTransform.WorldTransform()[3]);
+
+	//Sort the renderers by layer, shader and material (this only actually sorts when renderers get added, removed or change material)
+	Profiler::BeginScope("Sort");
+	_renderQueue.Update(cameraPos);
+	Profiler::EndScope();
+
+	//Pick each object's level of detail, then fit bounds to any new renderers and throw out everything that's off screen
+	Profiler::BeginScope("Visibility");
+	LODSystem::Update(registry, cameraPos, projection);
+	_culler.UpdateBounds(registry);
+	_spatialIndex.Update(_culler.GetRefitted());
+	_staticGeometry.Update();
+	_culler.Cull(registry, _renderQueue, viewProjection, &_spatialIndex);
+	Profiler::EndScope();
+
+	//Gather the point lights and bin them into clusters, so each pixel only loops over the lights that reach it
+	Profiler::BeginScope("Lights");
+	_lightBuffer.Update(registry);
+	_lightClusters.Build(_lightBuffer.GetLights(), view, projection, target._width, target._height);
+	Profiler::EndScope();
+
+	//Grab this frame's region of the transform stream
+	Profiler::BeginScope("Draw Submission");
+	TransformStream::BeginFrame();
+	_batchesCulled = 0;
+
+	//Declare this frame's passes, the graph hands the transient targets out and runs them in order
+	_frameGraph.BeginFrame();
+	FrameGraph::Target scene = _frameGraph.Import("Scene", target);
+	bool deferred = _deferred && _deferredShader != nullptr;
+	if (deferred)
+	{
+		//The G-buffer matches what's being drawn of the target, so the depth can be copied straight across
+		TargetDesc gBufferDesc;
+		gBufferDesc.Width = target._width;
+		gBufferDesc.Height = target._height;
+		gBufferDesc.ColorFormats = { GBUFFER_ALBEDO, GBUFFER_NORMAL };
+		gBufferDesc.Depth = true;
+		FrameGraph::Target gBuffer = _frameGraph.CreateTarget("G-Buffer", gBufferDesc);
+
+		//Write the surfaces that use the deferred shader, with no lighting
+		int geometryPass = _frameGraph.AddPass("G-Buffer", [=]() {
+			Framebuffer& buffer = _frameGraph.Get(gBuffer);
+			buffer.Clear();
+			buffer.Bind();
+			buffer.SetViewport();
+			glEnable(GL_DEPTH_TEST);
+			_writingGBuffer = true;
+			DrawScene(DrawFilter::Deferred, view, projection, cameraPos);
+			_writingGBuffer = false;
+			buffer.Unbind();
+		});
+		_frameGraph.Write(geometryPass, gBuffer);
+
+		//Light every pixel once
+		int lightingPass = _frameGraph.AddPass("Lighting", [=]() {
+			LightGBuffer(_frameGraph.Get(gBuffer), _frameGraph.Get(scene), view, viewProjection, cameraPos);
+		});
+		_frameGraph.Read(lightingPass, gBuffer);
+		_frameGraph.Write(lightingPass, scene);
+	}
+
+	//Draw everything the G-buffer didn't take (in forward mode that's everything)
+	int scenePass = _frameGraph.AddPass("Scene", [=, &target]() {
+		//The target can be bigger than what we're drawing, so only draw into the part in use
+		target.Bind();
+		target.SetViewport();
+		glEnable(GL_DEPTH_TEST);
+		DrawScene(deferred ? DrawFilter::Forward : DrawFilter::All, view, projection, cameraPos);
+		target.Unbind();
+	});
+	_frameGraph.Write(scenePass, scene);
+
+	//Then run the post effects and put the result on the screen
+	_postEffects.AddPasses(_frameGraph, scene);
+	_frameGraph.Execute();
+
+	//We're done pushing transforms for this frame
+	TransformStream::EndFrame();
+	Profiler::EndScope();
+}
+
+void SceneRenderer::SetClearColor(const glm::vec4& color)
+{
+	_clearColor = color;
+}
+
+FrustumCuller& SceneRenderer::GetCuller()
+{
+	return _culler;
+}
+
+SpatialIndex& SceneRenderer::GetSpatialIndex()
+{
+	return _spatialIndex;
+}
+
+StaticGeometry& SceneRenderer::GetStaticGeometry()
+{
+	return _staticGeometry;
+}
+
+PostEffectChain& SceneRenderer::GetPostEffects()
+{
+	return _postEffects;
+}
+
+FrameGraph& SceneRenderer::GetFrameGraph()
+{
+	return _frameGraph;
+}
+
+LightBuffer& SceneRenderer::GetLightBuffer()
+{
+	return _lightBuffer;
+}
+
+LightClusters& SceneRenderer::GetLightClusters()
+{
+	return _lightClusters;
+}
+
+int SceneRenderer::GetBatchesCulled() const
+{
+	return _batchesCulled;
+}
+
+void SceneRenderer::SetDeferred(bool deferred)
+{
+	_deferred = deferred;
+}
+
+bool SceneRenderer::GetDeferred() const
+{
+	return _deferred;
+}
+
+void SceneRenderer::SetDeferredShader(const Shader::sptr& shader)
+{
+	_deferredShader = shader;
+}
+
+const Shader::sptr& SceneRenderer::GetLightingShader()
+{
+	//Loaded the first time it's needed
+	if (_lightingShader == nullptr)
+	{
+		_lightingShader = AssetCache::GetShader("shaders/passthrough_vert.glsl", "shaders/deferred_lighting_frag.glsl");
+	}
+	return _lightingShader;
+}
+
+void SceneRenderer::DrawScene(DrawFilter filter, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos)
+{
+	//Start by assuming no shader or material is applied
+	_currentShader = nullptr;
+	_currentMaterial = nullptr;
+
+	//Draw the sorted renderers that are on screen
+	size_t drawIndex = 0;
+	_renderQueue.Each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
+		bool visible = _culler.IsVisible(drawIndex++);
+		//Merged static renderers get drawn all together below, they just need to know if they're on screen
+		if (_staticGeometry.IsMerged(e))
+		{
+			_staticGeometry.SetVisible(e, visible);
+			return;
+		}
+		if (!visible || !Accepts(filter, renderer.Material))
+			return;
+		Apply(renderer.Material, view, projection);
+		BackendHandler::RenderVAO(renderer.Mesh, transform);
+	});
+
+	//Draw the merged static renderers, one draw call per material
+	for (size_t group = 0; group < _staticGeometry.GetGroupCount(); group++)
+	{
+		if (!Accepts(filter, _staticGeometry.GetGroupMaterial(group)))
+			continue;
+		Apply(_staticGeometry.GetGroupMaterial(group), view, projection);
+		_staticGeometry.RenderGroup(group);
+	}
+
+	//Draw the instanced environment, one draw call per object type
+	for (const InstanceBatch::sptr& batch : EnvironmentGenerator::GetInstanceBatches())
+	{
+		if (!Accepts(filter, batch->GetMaterial()))
+			continue;
+		glm::vec3 batchCentre;
+		float batchRadius;
+		if (batch->GetBounds(batchCentre, batchRadius) && !_culler.TestSphere(batchCentre, batchRadius))
+		{
+			_batchesCulled++;
+			continue;
+		}
+		batch->UpdateLOD(cameraPos, projection);
+		Apply(batch->GetMaterial(), view, projection);
+		batch->Render();
+	}
+}
+
+bool SceneRenderer::Accepts(DrawFilter filter, const ShaderMaterial::sptr& material) const
+{
+	switch (filter)
+	{
+	case DrawFilter::Deferred:
+		return material->Shader == _deferredShader;
+	case DrawFilter::Forward:
+		return material->Shader != _deferredShader;
+	default:
+		return true;
+	}
+}
+
+void SceneRenderer::LightGBuffer(Framebuffer& gBuffer, Framebuffer& output, const glm::mat4& view, const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+{
+	const Shader::sptr& shader = GetLightingShader();
+
+	output.Bind();
+	output.SetViewport();
+	//The sky's pixels get discarded, and keep the colour the target was cleared to
+	glDisable(GL_DEPTH_TEST);
+
+	shader->Bind();
+	gBuffer.BindColorAsTexture(0, 0);
+	gBuffer.BindColorAsTexture(1, 1);
+	gBuffer.BindDepthAsTexture(2);
+	shader->SetUniform("s_GAlbedo", 0);
+	shader->SetUniform("s_GNormal", 1);
+	shader->SetUniform("s_GDepth", 2);
+	shader->SetUniform("u_UVScale", gBuffer.GetUVScale());
+	shader->SetUniformMatrix("u_InverseViewProjection", glm::inverse(viewProjection));
+	shader->SetUniform("u_CamPos", cameraPos);
+	shader->SetUniformMatrix("u_View", view);
+	_lightBuffer.Bind(shader);
+	_lightClusters.Bind(shader);
+
+	Framebuffer::DrawFullscreenQuad();
+
+	gBuffer.UnbindTexture(0);
+	gBuffer.UnbindTexture(1);
+	gBuffer.UnbindTexture(2);
+	glEnable(GL_DEPTH_TEST);
+
+	//Forward renderers (like the skybox) get depth tested against the G-buffer's surfaces
+	gBuffer.CopyDepthTo(output);
+}
+
+void SceneRenderer::Apply(const ShaderMaterial::sptr& material, const glm::mat4& view, const glm::mat4& projection)
+{
+	//If the shader has changed, set up its uniforms
+	if (_currentShader != material->Shader)
+	{
+		_currentShader = material->Shader;
+		_currentShader->Bind();
+		BackendHandler::SetupShaderForFrame(_currentShader, view, projection);
+		//The deferred shader only lights in the forward pass, with the clustered point lights
+		if (_currentShader == _deferredShader)
+		{
+			_currentShader->SetUniform("u_GBufferPass", _writingGBuffer ? 1 : 0);
+			_lightBuffer.Bind(_currentShader);
+			_lightClusters.Bind(_currentShader);
+		}
+	}
+	//If the material has changed, apply it
+	if (_currentMaterial != material)
+	{
+		_currentMaterial = material;
+		_currentMaterial->Apply();
+	}
+}
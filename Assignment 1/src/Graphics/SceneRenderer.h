@@ -0,0 +1,104 @@
+#pragma once
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include "Graphics/Framebuffer.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/FrustumCuller.h"
+#include "Graphics/StaticGeometry.h"
+#include "Graphics/FrameGraph.h"
+#include "Graphics/LightBuffer.h"
+#include "Graphics/LightClusters.h"
+#include "Graphics/Post/PostEffectChain.h"
+#include "Utilities/SpatialIndex.h"
+
+//Draws a frame of a registry from a camera, the same way whether it's the game window or the benchmark
+//*Owns the systems that track the scene (sorting, culling, the spatial index and merged static geometry) and the post effects
+//*Each phase is wrapped in a profiler scope, so the benchmark can report them
+//*In deferred mode everything using the deferred shader gets written to a G-buffer, then lit in one full screen pass
+// (so lighting costs per pixel instead of per object per light), and everything else is drawn forward over it
+//*Point lights get binned into view frustum clusters every frame, and both paths only light a pixel with its cluster's lights
+class SceneRenderer
+{
+public:
+	SceneRenderer();
+	~SceneRenderer();
+
+	//Starts tracking the renderers in the registry
+	void Init(entt::registry& registry);
+	//Stops tracking the registry, and frees the merged buffers and post effect targets
+	void Unload();
+
+	//Streams, updates transforms, sorts, culls and draws the scene into target, then runs the post effects to the back buffer
+	//*camera needs a Transform and a Camera
+	void Render(entt::entity camera, Framebuffer& target);
+
+	//What the scene gets cleared to
+	void SetClearColor(const glm::vec4& color);
+
+	//Turns deferred shading on or off
+	void SetDeferred(bool deferred);
+	bool GetDeferred() const;
+	//The shader that can write the G-buffer (frag_phong.glsl), materials using anything else are drawn forward
+	void SetDeferredShader(const Shader::sptr& shader);
+	//The full screen shader that lights the G-buffer, it takes the same light uniforms as the deferred shader
+	const Shader::sptr& GetLightingShader();
+
+	FrustumCuller& GetCuller();
+	SpatialIndex& GetSpatialIndex();
+	StaticGeometry& GetStaticGeometry();
+	PostEffectChain& GetPostEffects();
+	//The passes after the scene is drawn, and the transient targets they share
+	FrameGraph& GetFrameGraph();
+	//The point lights gathered last frame, and the clusters they were binned into
+	LightBuffer& GetLightBuffer();
+	LightClusters& GetLightClusters();
+	//How many instance batches were off screen last frame
+	int GetBatchesCulled() const;
+
+	//The G-buffer's colour targets, albedo and specular intensity then the octahedral normal and shininess
+	static const GLenum GBUFFER_ALBEDO = GL_RGBA8;
+	static const GLenum GBUFFER_NORMAL = GL_RGB10_A2;
+private:
+	//Which renderers a draw pass takes
+	enum class DrawFilter
+	{
+		All,
+		//Only the ones using the deferred shader
+		Deferred,
+		//Only the ones that aren't
+		Forward
+	};
+
+	//Draws the visible renderers, merged static groups and instance batches that pass the filter into whatever's bound
+	void DrawScene(DrawFilter filter, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+	//Does a material go in a pass
+	bool Accepts(DrawFilter filter, const ShaderMaterial::sptr& material) const;
+	//Lights the G-buffer into output, then copies its depth over so forward renderers are hidden behind it
+	void LightGBuffer(Framebuffer& gBuffer, Framebuffer& output, const glm::mat4& view, const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+	//Binds a shader and material if they aren't already
+	void Apply(const ShaderMaterial::sptr& material, const glm::mat4& view, const glm::mat4& projection);
+
+	entt::registry* _registry = nullptr;
+
+	RenderQueue _renderQueue;
+	FrustumCuller _culler;
+	SpatialIndex _spatialIndex;
+	StaticGeometry _staticGeometry;
+	PostEffectChain _postEffects;
+	FrameGraph _frameGraph;
+	LightBuffer _lightBuffer;
+	LightClusters _lightClusters;
+
+	bool _deferred = false;
+	Shader::sptr _deferredShader;
+	Shader::sptr _lightingShader;
+	//Is the deferred shader writing the G-buffer right now
+	bool _writingGBuffer = false;
+
+	//What's bound right now while drawing
+	Shader::sptr _currentShader;
+	ShaderMaterial::sptr _currentMaterial;
+
+	glm::vec4 _clearColor = glm::vec4(0.08f, 0.17f, 0.31f, 1.0f);
+	int _batchesCulled = 0;
+};
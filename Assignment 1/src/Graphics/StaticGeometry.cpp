@@ -0,0 +1,430 @@
+#include "StaticGeometry.h"
+#include <algorithm>
+#include <unordered_set>
+#include <Logging.h>
+#include "Graphics/MeshCache.h"
+#include "Graphics/LODChain.h"
+#include "Graphics/TransformStream.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/Profiler.h"
+
+StaticGeometry::StaticGeometry()
+{
+}
+
+StaticGeometry::~StaticGeometry()
+{
+	Unload();
+}
+
+void StaticGeometry::Init(entt::registry& registry)
+{
+	//Makes sure we aren't hooked into another registry
+	Unload();
+
+	_registry = &registry;
+	//Renderers and static transforms coming or going means the commands need rebuilding
+	_registry->on_construct<RendererComponent>().connect<&StaticGeometry::OnSceneChanged>(*this);
+	_registry->on_destroy<RendererComponent>().connect<&StaticGeometry::OnSceneChanged>(*this);
+	_registry->on_construct<StaticTransform>().connect<&StaticGeometry::OnSceneChanged>(*this);
+	_registry->on_destroy<StaticTransform>().connect<&StaticGeometry::OnSceneChanged>(*this);
+
+	_dirty = true;
+}
+
+void StaticGeometry::Unload()
+{
+	Clear();
+
+	if (_registry != nullptr)
+	{
+		_registry->on_construct<RendererComponent>().disconnect<&StaticGeometry::OnSceneChanged>(*this);
+		_registry->on_destroy<RendererComponent>().disconnect<&StaticGeometry::OnSceneChanged>(*this);
+		_registry->on_construct<StaticTransform>().disconnect<&StaticGeometry::OnSceneChanged>(*this);
+		_registry->on_destroy<StaticTransform>().disconnect<&StaticGeometry::OnSceneChanged>(*this);
+		_registry = nullptr;
+	}
+}
+
+void StaticGeometry::SetEnabled(bool enabled)
+{
+	if (enabled == _enabled)
+		return;
+
+	_enabled = enabled;
+	if (_enabled)
+	{
+		_dirty = true;
+	}
+	else
+	{
+		Clear();
+	}
+}
+
+bool StaticGeometry::GetEnabled() const
+{
+	return _enabled;
+}
+
+void StaticGeometry::Update()
+{
+	PROFILE_SCOPE("Static Geometry");
+	if (_registry == nullptr || !_enabled)
+		return;
+
+	//Looks for material and mesh swaps (only compares pointers)
+	//*A mesh that's already merged (like another level of its LOD chain) just gets its command pointed at it
+	for (size_t i = 0; i < _entities.size() && !_dirty; i++)
+	{
+		const RendererComponent& renderer = _registry->get<RendererComponent>(_entities[i]);
+		if (renderer.Material.get() != _entityMaterials[i])
+		{
+			_dirty = true;
+		}
+		else if (renderer.Mesh.get() != _entityMeshes[i])
+		{
+			if (_meshRanges.find(renderer.Mesh.get()) != _meshRanges.end())
+				SetMesh(i, renderer.Mesh.get());
+			else
+				_dirty = true;
+		}
+	}
+
+	//Rebuilding reads every transform anyway
+	if (_dirty)
+	{
+		Rebuild();
+		return;
+	}
+
+	//Follow whatever moved
+	for (entt::entity entity : TransformSystem::GetLastUpdated())
+	{
+		const MergedDraw* draw = _registry->try_get<MergedDraw>(entity);
+		if (draw != nullptr)
+		{
+			SetTransform(draw->Command, _registry->get<Transform>(entity));
+		}
+	}
+}
+
+bool StaticGeometry::IsMerged(entt::entity entity) const
+{
+	return _enabled && _registry != nullptr && _registry->has<MergedDraw>(entity);
+}
+
+void StaticGeometry::SetVisible(entt::entity entity, bool visible)
+{
+	//Hidden commands just draw no instances
+	uint32_t command = _registry->get<MergedDraw>(entity).Command;
+	GLuint instanceCount = visible ? 1 : 0;
+	if (_commands[command].InstanceCount != instanceCount)
+	{
+		_commands[command].InstanceCount = instanceCount;
+		_dirtyCommands.Add(command);
+	}
+}
+
+size_t StaticGeometry::GetGroupCount() const
+{
+	return _groups.size();
+}
+
+const ShaderMaterial::sptr& StaticGeometry::GetGroupMaterial(size_t group) const
+{
+	return _groups[group].Material;
+}
+
+void StaticGeometry::RenderGroup(size_t group)
+{
+	UploadChanges();
+
+	//Makes sure the merged VAO can read its draw ID, the base instance of each command picks its transform
+	TransformStream::PrepareVAO(_vao);
+
+	_vao->Bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBatch::INSTANCE_BINDING, _instanceBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(_groups[group].FirstCommand * sizeof(DrawElementsCommand)),
+		(GLsizei)_groups[group].CommandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+	VertexArrayObject::UnBind();
+
+	//Gives the transform stream its binding back
+	TransformStream::Bind();
+}
+
+int StaticGeometry::GetMergedCount() const
+{
+	return (int)_commands.size();
+}
+
+int StaticGeometry::GetMeshCount() const
+{
+	return (int)_meshRanges.size();
+}
+
+int StaticGeometry::GetRebuildCount() const
+{
+	return _rebuildCount;
+}
+
+void StaticGeometry::DirtyRange::Add(size_t index)
+{
+	Begin = std::min(Begin, index);
+	End = std::max(End, index + 1);
+}
+
+bool StaticGeometry::DirtyRange::IsEmpty() const
+{
+	return Begin >= End;
+}
+
+void StaticGeometry::DirtyRange::Clear()
+{
+	Begin = SIZE_MAX;
+	End = 0;
+}
+
+void StaticGeometry::Rebuild()
+{
+	_dirty = false;
+	_rebuildCount++;
+	_registry->clear<MergedDraw>();
+
+	//Every static renderer whose meshes we can merge
+	//*Each one's draw ID comes from the transform stream's draw ID buffer, so there can't be more than it has
+	std::vector<entt::entity> entities;
+	std::vector<VertexArrayObject::sptr> meshes;
+	std::unordered_set<const VertexArrayObject*> seen;
+	size_t maxCommands = TransformStream::GetMaxDraws();
+	MeshBuffers buffers;
+	auto view = _registry->view<StaticTransform, RendererComponent, Transform>();
+	for (entt::entity entity : view)
+	{
+		const RendererComponent& renderer = view.get<RendererComponent>(entity);
+		if (renderer.Material == nullptr || !MeshCache::GetBuffers(renderer.Mesh, buffers))
+			continue;
+
+		//Every mesh it can swap to has to be merged too
+		std::vector<VertexArrayObject::sptr> entityMeshes = { renderer.Mesh };
+		const LODGroup* lod = _registry->try_get<LODGroup>(entity);
+		if (lod != nullptr && lod->Chain != nullptr)
+		{
+			for (int level = 0; level < lod->Chain->GetLevelCount(); level++)
+			{
+				entityMeshes.push_back(lod->Chain->GetMesh(level));
+			}
+		}
+		bool mergeable = true;
+		for (const VertexArrayObject::sptr& mesh : entityMeshes)
+		{
+			mergeable = mergeable && MeshCache::GetBuffers(mesh, buffers);
+		}
+		if (!mergeable)
+			continue;
+
+		if (entities.size() >= maxCommands)
+		{
+			LOG_WARN("Too many static renderers to merge ({}), the rest draw on their own", maxCommands);
+			break;
+		}
+
+		entities.push_back(entity);
+		for (const VertexArrayObject::sptr& mesh : entityMeshes)
+		{
+			if (seen.insert(mesh.get()).second)
+			{
+				meshes.push_back(mesh);
+			}
+		}
+	}
+
+	//Groups by shader then material, and keeps the same meshes next to each other within a material
+	std::sort(entities.begin(), entities.end(), [&](entt::entity a, entt::entity b) {
+		const RendererComponent& rendererA = _registry->get<RendererComponent>(a);
+		const RendererComponent& rendererB = _registry->get<RendererComponent>(b);
+		if (rendererA.Material->Shader != rendererB.Material->Shader)
+			return rendererA.Material->Shader < rendererB.Material->Shader;
+		if (rendererA.Material != rendererB.Material)
+			return rendererA.Material < rendererB.Material;
+		return rendererA.Mesh < rendererB.Mesh;
+	});
+
+	//Only copy the meshes again if the set of them changed
+	bool remerge = meshes.size() != _meshRanges.size();
+	for (size_t i = 0; i < meshes.size() && !remerge; i++)
+	{
+		remerge = _meshRanges.find(meshes[i].get()) == _meshRanges.end();
+	}
+	if (remerge)
+	{
+		MergeMeshes(meshes);
+	}
+
+	//One command and transform per entity, in the same order
+	size_t count = entities.size();
+	_commands.assign(count, DrawElementsCommand());
+	_instances.resize(count);
+	_entities = entities;
+	_entityMaterials.resize(count);
+	_entityMeshes.resize(count);
+	_groups.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		const RendererComponent& renderer = _registry->get<RendererComponent>(entities[i]);
+		_entityMaterials[i] = renderer.Material.get();
+		_commands[i].InstanceCount = 1;
+		_commands[i].BaseInstance = (GLuint)i;
+		SetMesh(i, renderer.Mesh.get());
+		SetTransform(i, _registry->get<Transform>(entities[i]));
+		_registry->emplace<MergedDraw>(entities[i], (uint32_t)i);
+
+		if (_groups.empty() || _groups.back().Material != renderer.Material)
+		{
+			_groups.push_back({ renderer.Material, i, 0 });
+		}
+		_groups.back().CommandCount++;
+	}
+
+	//Everything changed, so upload it all in one go
+	if (_commandBuffer == GL_NONE)
+	{
+		glGenBuffers(1, &_commandBuffer);
+		glGenBuffers(1, &_instanceBuffer);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsCommand), _commands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, _instances.size() * sizeof(InstanceData), _instances.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+	_dirtyCommands.Clear();
+	_dirtyInstances.Clear();
+}
+
+void StaticGeometry::MergeMeshes(const std::vector<VertexArrayObject::sptr>& meshes)
+{
+	std::vector<VertexPosNormTexCol> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<uint16_t> shortIndices;
+	_meshRanges.clear();
+
+	//Reads each mesh back off the GPU (this only happens when a new mesh shows up)
+	//*Indices stay relative to their own mesh, each command's base vertex moves them to where it landed
+	for (const VertexArrayObject::sptr& mesh : meshes)
+	{
+		MeshBuffers buffers;
+		MeshCache::GetBuffers(mesh, buffers);
+
+		MeshRange range;
+		range.FirstIndex = (GLuint)indices.size();
+		range.IndexCount = buffers.IndexCount;
+		range.BaseVertex = (GLint)vertices.size();
+		_meshRanges[mesh.get()] = range;
+
+		vertices.resize(vertices.size() + buffers.VertexCount);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffers.VertexBuffer);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, buffers.VertexCount * sizeof(VertexPosNormTexCol), vertices.data() + range.BaseVertex);
+
+		//16 bit indices get widened, so every mesh can share one index type
+		glBindBuffer(GL_COPY_READ_BUFFER, buffers.IndexBuffer);
+		if (buffers.IndexSize == 2)
+		{
+			shortIndices.resize(buffers.IndexCount);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, buffers.IndexCount * sizeof(uint16_t), shortIndices.data());
+			indices.insert(indices.end(), shortIndices.begin(), shortIndices.end());
+		}
+		else
+		{
+			indices.resize(indices.size() + buffers.IndexCount);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, buffers.IndexCount * sizeof(uint32_t), indices.data() + range.FirstIndex);
+		}
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, GL_NONE);
+
+	_meshes = meshes;
+
+	VertexBuffer::sptr vbo = VertexBuffer::Create();
+	vbo->LoadData(vertices.data(), vertices.size());
+	IndexBuffer::sptr ibo = IndexBuffer::Create();
+	ibo->LoadData(indices.data(), indices.size());
+
+	_vao = VertexArrayObject::Create();
+	_vao->AddVertexBuffer(vbo, VertexPosNormTexCol::V_DECL);
+	_vao->SetIndexBuffer(ibo);
+}
+
+void StaticGeometry::Clear()
+{
+	if (_registry != nullptr)
+	{
+		_registry->clear<MergedDraw>();
+	}
+
+	if (_commandBuffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_commandBuffer);
+		glDeleteBuffers(1, &_instanceBuffer);
+		_commandBuffer = GL_NONE;
+		_instanceBuffer = GL_NONE;
+	}
+
+	_vao = nullptr;
+	_meshRanges.clear();
+	_meshes.clear();
+	_commands.clear();
+	_instances.clear();
+	_entities.clear();
+	_entityMaterials.clear();
+	_entityMeshes.clear();
+	_groups.clear();
+	_dirtyCommands.Clear();
+	_dirtyInstances.Clear();
+	_dirty = true;
+}
+
+void StaticGeometry::UploadChanges()
+{
+	//Only the span that changed, which is usually a handful of commands on the edge of the screen
+	if (!_dirtyCommands.IsEmpty())
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, _dirtyCommands.Begin * sizeof(DrawElementsCommand),
+			(_dirtyCommands.End - _dirtyCommands.Begin) * sizeof(DrawElementsCommand), &_commands[_dirtyCommands.Begin]);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GL_NONE);
+		_dirtyCommands.Clear();
+	}
+
+	if (!_dirtyInstances.IsEmpty())
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _instanceBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, _dirtyInstances.Begin * sizeof(InstanceData),
+			(_dirtyInstances.End - _dirtyInstances.Begin) * sizeof(InstanceData), &_instances[_dirtyInstances.Begin]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+		_dirtyInstances.Clear();
+	}
+}
+
+void StaticGeometry::SetMesh(size_t command, const VertexArrayObject* mesh)
+{
+	const MeshRange& range = _meshRanges.at(mesh);
+	_commands[command].Count = range.IndexCount;
+	_commands[command].FirstIndex = range.FirstIndex;
+	_commands[command].BaseVertex = range.BaseVertex;
+	_entityMeshes[command] = mesh;
+	_dirtyCommands.Add(command);
+}
+
+void StaticGeometry::SetTransform(size_t slot, const Transform& transform)
+{
+	_instances[slot].Model = transform.WorldTransform();
+	_instances[slot].NormalMatrix = glm::mat4(transform.WorldNormalMatrix());
+	_dirtyInstances.Add(slot);
+}
+
+void StaticGeometry::OnSceneChanged(entt::registry& registry, entt::entity entity)
+{
+	_dirty = true;
+}
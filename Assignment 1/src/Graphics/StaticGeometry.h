@@ -0,0 +1,141 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <glad/glad.h>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+#include <ShaderMaterial.h>
+#include <RendererComponent.h>
+#include <Transform.h>
+#include "Graphics/InstanceBatch.h"
+
+//Which draw command (and transform slot) a merged entity got
+struct MergedDraw
+{
+	uint32_t Command;
+};
+
+//What glMultiDrawElementsIndirect reads for each draw
+struct DrawElementsCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+//Draws the static renderers out of one shared vertex and index buffer, one glMultiDrawElementsIndirect per material
+//*Every static entity whose mesh came through MeshCache gets merged (along with every mesh its LOD chain can swap to)
+//*Each entity gets a draw command, whose base instance points at its transform in our own instance buffer
+//*The commands only get rebuilt when merged entities come, go or change material
+//*Moving, LOD swaps and being culled just patch the entity's transform or command, and only what changed gets uploaded
+class StaticGeometry
+{
+public:
+	StaticGeometry();
+	~StaticGeometry();
+
+	//Starts tracking the static renderers in the registry
+	void Init(entt::registry& registry);
+	//Stops tracking the registry and frees the buffers
+	void Unload();
+
+	//Turning it off goes back to drawing every renderer on its own
+	void SetEnabled(bool enabled);
+	bool GetEnabled() const;
+
+	//Rebuilds the commands if the scene changed, and follows any moves and mesh swaps
+	//*Call after TransformSystem::Update and LODSystem::Update
+	void Update();
+
+	//Whether an entity is drawn by us (skip it when drawing renderers one by one)
+	bool IsMerged(entt::entity entity) const;
+	//Shows or hides a merged entity (from the frustum culler)
+	void SetVisible(entt::entity entity, bool visible);
+
+	//Every material gets its own group of commands
+	size_t GetGroupCount() const;
+	const ShaderMaterial::sptr& GetGroupMaterial(size_t group) const;
+	//Draws a group with one call
+	//*Expects the group's shader and material to already be applied
+	void RenderGroup(size_t group);
+
+	//How many entities are merged, how many meshes are in the buffers, and how many times the commands got rebuilt
+	int GetMergedCount() const;
+	int GetMeshCount() const;
+	int GetRebuildCount() const;
+private:
+	//Where a mesh is in the merged buffers
+	struct MeshRange
+	{
+		GLuint FirstIndex;
+		GLuint IndexCount;
+		GLint BaseVertex;
+	};
+
+	//The commands for one material
+	struct Group
+	{
+		ShaderMaterial::sptr Material;
+		size_t FirstCommand;
+		size_t CommandCount;
+	};
+
+	//The part of a buffer that changed since it was last uploaded
+	struct DirtyRange
+	{
+		size_t Begin = SIZE_MAX;
+		size_t End = 0;
+
+		void Add(size_t index);
+		bool IsEmpty() const;
+		void Clear();
+	};
+
+	//Gathers the static renderers and rebuilds every command (and the merged buffers, if there's a new mesh)
+	void Rebuild();
+	//Copies every mesh into the merged buffers
+	void MergeMeshes(const std::vector<VertexArrayObject::sptr>& meshes);
+	//Takes every entity out, and frees the buffers
+	void Clear();
+	//Uploads the commands and transforms that changed
+	void UploadChanges();
+
+	//Points a command at a mesh
+	void SetMesh(size_t command, const VertexArrayObject* mesh);
+	//Writes an entity's transform into its slot
+	void SetTransform(size_t slot, const Transform& transform);
+
+	//Registry callbacks for renderers and static transforms being added and removed
+	void OnSceneChanged(entt::registry& registry, entt::entity entity);
+
+	entt::registry* _registry = nullptr;
+	bool _enabled = false;
+	//Do the commands need rebuilding
+	bool _dirty = true;
+
+	//The merged vertex and index buffers
+	VertexArrayObject::sptr _vao;
+	std::unordered_map<const VertexArrayObject*, MeshRange> _meshRanges;
+	//Keeps the merged meshes alive, so their addresses can't get reused by another mesh
+	std::vector<VertexArrayObject::sptr> _meshes;
+
+	//The commands and transforms, and the buffers they go in
+	std::vector<DrawElementsCommand> _commands;
+	std::vector<InstanceData> _instances;
+	GLuint _commandBuffer = GL_NONE;
+	GLuint _instanceBuffer = GL_NONE;
+	DirtyRange _dirtyCommands;
+	DirtyRange _dirtyInstances;
+
+	//What each command was built from, lined up with _commands
+	std::vector<entt::entity> _entities;
+	std::vector<const ShaderMaterial*> _entityMaterials;
+	std::vector<const VertexArrayObject*> _entityMeshes;
+
+	std::vector<Group> _groups;
+	int _rebuildCount = 0;
+};
@@ -0,0 +1,27 @@
+#include "StreamedTexture.h"
+
+StreamedTexture::sptr StreamedTexture::Create(const Texture2DDescription& description)
+{
+	return std::make_shared<StreamedTexture>(description);
+}
+
+StreamedTexture::StreamedTexture(const Texture2DDescription& description) :
+	Texture2D(description)
+{
+}
+
+void StreamedTexture::Adopt(GLuint handle, uint32_t width, uint32_t height, GLenum format)
+{
+	GLuint& current = GetHandle();
+	if (current != handle)
+	{
+		glDeleteTextures(1, &current);
+		current = handle;
+	}
+
+	_description.Width = width;
+	_description.Height = height;
+	_description.Format = (InternalFormat)format;
+	//Both ways in come with a full mip chain
+	_description.MinificationFilter = MinFilter::LinearMipLinear;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <memory>
+#include <glad/glad.h>
+#include <Texture2D.h>
+
+//A Texture2D that can take over a GL texture made somewhere else (streamed in, or loaded from a baked file)
+//*Materials hold on to the same object, so they pick the new texture up without being touched
+class StreamedTexture : public Texture2D
+{
+public:
+	typedef std::shared_ptr<StreamedTexture> sptr;
+
+	static sptr Create(const Texture2DDescription& description);
+
+	StreamedTexture(const Texture2DDescription& description);
+
+	//Deletes the texture we have now and takes over handle, so the size and format read back match it
+	//*format is the GL internal format it was made with (compressed formats included)
+	void Adopt(GLuint handle, uint32_t width, uint32_t height, GLenum format);
+};
@@ -0,0 +1,286 @@
+#include "TextureStreamer.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <stb_image.h>
+#include <Logging.h>
+#include "Utilities/JobSystem.h"
+#include "Utilities/TextureBaker.h"
+#include "Utilities/Util.h"
+
+std::vector<TextureStreamer::RequestPtr> TextureStreamer::_decoded;
+std::mutex TextureStreamer::_decodedMutex;
+std::deque<TextureStreamer::RequestPtr> TextureStreamer::_uploading;
+GLuint TextureStreamer::_pixelBuffer = GL_NONE;
+size_t TextureStreamer::_uploadBudget = TextureStreamer::DEFAULT_UPLOAD_BUDGET;
+int TextureStreamer::_pendingCount = 0;
+std::atomic<int> TextureStreamer::_decodingCount(0);
+
+void TextureStreamer::Init(size_t uploadBudget)
+{
+	_uploadBudget = uploadBudget;
+	glGenBuffers(1, &_pixelBuffer);
+}
+
+void TextureStreamer::Unload()
+{
+	//Let the decode jobs finish so nothing writes to the queue after we clear it
+	while (_decodingCount > 0)
+	{
+		if (!JobSystem::RunPendingJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	for (const RequestPtr& request : _decoded)
+	{
+		stbi_image_free(request->Pixels);
+	}
+	_decoded.clear();
+
+	for (const RequestPtr& request : _uploading)
+	{
+		stbi_image_free(request->Pixels);
+		glDeleteTextures(1, &request->Handle);
+	}
+	_uploading.clear();
+
+	glDeleteBuffers(1, &_pixelBuffer);
+	_pixelBuffer = GL_NONE;
+	_pendingCount = 0;
+}
+
+Texture2D::sptr TextureStreamer::Request(const std::string& path, const Callback& callback)
+{
+	//Stands in until the real image gets uploaded
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.Format = InternalFormat::RGBA8;
+	StreamedTexture::sptr texture = StreamedTexture::Create(desc);
+	texture->Clear();
+
+	RequestPtr request = std::make_shared<StreamRequest>();
+	request->Path = path;
+	request->Texture = texture;
+	request->OnLoaded = callback;
+
+	_pendingCount++;
+	_decodingCount++;
+	JobSystem::Submit([request]() { Decode(request); });
+
+	return texture;
+}
+
+void TextureStreamer::Poll()
+{
+	Upload(_uploadBudget);
+}
+
+void TextureStreamer::Flush()
+{
+	while (_pendingCount > 0)
+	{
+		Upload(SIZE_MAX);
+
+		//Still decoding, so help out
+		if (_pendingCount > 0 && !JobSystem::RunPendingJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+int TextureStreamer::GetPendingCount()
+{
+	return _pendingCount;
+}
+
+void TextureStreamer::Decode(const RequestPtr& request)
+{
+	//A baked .ctex is already compressed and has its mips, so there's nothing to decode
+	if (TextureBaker::IsUpToDate(request->Path))
+	{
+		request->Compressed = std::make_unique<MappedFile>(TextureBaker::GetBakedPath(request->Path));
+		if (CompressedTexture::Parse(*request->Compressed, request->CompressedFormat, request->Levels))
+		{
+			std::lock_guard<std::mutex> lock(_decodedMutex);
+			_decoded.push_back(request);
+			_decodingCount--;
+			return;
+		}
+		request->Compressed = nullptr;
+	}
+
+	//Pin this thread's flip setting off, so whatever the shared flag is set to (the cube map loads use it) can't flip it twice
+	stbi_set_flip_vertically_on_load_thread(0);
+	int channels;
+	request->Pixels = stbi_load(request->Path.c_str(), &request->Width, &request->Height, &channels, 4);
+	request->Failed = request->Pixels == nullptr;
+
+	//Our textures are all bottom up like OpenGL wants
+	//*Flipped here rather than with stbi's shared flip flag, other threads load images with it
+	if (!request->Failed)
+	{
+		Util::FlipRows(request->Pixels, request->Width, request->Height, 4);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_decodedMutex);
+		_decoded.push_back(request);
+	}
+	_decodingCount--;
+}
+
+void TextureStreamer::Upload(size_t budget)
+{
+	//Grab whatever finished decoding since last time
+	{
+		std::lock_guard<std::mutex> lock(_decodedMutex);
+		_uploading.insert(_uploading.end(), _decoded.begin(), _decoded.end());
+		_decoded.clear();
+	}
+
+	size_t uploaded = 0;
+	while (!_uploading.empty() && uploaded < budget)
+	{
+		StreamRequest& request = *_uploading.front();
+
+		if (request.Failed)
+		{
+			//Leaves the placeholder in
+			LOG_WARN("Failed to load texture {}", request.Path);
+			_pendingCount--;
+			_uploading.pop_front();
+			continue;
+		}
+
+		if (request.Compressed)
+			uploaded += UploadLevel(request);
+		else
+			uploaded += UploadRows(request, budget - uploaded);
+
+		if (IsUploaded(request))
+		{
+			Finish(request);
+			_uploading.pop_front();
+		}
+	}
+}
+
+size_t TextureStreamer::UploadRows(StreamRequest& request, size_t budget)
+{
+	size_t rowSize = (size_t)request.Width * 4;
+	//Always at least one row so big images still get somewhere
+	size_t rows = std::max(budget / rowSize, (size_t)1);
+	rows = std::min(rows, (size_t)(request.Height - request.RowsUploaded));
+	size_t size = rows * rowSize;
+
+	if (request.Handle == GL_NONE)
+	{
+		//Full mip chain, filled in by Finish
+		int levels = 1 + (int)std::floor(std::log2((float)std::max(request.Width, request.Height)));
+
+		glGenTextures(1, &request.Handle);
+		glBindTexture(GL_TEXTURE_2D, request.Handle);
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, request.Width, request.Height);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, request.Handle);
+	}
+
+	FillPixelBuffer(request.Pixels + rowSize * request.RowsUploaded, size);
+
+	//Reads from the pixel buffer, so the copy happens on the GPU's time
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, request.RowsUploaded, request.Width, (GLsizei)rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+	glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+	request.RowsUploaded += (int)rows;
+	return size;
+}
+
+size_t TextureStreamer::UploadLevel(StreamRequest& request)
+{
+	const CompressedTexture::Level& level = request.Levels[request.LevelsUploaded];
+
+	if (request.Handle == GL_NONE)
+	{
+		glGenTextures(1, &request.Handle);
+		glBindTexture(GL_TEXTURE_2D, request.Handle);
+		glTexStorage2D(GL_TEXTURE_2D, (GLsizei)request.Levels.size(), request.CompressedFormat, request.Levels[0].Width, request.Levels[0].Height);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, request.Handle);
+	}
+
+	FillPixelBuffer(level.Data, level.Size);
+	glCompressedTexSubImage2D(GL_TEXTURE_2D, request.LevelsUploaded, 0, 0, level.Width, level.Height, request.CompressedFormat, level.Size, nullptr);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+	glBindTexture(GL_TEXTURE_2D, GL_NONE);
+
+	request.LevelsUploaded++;
+	return level.Size;
+}
+
+void TextureStreamer::FillPixelBuffer(const void* data, size_t size)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pixelBuffer);
+	//Orphans the last upload's storage so we don't wait for the GPU to finish with it
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	memcpy(mapped, data, size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+bool TextureStreamer::IsUploaded(const StreamRequest& request)
+{
+	if (request.Compressed)
+		return request.LevelsUploaded == (int)request.Levels.size();
+	return request.RowsUploaded == request.Height;
+}
+
+void TextureStreamer::Finish(StreamRequest& request)
+{
+	//Baked textures come with their mips
+	if (!request.Compressed)
+	{
+		glBindTexture(GL_TEXTURE_2D, request.Handle);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, GL_NONE);
+	}
+
+	glTextureParameteri(request.Handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(request.Handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(request.Handle, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(request.Handle, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	//Swaps the real texture in under the placeholder, so every material holding it picks it up
+	if (request.Compressed)
+	{
+		request.Texture->Adopt(request.Handle, request.Levels[0].Width, request.Levels[0].Height, request.CompressedFormat);
+	}
+	else
+	{
+		request.Texture->Adopt(request.Handle, request.Width, request.Height, GL_RGBA8);
+	}
+	request.Handle = GL_NONE;
+
+	stbi_image_free(request.Pixels);
+	request.Pixels = nullptr;
+	request.Compressed = nullptr;
+	request.Levels.clear();
+
+	_pendingCount--;
+
+	if (request.OnLoaded)
+	{
+		request.OnLoaded(request.Texture);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <functional>
+#include <glad/glad.h>
+#include <Texture2D.h>
+#include "Graphics/CompressedTexture.h"
+#include "Graphics/StreamedTexture.h"
+
+//Loads Texture2Ds in the background
+//*Images get decoded on the job system, then uploaded through a pixel buffer a few rows at a time on the GL thread
+//*Images with an up to date .ctex (see TextureBaker) skip decoding and get uploaded a mip level at a time
+//*Every request hands back a 1x1 placeholder right away, and the real texture swaps in under the same Texture2D once it's uploaded
+class TextureStreamer abstract
+{
+public:
+	typedef std::function<void(const Texture2D::sptr&)> Callback;
+
+	//Creates the pixel buffer
+	//*uploadBudget is roughly how many bytes get uploaded each Poll
+	static void Init(size_t uploadBudget = DEFAULT_UPLOAD_BUDGET);
+	//Drops anything that hasn't been uploaded yet and deletes the pixel buffer
+	static void Unload();
+
+	//Starts loading an image, returns the placeholder that it'll get loaded into
+	//*callback gets called on the GL thread once the texture is uploaded
+	static Texture2D::sptr Request(const std::string& path, const Callback& callback = nullptr);
+
+	//Uploads decoded images (has to be called on the GL thread, once a frame)
+	static void Poll();
+	//Blocks until every request is uploaded
+	static void Flush();
+
+	//How many textures are still decoding or uploading
+	static int GetPendingCount();
+
+	static const size_t DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024;
+private:
+	//One texture on its way in
+	struct StreamRequest
+	{
+		std::string Path;
+		StreamedTexture::sptr Texture;
+		Callback OnLoaded;
+
+		//Filled in by the decode job
+		unsigned char* Pixels = nullptr;
+		int Width = 0;
+		int Height = 0;
+		bool Failed = false;
+
+		//Set instead of Pixels when there's a baked .ctex, the levels point into the mapping
+		std::unique_ptr<MappedFile> Compressed;
+		GLenum CompressedFormat = GL_NONE;
+		std::vector<CompressedTexture::Level> Levels;
+
+		//Filled in while uploading
+		GLuint Handle = GL_NONE;
+		int RowsUploaded = 0;
+		int LevelsUploaded = 0;
+	};
+	typedef std::shared_ptr<StreamRequest> RequestPtr;
+
+	//Runs on a worker, decodes the image into RGBA8
+	static void Decode(const RequestPtr& request);
+	//Uploads until budget bytes have gone out
+	static void Upload(size_t budget);
+	//Uploads up to budget bytes of the request, returns how many bytes it took
+	static size_t UploadRows(StreamRequest& request, size_t budget);
+	//Uploads the next mip level of a compressed request, returns how many bytes it took
+	static size_t UploadLevel(StreamRequest& request);
+	//Copies data into a fresh pixel buffer (leaves it bound)
+	static void FillPixelBuffer(const void* data, size_t size);
+	//Is every row or level uploaded
+	static bool IsUploaded(const StreamRequest& request);
+	//Generates the mips and swaps the real texture in
+	static void Finish(StreamRequest& request);
+
+	//Decoded images waiting on the GL thread (written to by workers)
+	static std::vector<RequestPtr> _decoded;
+	static std::mutex _decodedMutex;
+	//Images being uploaded, in the order they were decoded
+	static std::deque<RequestPtr> _uploading;
+
+	//Orphaned and refilled for every upload so we never wait on the GPU
+	static GLuint _pixelBuffer;
+	static size_t _uploadBudget;
+	//Requests that haven't been swapped in yet
+	static int _pendingCount;
+	//Decode jobs that haven't finished
+	static std::atomic<int> _decodingCount;
+};
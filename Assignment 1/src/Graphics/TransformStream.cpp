@@ -0,0 +1,173 @@
+#include "TransformStream.h"
+#include <vector>
+#include <Logging.h>
+
+GLuint TransformStream::_transformBuffer = GL_NONE;
+InstanceData* TransformStream::_mapped = nullptr;
+GLsizeiptr TransformStream::_regionSize = 0;
+
+GLuint TransformStream::_drawIDBuffer = GL_NONE;
+std::unordered_map<const VertexArrayObject*, std::weak_ptr<VertexArrayObject>> TransformStream::_preparedVAOs;
+
+GLsync TransformStream::_fences[FRAMES_IN_FLIGHT] = { nullptr };
+int TransformStream::_frameIndex = 0;
+GLuint TransformStream::_drawCount = 0;
+GLuint TransformStream::_maxDraws = 0;
+bool TransformStream::_overflowed = false;
+
+void TransformStream::Init(GLuint maxDraws)
+{
+	//Makes sure we don't double up
+	Unload();
+
+	_maxDraws = maxDraws;
+
+	//Each region has to start on a valid binding offset
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_regionSize = maxDraws * sizeof(InstanceData);
+	_regionSize = ((_regionSize + alignment - 1) / alignment) * alignment;
+
+	//Persistent and coherent, so we can write into it every frame without remapping
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &_transformBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _transformBuffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, _regionSize * FRAMES_IN_FLIGHT, nullptr, flags);
+	_mapped = reinterpret_cast<InstanceData*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, _regionSize * FRAMES_IN_FLIGHT, flags));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+
+	if (_mapped == nullptr)
+	{
+		LOG_ERROR("Failed to map the transform stream");
+	}
+
+	//The draw ID buffer is just every index, the base instance picks where we start
+	std::vector<GLuint> drawIDs(maxDraws);
+	for (GLuint i = 0; i < maxDraws; i++)
+	{
+		drawIDs[i] = i;
+	}
+	glGenBuffers(1, &_drawIDBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, _drawIDBuffer);
+	glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLuint), drawIDs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+
+	_frameIndex = 0;
+	_drawCount = 0;
+}
+
+void TransformStream::Unload()
+{
+	//Clears out all the fences
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+	{
+		if (_fences[i] != nullptr)
+		{
+			glDeleteSync(_fences[i]);
+			_fences[i] = nullptr;
+		}
+	}
+
+	//Unmaps and deletes the transform buffer
+	if (_transformBuffer != GL_NONE)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _transformBuffer);
+		glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+		glDeleteBuffers(1, &_transformBuffer);
+		_transformBuffer = GL_NONE;
+		_mapped = nullptr;
+	}
+
+	//Deletes the draw ID buffer
+	if (_drawIDBuffer != GL_NONE)
+	{
+		glDeleteBuffers(1, &_drawIDBuffer);
+		_drawIDBuffer = GL_NONE;
+	}
+
+	_preparedVAOs.clear();
+}
+
+void TransformStream::BeginFrame()
+{
+	//If the GPU is still reading this region from a few frames ago, we wait on it
+	if (_fences[_frameIndex] != nullptr)
+	{
+		GLenum result = glClientWaitSync(_fences[_frameIndex], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED)
+		{
+			//One millisecond at a time
+			result = glClientWaitSync(_fences[_frameIndex], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(_fences[_frameIndex]);
+		_fences[_frameIndex] = nullptr;
+	}
+
+	_drawCount = 0;
+	_overflowed = false;
+
+	Bind();
+}
+
+void TransformStream::EndFrame()
+{
+	//Fence the region so we know when the GPU is done with it
+	_fences[_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_frameIndex = (_frameIndex + 1) % FRAMES_IN_FLIGHT;
+}
+
+GLuint TransformStream::Push(const glm::mat4& model, const glm::mat3& normalMatrix)
+{
+	//Out of room, reuse the last slot (warn once so we know to raise the limit)
+	if (_drawCount >= _maxDraws)
+	{
+		if (!_overflowed)
+		{
+			LOG_WARN("Transform stream is full ({} draws), raise the max draws", _maxDraws);
+			_overflowed = true;
+		}
+		return _maxDraws - 1;
+	}
+
+	//Writes straight into the mapped region
+	InstanceData* region = reinterpret_cast<InstanceData*>(reinterpret_cast<char*>(_mapped) + _regionSize * _frameIndex);
+	region[_drawCount].Model = model;
+	region[_drawCount].NormalMatrix = glm::mat4(normalMatrix);
+
+	return _drawCount++;
+}
+
+void TransformStream::Bind()
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, _transformBuffer, _regionSize * _frameIndex, _regionSize);
+}
+
+void TransformStream::PrepareVAO(const VertexArrayObject::sptr& vao)
+{
+	//Already has the attribute
+	auto iter = _preparedVAOs.find(vao.get());
+	if (iter != _preparedVAOs.end() && !iter->second.expired())
+		return;
+
+	//The draw ID advances once per instance, so the base instance picks the transform
+	glBindVertexArray(vao->GetHandle());
+	glBindBuffer(GL_ARRAY_BUFFER, _drawIDBuffer);
+	glEnableVertexAttribArray(DRAW_ID_SLOT);
+	glVertexAttribIPointer(DRAW_ID_SLOT, 1, GL_UNSIGNED_INT, 0, nullptr);
+	glVertexAttribDivisor(DRAW_ID_SLOT, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+	glBindVertexArray(GL_NONE);
+
+	_preparedVAOs[vao.get()] = vao;
+}
+
+GLuint TransformStream::GetDrawCount()
+{
+	return _drawCount;
+}
+
+GLuint TransformStream::GetMaxDraws()
+{
+	return _maxDraws;
+}
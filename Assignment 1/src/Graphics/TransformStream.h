@@ -0,0 +1,72 @@
+#pragma once
+#include <unordered_map>
+#include <memory>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+
+#include "Graphics/InstanceBatch.h"
+
+//Streams every draw's world and normal matrices to the GPU once per frame
+//*One persistently mapped buffer split into a region per frame in flight
+//*Draws index into it with their draw ID (passed as the base instance)
+class TransformStream abstract
+{
+public:
+	//Creates the buffer and maps it
+	//*maxDraws is how many transforms can be pushed in a single frame
+	static void Init(GLuint maxDraws = DEFAULT_MAX_DRAWS);
+	//Unmaps and deletes the buffers
+	static void Unload();
+
+	//Waits until the GPU is done reading this frame's region and resets the write cursor
+	static void BeginFrame();
+	//Fences this frame's region and moves on to the next one
+	static void EndFrame();
+
+	//Writes a transform into this frame's region
+	//*Returns the draw ID to draw with
+	static GLuint Push(const glm::mat4& model, const glm::mat3& normalMatrix);
+
+	//Binds this frame's region to the transform binding
+	static void Bind();
+
+	//Hooks the draw ID attribute up to a VAO (only does work the first time it sees the VAO)
+	static void PrepareVAO(const VertexArrayObject::sptr& vao);
+
+	//How many transforms were pushed this frame
+	static GLuint GetDrawCount();
+	//How many transforms fit in a frame
+	static GLuint GetMaxDraws();
+
+	//The shader storage binding the transforms get bound to
+	static const GLuint TRANSFORM_BINDING = InstanceBatch::INSTANCE_BINDING;
+	//The attribute slot the draw ID gets read from
+	static const GLuint DRAW_ID_SLOT = 4;
+	//How many frames we let the GPU fall behind by (triple buffered)
+	static const int FRAMES_IN_FLIGHT = 3;
+	//Default amount of transforms per frame
+	static const GLuint DEFAULT_MAX_DRAWS = 1 << 16;
+private:
+	//The persistently mapped transform buffer
+	static GLuint _transformBuffer;
+	//CPU pointer to the start of the mapped buffer
+	static InstanceData* _mapped;
+	//Size of a single frame's region (in bytes, padded to the binding alignment)
+	static GLsizeiptr _regionSize;
+
+	//Buffer of 0..maxDraws - 1, read once per instance to get the draw ID
+	static GLuint _drawIDBuffer;
+	//VAOs that already have the draw ID attribute (weak so we notice when they die)
+	static std::unordered_map<const VertexArrayObject*, std::weak_ptr<VertexArrayObject>> _preparedVAOs;
+
+	//Fences for every region
+	static GLsync _fences[FRAMES_IN_FLIGHT];
+	//The region we are writing into
+	static int _frameIndex;
+	//How many transforms were written into the region this frame
+	static GLuint _drawCount;
+	static GLuint _maxDraws;
+	//Have we already warned about running out of room this frame
+	static bool _overflowed;
+};
@@ -0,0 +1,167 @@
+#include "AssetCache.h"
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include "Graphics/MeshCache.h"
+#include "Graphics/TextureStreamer.h"
+
+std::unordered_map<std::string, VertexArrayObject::sptr> AssetCache::_meshes;
+std::unordered_map<std::string, Texture2D::sptr> AssetCache::_textures;
+std::unordered_map<std::string, Shader::sptr> AssetCache::_shaders;
+
+VertexArrayObject::sptr AssetCache::GetMesh(const std::string& path, const glm::vec4& color)
+{
+	return GetMeshLOD(path, 0, color);
+}
+
+VertexArrayObject::sptr AssetCache::GetMeshLOD(const std::string& path, int level, const glm::vec4& color)
+{
+	std::string key = GetMeshKey(path, color, level);
+	auto it = _meshes.find(key);
+	if (it != _meshes.end())
+		return it->second;
+
+	VertexArrayObject::sptr mesh = MeshCache::LoadLOD(path, level, color);
+	//Don't cache a failed load, so fixing the file and asking again works
+	if (mesh != nullptr)
+		_meshes[key] = mesh;
+	return mesh;
+}
+
+Texture2D::sptr AssetCache::GetTexture(const std::string& path)
+{
+	std::string key = NormalizePath(path);
+	auto it = _textures.find(key);
+	if (it != _textures.end())
+		return it->second;
+
+	//Still a placeholder until it streams in, but everyone shares the one placeholder
+	Texture2D::sptr texture = TextureStreamer::Request(path);
+	_textures[key] = texture;
+	return texture;
+}
+
+Shader::sptr AssetCache::GetShader(const std::string& vertexPath, const std::string& fragmentPath)
+{
+	std::string key = GetShaderKey(vertexPath, fragmentPath);
+	auto it = _shaders.find(key);
+	if (it != _shaders.end())
+		return it->second;
+
+	Shader::sptr shader = Shader::Create();
+	shader->LoadShaderPartFromFile(vertexPath.c_str(), GL_VERTEX_SHADER);
+	shader->LoadShaderPartFromFile(fragmentPath.c_str(), GL_FRAGMENT_SHADER);
+	shader->Link();
+	_shaders[key] = shader;
+	return shader;
+}
+
+int AssetCache::GetMeshRefCount(const std::string& path, const glm::vec4& color)
+{
+	return GetRefCount(_meshes, GetMeshKey(path, color));
+}
+
+int AssetCache::GetTextureRefCount(const std::string& path)
+{
+	return GetRefCount(_textures, NormalizePath(path));
+}
+
+int AssetCache::GetShaderRefCount(const std::string& vertexPath, const std::string& fragmentPath)
+{
+	return GetRefCount(_shaders, GetShaderKey(vertexPath, fragmentPath));
+}
+
+int AssetCache::EvictUnused()
+{
+	int evicted = Evict(_meshes) + Evict(_textures) + Evict(_shaders);
+	//The meshes that just went (and any loaded around the cache) are still in MeshCache's table
+	MeshCache::EvictUnused();
+	if (evicted > 0)
+		printf("Evicted %d unused assets\n", evicted);
+	return evicted;
+}
+
+void AssetCache::Clear()
+{
+	_meshes.clear();
+	_textures.clear();
+	_shaders.clear();
+	MeshCache::EvictUnused();
+}
+
+int AssetCache::GetMeshCount()
+{
+	return (int)_meshes.size();
+}
+
+int AssetCache::GetTextureCount()
+{
+	return (int)_textures.size();
+}
+
+int AssetCache::GetShaderCount()
+{
+	return (int)_shaders.size();
+}
+
+std::string AssetCache::NormalizePath(const std::string& path)
+{
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+#ifdef _WIN32
+	//Windows doesn't care about case, so neither do we
+	std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
+#endif
+	return normalized;
+}
+
+std::string AssetCache::GetMeshKey(const std::string& path, const glm::vec4& color, int level)
+{
+	//Meshes bake their colour into the vertices, so each colour is its own mesh
+	std::string key = NormalizePath(path);
+	if (color != glm::vec4(1.0f))
+	{
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), "|%g,%g,%g,%g", color.x, color.y, color.z, color.w);
+		key += suffix;
+	}
+	if (level > 0)
+	{
+		key += "#lod" + std::to_string(level);
+	}
+	return key;
+}
+
+std::string AssetCache::GetShaderKey(const std::string& vertexPath, const std::string& fragmentPath)
+{
+	return NormalizePath(vertexPath) + "|" + NormalizePath(fragmentPath);
+}
+
+template <typename T>
+int AssetCache::GetRefCount(const std::unordered_map<std::string, std::shared_ptr<T>>& table, const std::string& key)
+{
+	auto it = table.find(key);
+	if (it == table.end())
+		return -1;
+
+	//Not counting our own reference
+	return (int)it->second.use_count() - 1;
+}
+
+template <typename T>
+int AssetCache::Evict(std::unordered_map<std::string, std::shared_ptr<T>>& table)
+{
+	int evicted = 0;
+	for (auto it = table.begin(); it != table.end();)
+	{
+		if (it->second.use_count() == 1)
+		{
+			it = table.erase(it);
+			evicted++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return evicted;
+}
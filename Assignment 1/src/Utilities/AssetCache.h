@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+#include <VertexArrayObject.h>
+#include <Texture2D.h>
+#include <Shader.h>
+
+//Hands out one shared copy of every mesh, texture and shader, keyed by its normalized path
+//*Asking for the same file twice (even spelt differently, like "models/../models/skull.obj") gives back the same handle
+//*The cache holds a reference to everything it loads, anything only the cache is holding can be evicted
+class AssetCache abstract
+{
+public:
+	//Loads a mesh through MeshCache, or hands back the one we already have
+	static VertexArrayObject::sptr GetMesh(const std::string& path, const glm::vec4& color = glm::vec4(1.0f));
+	//Loads a simplified level of a mesh through MeshCache (level 0 is the mesh itself)
+	static VertexArrayObject::sptr GetMeshLOD(const std::string& path, int level, const glm::vec4& color = glm::vec4(1.0f));
+	//Streams a texture in through TextureStreamer, or hands back the one we already have
+	static Texture2D::sptr GetTexture(const std::string& path);
+	//Loads and links a vertex/fragment shader pair, or hands back the one we already have
+	static Shader::sptr GetShader(const std::string& vertexPath, const std::string& fragmentPath);
+
+	//How many things other than the cache are holding the asset (-1 if it isn't cached)
+	static int GetMeshRefCount(const std::string& path, const glm::vec4& color = glm::vec4(1.0f));
+	static int GetTextureRefCount(const std::string& path);
+	static int GetShaderRefCount(const std::string& vertexPath, const std::string& fragmentPath);
+
+	//Drops everything nothing else is using, returns how many assets went
+	static int EvictUnused();
+	//Drops every reference the cache holds
+	static void Clear();
+
+	//How many assets are cached
+	static int GetMeshCount();
+	static int GetTextureCount();
+	static int GetShaderCount();
+
+	//Makes a path into the form we key on (lexically normalized, forward slashes, lower case on windows)
+	static std::string NormalizePath(const std::string& path);
+private:
+	//The keys for assets that aren't just a path
+	static std::string GetMeshKey(const std::string& path, const glm::vec4& color, int level = 0);
+	static std::string GetShaderKey(const std::string& vertexPath, const std::string& fragmentPath);
+
+	//Reference count for an entry in one of the tables
+	template <typename T>
+	static int GetRefCount(const std::unordered_map<std::string, std::shared_ptr<T>>& table, const std::string& key);
+	//Drops the entries in a table only the cache is holding
+	template <typename T>
+	static int Evict(std::unordered_map<std::string, std::shared_ptr<T>>& table);
+
+	static std::unordered_map<std::string, VertexArrayObject::sptr> _meshes;
+	static std::unordered_map<std::string, Texture2D::sptr> _textures;
+	static std::unordered_map<std::string, Shader::sptr> _shaders;
+};
@@ -2,6 +2,9 @@
 
 GLFWwindow* BackendHandler::window = nullptr;
 std::vector<std::function<void()>> BackendHandler::imGuiCallbacks;
+bool BackendHandler::resizePending = false;
+int BackendHandler::pendingWidth = 0;
+int BackendHandler::pendingHeight = 0;
 
 
 void BackendHandler::GlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
@@ -28,47 +31,99 @@ void BackendHandler::GlDebugMessage(GLenum source, GLenum type, GLuint id, GLenu
 	}
 }
 
-bool BackendHandler::InitAll()
+bool BackendHandler::InitAll(bool headless, int width, int height)
 {
 	Logger::Init();
 	Util::Init();
+	JobSystem::Init();
 
-	if (!InitGLFW())
-		return 1;
+	if (!InitGLFW(headless, width, height))
+		return false;
 	if (!InitGLAD())
-		return 1;
+		return false;
 
 	Framebuffer::InitFullscreenQuad();
+	TransformStream::Init();
+	TextureStreamer::Init();
+	Profiler::Init();
 
-	InitImGui();
+	if (!headless)
+		InitImGui();
+	return true;
 }
 
 void BackendHandler::GlfwWindowResizedCallback(GLFWwindow* window, int width, int height)
 {
+	resizePending = true;
+	pendingWidth = width;
+	pendingHeight = height;
+}
+
+void BackendHandler::ApplyPendingResize()
+{
+	//A minimized window is 0 by 0, leave everything as it was until it comes back
+	if (!resizePending || pendingWidth <= 0 || pendingHeight <= 0)
+		return;
+	resizePending = false;
+
+	int width = pendingWidth;
+	int height = pendingHeight;
 	glViewport(0, 0, width, height);
+	if (Application::Instance().ActiveScene == nullptr)
+		return;
 	Application::Instance().ActiveScene->Registry().view<Camera>().each([=](Camera& cam) 
 	{
 		cam.ResizeWindow(width, height);
 	});
+	//Framebuffers only reallocate when the window outgrows them (or shrinks well below them)
 	Application::Instance().ActiveScene->Registry().view<Framebuffer>().each([=](Framebuffer& buf)
 	{
 		buf.Reshape(width, height);
 	});
 }
 
-bool BackendHandler::InitGLFW()
+bool BackendHandler::InitGLFW(bool headless, int width, int height)
 {
 	if (glfwInit() == GLFW_FALSE) {
-		LOG_ERROR("Failed to initialize GLFW");
-		return false;
+#ifdef GLFW_PLATFORM_NULL
+		//Without a display, headless runs can still get a context from OSMesa on GLFW's null platform
+		if (headless) {
+			glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+		}
+		if (!headless || glfwInit() == GLFW_FALSE)
+#endif
+		{
+			LOG_ERROR("Failed to initialize GLFW");
+			return false;
+		}
 	}
 
 #ifdef _DEBUG
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
 #endif
 
+	//Headless windows never get shown, everything gets drawn into framebuffers
+	if (headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	//Create a new GLFW window
-	window = glfwCreateWindow(800, 800, "INFR1350U", nullptr, nullptr);
+	window = glfwCreateWindow(width, height, "INFR1350U", nullptr, nullptr);
+
+	//If the native context API isn't there (no display server), try EGL and then OSMesa
+	if (window == nullptr && headless) {
+		const int contextApis[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+		for (int api : contextApis) {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+			window = glfwCreateWindow(width, height, "INFR1350U", nullptr, nullptr);
+			if (window != nullptr)
+				break;
+		}
+	}
+	if (window == nullptr) {
+		LOG_ERROR("Failed to create a window");
+		return false;
+	}
 	glfwMakeContextCurrent(window);
 
 	// Set our window resized callback
@@ -145,6 +200,9 @@ void BackendHandler::RenderImGui()
 		ImGui::End();
 	}
 
+	// The profiler gets its own window, so the timeline has room
+	Profiler::RenderImGui();
+
 	// Make sure ImGui knows how big our window is
 	ImGuiIO& io = ImGui::GetIO();
 	int width{ 0 }, height{ 0 };
@@ -165,12 +223,30 @@ void BackendHandler::RenderImGui()
 	}
 }
 
-void BackendHandler::RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform)
+void BackendHandler::RenderVAO(const VertexArrayObject::sptr& vao, const Transform& transform)
 {
-	shader->SetUniformMatrix("u_ModelViewProjection", viewProjection * transform.WorldTransform());
-	shader->SetUniformMatrix("u_Model", transform.WorldTransform());
-	shader->SetUniformMatrix("u_NormalMatrix", transform.WorldNormalMatrix());
-	vao->Render();
+	//The matrices go into the transform stream instead of per draw uniforms
+	GLuint drawID = TransformStream::Push(transform.WorldTransform(), transform.WorldNormalMatrix());
+	RenderVAOInstanced(vao, 1, drawID);
+}
+
+void BackendHandler::RenderVAOInstanced(const VertexArrayObject::sptr& vao, GLsizei instanceCount, GLuint baseInstance)
+{
+	//Makes sure the VAO can read its draw ID
+	TransformStream::PrepareVAO(vao);
+
+	vao->Bind();
+	//Indexed meshes draw with their index buffer, the rest draw straight from the vertices
+	if (vao->GetIndexBuffer() != nullptr)
+	{
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, (GLsizei)vao->GetIndexBuffer()->GetElementCount(), vao->GetIndexBuffer()->GetElementType(), 
+			nullptr, instanceCount, baseInstance);
+	}
+	else
+	{
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, vao->GetVertexCount(), instanceCount, baseInstance);
+	}
+	VertexArrayObject::UnBind();
 }
 
 void BackendHandler::SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection)
@@ -2,8 +2,31 @@
 
 #include "Utilities/Util.h"
 #include "Utilities/EnvironmentGenerator.h"
+#include "Utilities/JobSystem.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/TextureBaker.h"
+#include "Utilities/AssetCache.h"
+#include "Utilities/Profiler.h"
+#include "Utilities/Benchmark.h"
 #include "Graphics/Framebuffer.h"
 #include "Graphics/LUT.h"
+#include "Graphics/TransformStream.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/LODChain.h"
+#include "Graphics/FrustumCuller.h"
+#include "Graphics/StaticGeometry.h"
+#include "Graphics/FrameGraph.h"
+#include "Graphics/LightBuffer.h"
+#include "Graphics/LightClusters.h"
+#include "Graphics/SceneRenderer.h"
+#include "Utilities/SpatialIndex.h"
+#include "Graphics/MeshCache.h"
+#include "Graphics/StreamedTexture.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/Post/PostEffectChain.h"
+#include "Graphics/Post/GreyscaleEffect.h"
+#include "Graphics/Post/SepiaEffect.h"
+#include "Graphics/Post/LUTEffect.h"
 
 #include <iostream>
 #include <Logging.h>
@@ -42,13 +65,18 @@ public:
 	static void GlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 
 	//Initialize everything
-	static bool InitAll();
+	//*Headless makes a hidden window (and skips ImGui) for running without a display, like the benchmark
+	static bool InitAll(bool headless = false, int width = 800, int height = 800);
 
 	//Window resize callback
+	//*Only records the size, dragging a window's edge sends dozens of these a frame
 	static void GlfwWindowResizedCallback(GLFWwindow* window, int width, int height);
+	//Resizes the viewport, cameras and framebuffers to the last size the window was given, if it changed
+	//*Call once a frame, after polling events
+	static void ApplyPendingResize();
 
 	//Backend Graphic Init Functions
-	static bool InitGLFW();
+	static bool InitGLFW(bool headless = false, int width = 800, int height = 800);
 	static bool InitGLAD();
 
 	//ImGui Init Functions
@@ -57,9 +85,18 @@ public:
 	static void RenderImGui();
 
 	//Render our VAO
-	static void RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform);
+	//*Pushes the transform into the transform stream and draws with its draw ID
+	static void RenderVAO(const VertexArrayObject::sptr& vao, const Transform& transform);
+	//Render multiple instances of our VAO with one draw call
+	//*baseInstance is the draw ID of the first instance
+	static void RenderVAOInstanced(const VertexArrayObject::sptr& vao, GLsizei instanceCount, GLuint baseInstance = 0);
 	static void SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection);
 
 	static GLFWwindow* window;
 	static std::vector<std::function<void()>> imGuiCallbacks;
+
+	//The window size waiting to be applied
+	static bool resizePending;
+	static int pendingWidth;
+	static int pendingHeight;
 };
\ No newline at end of file
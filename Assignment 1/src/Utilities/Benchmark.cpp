@@ -0,0 +1,531 @@
+#include "Benchmark.h"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <json.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <MeshBuilder.h>
+#include <MeshFactory.h>
+#include <VertexTypes.h>
+#include <TextureCubeMap.h>
+#include "Utilities/BackendHandler.h"
+
+using nlohmann::json;
+
+//A member of a json object (null if it isn't there, so missing settings fall back to their defaults)
+static const json& Get(const json& object, const char* key)
+{
+	static const json missing;
+	if (!object.is_object())
+		return missing;
+	auto it = object.find(key);
+	return it == object.end() ? missing : *it;
+}
+
+//Reads [x, y, z] (or gives back fallback if it isn't one)
+static glm::vec3 ReadVec3(const json& value, const glm::vec3& fallback)
+{
+	if (!value.is_array() || value.size() < 3)
+		return fallback;
+	return glm::vec3(value[0].get<float>(), value[1].get<float>(), value[2].get<float>());
+}
+
+static glm::vec2 ReadVec2(const json& value, const glm::vec2& fallback)
+{
+	if (!value.is_array() || value.size() < 2)
+		return fallback;
+	return glm::vec2(value[0].get<float>(), value[1].get<float>());
+}
+
+//Reads a list of [x, y]s
+static std::vector<glm::vec2> ReadVec2List(const json& value)
+{
+	std::vector<glm::vec2> result;
+	if (value.is_array())
+	{
+		for (const json& item : value)
+		{
+			result.push_back(ReadVec2(item, glm::vec2(0.0f)));
+		}
+	}
+	return result;
+}
+
+//Mean, percentiles and extremes of some times, as a json object
+static json Summarize(std::vector<float> times)
+{
+	json result = json::object();
+	if (times.empty())
+		return result;
+
+	std::sort(times.begin(), times.end());
+	double total = 0.0;
+	for (float ms : times)
+	{
+		total += ms;
+	}
+	//Nearest rank
+	auto percentile = [&](float p) {
+		size_t rank = (size_t)std::ceil(p * times.size());
+		return times[std::min(std::max(rank, (size_t)1), times.size()) - 1];
+	};
+	result["mean"] = total / times.size();
+	result["min"] = times.front();
+	result["p50"] = percentile(0.5f);
+	result["p95"] = percentile(0.95f);
+	result["p99"] = percentile(0.99f);
+	result["max"] = times.back();
+	return result;
+}
+
+int Benchmark::Run(int argc, char** argv)
+{
+	std::string scenePath = "benchmarks/default.json";
+	std::string outPath = "benchmark.json";
+	int framesOverride = -1;
+	int warmupOverride = -1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+			scenePath = argv[++i];
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			outPath = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			framesOverride = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			warmupOverride = atoi(argv[++i]);
+	}
+
+	json desc;
+	{
+		std::ifstream file(scenePath);
+		if (!file)
+		{
+			printf("Couldn't open benchmark scene %s\n", scenePath.c_str());
+			return 1;
+		}
+		desc = json::parse(file, nullptr, false);
+		if (desc.is_discarded() || !desc.is_object())
+		{
+			printf("Benchmark scene %s isn't valid json\n", scenePath.c_str());
+			return 1;
+		}
+	}
+
+	glm::vec2 resolution = ReadVec2(Get(desc, "resolution"), glm::vec2(1280.0f, 720.0f));
+	int width = std::max((int)resolution.x, 1);
+	int height = std::max((int)resolution.y, 1);
+	int frames = std::max(framesOverride > 0 ? framesOverride : desc.value("frames", (int)DEFAULT_FRAMES), 1);
+	int warmup = std::max(warmupOverride >= 0 ? warmupOverride : desc.value("warmup", (int)DEFAULT_WARMUP), 0);
+
+	if (!BackendHandler::InitAll(true, width, height))
+	{
+		printf("Couldn't make an OpenGL context for the benchmark\n");
+		return 1;
+	}
+	//Don't let vsync cap the frame rate
+	glfwSwapInterval(0);
+
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glDepthFunc(GL_LEQUAL);
+	Profiler::SetEnabled(true);
+
+	json results;
+	{
+		GameScene::RegisterComponentType<RendererComponent>();
+		GameScene::RegisterComponentType<Camera>();
+		GameScene::sptr scene = GameScene::Create("benchmark");
+		Application::Instance().ActiveScene = scene;
+
+		SceneRenderer renderer;
+		renderer.Init(scene->Registry());
+		const json& rendererDesc = Get(desc, "renderer");
+		if (rendererDesc.is_object())
+		{
+			renderer.GetCuller().SetEnabled(rendererDesc.value("culling", true));
+			renderer.GetStaticGeometry().SetEnabled(rendererDesc.value("indirect", true));
+			renderer.SetDeferred(rendererDesc.value("deferred", false));
+		}
+
+		//Same lighting as the game
+		Shader::sptr shader = AssetCache::GetShader("shaders/vertex_shader.glsl", "shaders/frag_phong.glsl");
+		renderer.SetDeferredShader(shader);
+		//The deferred lighting pass takes the same uniforms
+		auto setLighting = [&](const char* name, const auto& value) {
+			shader->SetUniform(name, value);
+			renderer.GetLightingShader()->SetUniform(name, value);
+		};
+		const json& light = Get(desc, "light");
+		setLighting("u_LightPos", ReadVec3(Get(light, "position"), glm::vec3(0.0f, 0.0f, 5.0f)));
+		setLighting("u_LightCol", ReadVec3(Get(light, "colour"), glm::vec3(0.5f, 0.5f, 0.7f)));
+		setLighting("u_AmbientLightStrength", 2.0f);
+		setLighting("u_SpecularLightStrength", 1.0f);
+		setLighting("u_AmbientCol", glm::vec3(1.0f));
+		setLighting("u_AmbientStrength", 0.1f);
+		setLighting("u_LightAttenuationConstant", 1.0f);
+		setLighting("u_LightAttenuationLinear", 0.09f);
+		setLighting("u_LightAttenuationQuadratic", 0.032f);
+		setLighting("u_toonShading", 1.0f);
+
+		//Point lights scattered over an area
+		const json& pointLights = Get(desc, "pointLights");
+		if (pointLights.is_object())
+		{
+			Random random(pointLights.value("seed", (uint64_t)1));
+			glm::vec3 from = ReadVec3(Get(pointLights, "from"), glm::vec3(-20.0f, -20.0f, 0.5f));
+			glm::vec3 to = ReadVec3(Get(pointLights, "to"), glm::vec3(20.0f, 20.0f, 3.0f));
+			int count = std::min(pointLights.value("count", 0), (int)LightBuffer::MAX_LIGHTS);
+			for (int i = 0; i < count; i++)
+			{
+				GameObject pointLight = scene->CreateEntity("point light");
+				pointLight.get<Transform>().SetLocalPosition(random.Range(from, to));
+				PointLight& light = pointLight.emplace<PointLight>();
+				light.Colour = random.Range(glm::vec3(0.2f), glm::vec3(1.0f));
+				light.Radius = pointLights.value("radius", 4.0f);
+				TransformSystem::MarkStatic(scene->Registry(), pointLight.entity());
+			}
+		}
+
+		//The sky's cube map
+		TextureCubeMap::sptr environmentMap;
+		if (Get(desc, "skybox").is_string())
+		{
+			environmentMap = TextureCubeMap::LoadFromImages(Get(desc, "skybox").get<std::string>());
+		}
+
+		//Materials by name
+		std::unordered_map<std::string, ShaderMaterial::sptr> materials;
+		for (auto& item : Get(desc, "materials").items())
+		{
+			const json& value = item.value();
+			ShaderMaterial::sptr material = ShaderMaterial::Create();
+			material->Shader = shader;
+			material->Set("s_Diffuse", AssetCache::GetTexture(value.value("diffuse", std::string("images/grass.jpg"))));
+			material->Set("s_Specular", AssetCache::GetTexture(value.value("specular", std::string("images/grassSpec.png"))));
+			material->Set("u_Shininess", value.value("shininess", 1.0f));
+			material->Set("u_TextureMix", 0.0f);
+			materials[item.key()] = material;
+		}
+		auto findMaterial = [&](const json& value) -> ShaderMaterial::sptr {
+			auto it = materials.find(value.value("material", std::string()));
+			if (it == materials.end())
+			{
+				LOG_WARN("Benchmark object {} has no material", value.value("mesh", std::string()));
+				return nullptr;
+			}
+			return it->second;
+		};
+
+		//Props placed by hand
+		for (const json& value : Get(desc, "props"))
+		{
+			ShaderMaterial::sptr material = findMaterial(value);
+			if (material == nullptr)
+				continue;
+			GameObject prop = scene->CreateEntity(value.value("name", std::string("prop")));
+			prop.emplace<RendererComponent>().SetMesh(AssetCache::GetMesh(value.value("mesh", std::string()))).SetMaterial(material);
+			prop.get<Transform>().SetLocalPosition(ReadVec3(Get(value, "position"), glm::vec3(0.0f)));
+			prop.get<Transform>().SetLocalRotation(ReadVec3(Get(value, "rotation"), glm::vec3(0.0f)));
+			prop.get<Transform>().SetLocalScale(ReadVec3(Get(value, "scale"), glm::vec3(1.0f)));
+			if (value.value("static", true))
+			{
+				TransformSystem::MarkStatic(scene->Registry(), prop.entity());
+			}
+		}
+
+		//The generated environment
+		const json& environment = Get(desc, "environment");
+		if (environment.is_object())
+		{
+			for (const json& value : Get(environment, "objects"))
+			{
+				ShaderMaterial::sptr material = findMaterial(value);
+				if (material == nullptr)
+					continue;
+				std::string mesh = value.value("mesh", std::string());
+				EnvironmentGenerator::AddObjectToGeneration(mesh, material, value.value("count", 10),
+					ReadVec2(Get(value, "from"), glm::vec2(-18.0f)), ReadVec2(Get(value, "to"), glm::vec2(18.0f)),
+					ReadVec2List(Get(value, "avoidFrom")), ReadVec2List(Get(value, "avoidTo")), value.value("spacing", 1.0f));
+				if (Get(value, "lods").is_array())
+				{
+					EnvironmentGenerator::SetObjectLODs(mesh, Get(value, "lods").get<std::vector<float>>());
+				}
+			}
+			EnvironmentGenerator::SetSeed(environment.value("seed", (uint64_t)1));
+			EnvironmentGenerator::SetDensityMultiplier(environment.value("density", 1.0f));
+			EnvironmentGenerator::SetInstancing(environment.value("instancing", false));
+			EnvironmentGenerator::SetStreaming(environment.value("streaming", false));
+			EnvironmentGenerator::SetStreamRadius(environment.value("streamRadius", EnvironmentGenerator::GetStreamRadius()));
+			EnvironmentGenerator::GenerateEnvironment();
+		}
+
+		if (environmentMap != nullptr)
+		{
+			Shader::sptr skybox = AssetCache::GetShader("shaders/skybox-shader.vert.glsl", "shaders/skybox-shader.frag.glsl");
+			ShaderMaterial::sptr skyboxMat = ShaderMaterial::Create();
+			skyboxMat->Shader = skybox;
+			skyboxMat->Set("s_Environment", environmentMap);
+			skyboxMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
+			skyboxMat->RenderLayer = 100;
+
+			MeshBuilder<VertexPosNormTexCol> mesh;
+			MeshFactory::AddIcoSphere(mesh, glm::vec3(0.0f), 1.0f);
+			MeshFactory::InvertFaces(mesh);
+
+			GameObject skyboxObj = scene->CreateEntity("skybox");
+			skyboxObj.get_or_emplace<RendererComponent>().SetMesh(mesh.Bake()).SetMaterial(skyboxMat);
+			TransformSystem::MarkStatic(scene->Registry(), skyboxObj.entity());
+		}
+
+		//The camera's path
+		std::vector<Keyframe> path;
+		const json& cameraDesc = Get(desc, "camera");
+		bool loop = false;
+		if (cameraDesc.is_object())
+		{
+			loop = cameraDesc.value("loop", false);
+			for (const json& value : Get(cameraDesc, "path"))
+			{
+				path.push_back({ ReadVec3(Get(value, "position"), glm::vec3(0.0f, 3.0f, 3.0f)), ReadVec3(Get(value, "target"), glm::vec3(0.0f)) });
+			}
+		}
+		if (path.empty())
+		{
+			path.push_back({ glm::vec3(0.0f, 3.0f, 3.0f), glm::vec3(0.0f) });
+		}
+
+		GameObject cameraObject = scene->CreateEntity("Camera");
+		Camera& camera = cameraObject.emplace<Camera>();
+		camera.SetUp(glm::vec3(0, 0, 1));
+		camera.SetFovDegrees(cameraDesc.is_object() ? cameraDesc.value("fov", 90.0f) : 90.0f);
+		camera.ResizeWindow(width, height);
+		auto moveCamera = [&](float t) {
+			Keyframe key = SamplePath(path, loop, t);
+			cameraObject.get<Transform>().SetLocalPosition(key.Position).LookAt(key.Target);
+			Camera& camera = cameraObject.get<Camera>();
+			camera.SetPosition(key.Position);
+			camera.LookAt(key.Target);
+		};
+
+		//Kept out of the registry, so nothing resizes it
+		Framebuffer target;
+		target.AddDepthTarget();
+		target.AddColorTarget(GL_RGBA8);
+		target.Init(width, height);
+		glViewport(0, 0, width, height);
+
+		auto drawFrame = [&]() {
+			Profiler::BeginFrame();
+			renderer.Render(cameraObject.entity(), target);
+			scene->Poll();
+			Profiler::BeginScope("Swap");
+			glfwSwapBuffers(BackendHandler::window);
+			Profiler::EndScope();
+			Profiler::EndFrame();
+		};
+
+		//Sit at the start of the path until everything has streamed in
+		moveCamera(0.0f);
+		int warmupFrames = 0;
+		while (warmupFrames < warmup || ((TextureStreamer::GetPendingCount() > 0 || EnvironmentGenerator::GetPendingTileCount() > 0) && warmupFrames < MAX_WARMUP))
+		{
+			drawFrame();
+			warmupFrames++;
+		}
+		if (warmupFrames >= MAX_WARMUP)
+		{
+			LOG_WARN("Benchmark started with assets still streaming in");
+		}
+
+		std::vector<Samples> samples;
+		std::vector<float> frameTimes;
+		frameTimes.reserve(frames);
+		//GPU passes come back a few frames late, so they're filed under the frame they were issued on
+		std::vector<bool> gpuResolved(frames, false);
+		uint64_t firstFrame = Profiler::GetFrameIndex();
+		int culled = 0;
+		int drawn = 0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			moveCamera(frames > 1 ? (float)frame / (frames - 1) : 0.0f);
+			drawFrame();
+			frameTimes.push_back(Profiler::GetLastFrameTime());
+			AddFrame(samples, frame);
+			AddGPUFrame(samples, gpuResolved, firstFrame);
+			culled += renderer.GetCuller().GetCulledCount();
+			drawn += renderer.GetCuller().GetVisibleCount();
+		}
+		//Keep drawing the last view until the last frames' passes have come back
+		for (int i = 0; i < Profiler::GPU_FRAMES; i++)
+		{
+			drawFrame();
+			AddGPUFrame(samples, gpuResolved, firstFrame);
+		}
+		int gpuFrames = (int)std::count(gpuResolved.begin(), gpuResolved.end(), true);
+		if (gpuFrames < frames)
+		{
+			LOG_WARN("Only {} of {} frames' GPU passes came back, the GPU phases are over those", gpuFrames, frames);
+		}
+
+		results["scene"] = scenePath;
+		results["resolution"] = { width, height };
+		results["frames"] = frames;
+		results["warmupFrames"] = warmupFrames;
+		results["gpuFrames"] = gpuFrames;
+		results["glRenderer"] = (const char*)glGetString(GL_RENDERER);
+		results["glVersion"] = (const char*)glGetString(GL_VERSION);
+		results["frame"] = Summarize(frameTimes);
+		json phases = json::array();
+		for (Samples& sample : samples)
+		{
+			sample.Times.resize(frames, 0.0f);
+			//Frames whose passes never came back don't count towards the GPU phases
+			if (sample.GPU)
+			{
+				std::vector<float> times;
+				for (int frame = 0; frame < frames; frame++)
+				{
+					if (gpuResolved[frame])
+					{
+						times.push_back(sample.Times[frame]);
+					}
+				}
+				sample.Times = times;
+			}
+			json phase = Summarize(sample.Times);
+			phase["name"] = sample.Name;
+			phase["gpu"] = sample.GPU;
+			phase["depth"] = sample.Depth;
+			phases.push_back(phase);
+		}
+		results["phases"] = phases;
+		results["counters"] = {
+			{ "renderersDrawn", (double)drawn / frames },
+			{ "renderersCulled", (double)culled / frames },
+			{ "staticMerged", renderer.GetStaticGeometry().GetMergedCount() },
+			{ "staticDrawCalls", (int)renderer.GetStaticGeometry().GetGroupCount() },
+			{ "instanceBatches", (int)EnvironmentGenerator::GetInstanceBatches().size() },
+			{ "transientTargetBytes", renderer.GetFrameGraph().GetAllocatedBytes() },
+			{ "transientTargetPeakBytes", renderer.GetFrameGraph().GetPeakBytes() },
+			{ "deferred", renderer.GetDeferred() },
+			{ "pointLights", renderer.GetLightBuffer().GetCount() },
+			{ "lightClustersLit", renderer.GetLightClusters().GetOccupiedCount() },
+			{ "lightIndices", renderer.GetLightClusters().GetIndexCount() },
+			{ "maxLightsPerCluster", renderer.GetLightClusters().GetMaxPerCluster() }
+		};
+
+		for (const json& phase : phases)
+		{
+			printf("%s%-24s %s %8.3f ms mean %8.3f ms p95\n", std::string(phase["depth"].get<int>() * 2, ' ').c_str(), phase["name"].get<std::string>().c_str(),
+				phase["gpu"].get<bool>() ? "GPU" : "CPU", phase["mean"].get<double>(), phase["p95"].get<double>());
+		}
+		printf("Frame %.3f ms mean, %.3f ms p95 over %d frames\n", results["frame"]["mean"].get<double>(), results["frame"]["p95"].get<double>(), frames);
+
+		renderer.Unload();
+		Application::Instance().ActiveScene = nullptr;
+		EnvironmentGenerator::CleanUpPointers();
+	}
+	TransformStream::Unload();
+	AssetCache::Clear();
+	MeshCache::Clear();
+	TextureStreamer::Unload();
+	Profiler::Unload();
+
+	JobSystem::Shutdown();
+	Logger::Uninitialize();
+
+	std::ofstream file(outPath);
+	if (!file)
+	{
+		printf("Couldn't write benchmark results to %s\n", outPath.c_str());
+		return 1;
+	}
+	file << results.dump(2) << std::endl;
+	printf("Wrote benchmark results to %s\n", outPath.c_str());
+	return 0;
+}
+
+Benchmark::Keyframe Benchmark::SamplePath(const std::vector<Keyframe>& path, bool loop, float t)
+{
+	int count = (int)path.size();
+	if (count == 1)
+		return path[0];
+
+	//Which segment we're on, and how far along it
+	int segments = loop ? count : count - 1;
+	float along = glm::clamp(t, 0.0f, 1.0f) * segments;
+	int segment = std::min((int)along, segments - 1);
+	float s = along - segment;
+
+	auto point = [&](int index) -> const Keyframe& {
+		if (loop)
+			return path[((index % count) + count) % count];
+		return path[glm::clamp(index, 0, count - 1)];
+	};
+	auto catmullRom = [&](const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
+		float s2 = s * s;
+		float s3 = s2 * s;
+		return 0.5f * ((2.0f * p1) + (p2 - p0) * s + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * s2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * s3);
+	};
+
+	const Keyframe& k0 = point(segment - 1);
+	const Keyframe& k1 = point(segment);
+	const Keyframe& k2 = point(segment + 1);
+	const Keyframe& k3 = point(segment + 2);
+	return { catmullRom(k0.Position, k1.Position, k2.Position, k3.Position), catmullRom(k0.Target, k1.Target, k2.Target, k3.Target) };
+}
+
+void Benchmark::AddFrame(std::vector<Samples>& samples, int frame)
+{
+	std::vector<Profiler::ScopeTime> times;
+	Profiler::GetLastFrame(times);
+	for (const Profiler::ScopeTime& time : times)
+	{
+		//The GPU passes in here are from a few frames back, AddGPUFrame files those
+		if (time.GPU)
+			continue;
+
+		Samples& sample = GetSamples(samples, time.Name, false, time.Depth);
+		//Frames before it first ran took 0
+		sample.Times.resize(frame + 1, 0.0f);
+		sample.Times[frame] += time.Milliseconds;
+	}
+}
+
+void Benchmark::AddGPUFrame(std::vector<Samples>& samples, std::vector<bool>& resolved, uint64_t firstFrame)
+{
+	std::vector<Profiler::ScopeTime> times;
+	uint64_t issued = 0;
+	if (!Profiler::GetResolvedGPUFrame(times, issued))
+		return;
+	//Warm up and flush frames don't count, and each frame only gets counted once
+	if (issued < firstFrame || issued - firstFrame >= resolved.size())
+		return;
+	size_t frame = (size_t)(issued - firstFrame);
+	if (resolved[frame])
+		return;
+	resolved[frame] = true;
+
+	for (const Profiler::ScopeTime& time : times)
+	{
+		Samples& sample = GetSamples(samples, time.Name, true, time.Depth);
+		sample.Times.resize(std::max(sample.Times.size(), frame + 1), 0.0f);
+		sample.Times[frame] += time.Milliseconds;
+	}
+}
+
+Benchmark::Samples& Benchmark::GetSamples(std::vector<Samples>& samples, const char* name, bool gpu, int depth)
+{
+	auto it = std::find_if(samples.begin(), samples.end(), [&](const Samples& sample) {
+		return sample.GPU == gpu && sample.Name == name;
+	});
+	if (it == samples.end())
+	{
+		samples.emplace_back(name, gpu, depth);
+		return samples.back();
+	}
+	return *it;
+}
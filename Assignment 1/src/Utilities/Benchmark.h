@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+//Renders a scene description along a fixed camera path in a hidden window, and writes how long each phase took as JSON
+//*Run with --benchmark [scene.json] [--out results.json] [--frames N] [--warmup N]
+//*The scene file has the materials, props and generated environment, the resolution, renderer toggles and the camera's keyframes
+//*Every frame goes through SceneRenderer into a framebuffer, and the profiler's scopes give the per phase times
+//*Warm up runs until the textures and environment tiles have finished streaming in, so they don't land in the results
+class Benchmark abstract
+{
+public:
+	//Loads the scene, runs the benchmark and writes the results, returns the process exit code
+	static int Run(int argc, char** argv);
+
+	//Frames drawn before timing starts (at least, it waits on streaming too)
+	static const int DEFAULT_WARMUP = 60;
+	static const int DEFAULT_FRAMES = 600;
+	//Most warm up frames spent waiting on streaming before giving up on it
+	static const int MAX_WARMUP = 2000;
+private:
+	//A point the camera passes through, and what it's looking at there
+	struct Keyframe
+	{
+		glm::vec3 Position;
+		glm::vec3 Target;
+	};
+
+	//Every time a scope took, one per measured frame
+	struct Samples
+	{
+		Samples(const std::string& name, bool gpu, int depth) : Name(name), GPU(gpu), Depth(depth) {}
+
+		std::string Name;
+		bool GPU;
+		int Depth;
+		std::vector<float> Times;
+	};
+
+	//Where the camera is at t (0 is the first keyframe, 1 is the end of the path)
+	//*Catmull-Rom through the keyframes, a looping path comes back round to the first one
+	static Keyframe SamplePath(const std::vector<Keyframe>& path, bool loop, float t);
+	//Adds a frame's CPU scope times to the samples (scopes that ran more than once in the frame get summed)
+	static void AddFrame(std::vector<Samples>& samples, int frame);
+	//Adds the GPU passes of whichever measured frame just came back, into that frame's slot
+	//*firstFrame is the profiler's index for the first measured frame, resolved marks the frames that have come back
+	static void AddGPUFrame(std::vector<Samples>& samples, std::vector<bool>& resolved, uint64_t firstFrame);
+	//Finds a scope's samples, adding them if it hasn't run yet
+	static Samples& GetSamples(std::vector<Samples>& samples, const char* name, bool gpu, int depth);
+};
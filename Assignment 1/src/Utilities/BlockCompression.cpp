@@ -0,0 +1,556 @@
+#include "BlockCompression.h"
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include "Utilities/Random.h"
+
+//Packs an 8 bit colour into 5:6:5
+static uint16_t PackRGB565(const float* color)
+{
+	int r = std::min(std::max((int)(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+	int g = std::min(std::max((int)(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+	int b = std::min(std::max((int)(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+//Expands 5:6:5 back to 8 bits a channel (repeating the top bits like the hardware does)
+static void UnpackRGB565(uint16_t packed, int* color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static int ColorDistance(const uint8_t* pixel, const int* color)
+{
+	int r = pixel[0] - color[0];
+	int g = pixel[1] - color[1];
+	int b = pixel[2] - color[2];
+	return r * r + g * g + b * b;
+}
+
+void BlockCompression::EncodeBC1(const uint8_t* rgba, uint8_t* out)
+{
+	EncodeColor(rgba, out);
+}
+
+void BlockCompression::EncodeBC3(const uint8_t* rgba, uint8_t* out)
+{
+	EncodeBC4(rgba + 3, 4, out);
+	EncodeColor(rgba, out + 8);
+}
+
+void BlockCompression::EncodeBC5(const uint8_t* rgba, uint8_t* out)
+{
+	EncodeBC4(rgba + 0, 4, out);
+	EncodeBC4(rgba + 1, 4, out + 8);
+}
+
+void BlockCompression::DecodeBC1(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColor(block, rgba, true);
+}
+
+void BlockCompression::DecodeBC3(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColor(block + 8, rgba, false);
+	DecodeBC4(block, rgba + 3, 4);
+}
+
+void BlockCompression::DecodeBC5(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeBC4(block, rgba + 0, 4);
+	DecodeBC4(block + 8, rgba + 1, 4);
+	for (int i = 0; i < 16; i++)
+	{
+		rgba[i * 4 + 2] = 0;
+		rgba[i * 4 + 3] = 255;
+	}
+}
+
+void BlockCompression::EncodeImage(BlockFormat format, const uint8_t* rgba, int width, int height, std::vector<uint8_t>& out)
+{
+	size_t blockSize = GetBlockSize(format);
+	out.resize(GetImageSize(format, width, height));
+
+	uint8_t block[64];
+	uint8_t* cursor = out.data();
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			//Gather the block, repeating the edge for images that aren't a multiple of 4
+			for (int y = 0; y < 4; y++)
+			{
+				int sourceY = std::min(blockY + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					int sourceX = std::min(blockX + x, width - 1);
+					memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+				}
+			}
+
+			switch (format)
+			{
+			case BlockFormat::BC1: EncodeBC1(block, cursor); break;
+			case BlockFormat::BC3: EncodeBC3(block, cursor); break;
+			case BlockFormat::BC5: EncodeBC5(block, cursor); break;
+			}
+			cursor += blockSize;
+		}
+	}
+}
+
+void BlockCompression::DecodeImage(BlockFormat format, const uint8_t* blocks, int width, int height, std::vector<uint8_t>& out)
+{
+	size_t blockSize = GetBlockSize(format);
+	out.resize((size_t)width * height * 4);
+
+	uint8_t block[64];
+	const uint8_t* cursor = blocks;
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			switch (format)
+			{
+			case BlockFormat::BC1: DecodeBC1(cursor, block); break;
+			case BlockFormat::BC3: DecodeBC3(cursor, block); break;
+			case BlockFormat::BC5: DecodeBC5(cursor, block); break;
+			}
+			cursor += blockSize;
+
+			//Drop the padding on edge blocks
+			for (int y = 0; y < 4 && blockY + y < height; y++)
+			{
+				for (int x = 0; x < 4 && blockX + x < width; x++)
+				{
+					memcpy(out.data() + ((size_t)(blockY + y) * width + blockX + x) * 4, block + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+size_t BlockCompression::GetBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t BlockCompression::GetImageSize(BlockFormat format, int width, int height)
+{
+	size_t blocksWide = (size_t)(width + 3) / 4;
+	size_t blocksHigh = (size_t)(height + 3) / 4;
+	return blocksWide * blocksHigh * GetBlockSize(format);
+}
+
+double BlockCompression::GetPSNR(BlockFormat format, const uint8_t* original, const uint8_t* decoded, size_t pixels)
+{
+	int compared = format == BlockFormat::BC5 ? 2 : (format == BlockFormat::BC1 ? 3 : 4);
+	double error = 0.0;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		for (int c = 0; c < compared; c++)
+		{
+			double difference = (double)original[i * 4 + c] - decoded[i * 4 + c];
+			error += difference * difference;
+		}
+	}
+	error /= (double)pixels * compared;
+	return error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / error) : 99.0;
+}
+
+bool BlockCompression::CheckRoundTrip(const char* name, BlockFormat format, const std::vector<uint8_t>& rgba, int width, int height, double minPSNR)
+{
+	std::vector<uint8_t> blocks;
+	std::vector<uint8_t> decoded;
+	EncodeImage(format, rgba.data(), width, height, blocks);
+	DecodeImage(format, blocks.data(), width, height, decoded);
+
+	bool passed = blocks.size() == GetImageSize(format, width, height) && decoded.size() == rgba.size();
+	double psnr = passed ? GetPSNR(format, rgba.data(), decoded.data(), (size_t)width * height) : 0.0;
+	passed = passed && psnr >= minPSNR;
+	printf("%-28s %.1f dB (at least %.1f) %s\n", name, psnr, minPSNR, passed ? "ok" : "FAILED");
+	return passed;
+}
+
+bool BlockCompression::RunSelfTest()
+{
+	const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5 };
+	const char* formatNames[] = { "", "BC1", "", "BC3", "", "BC5" };
+	bool passed = true;
+	char name[64];
+
+	//Solid blocks only lose what the endpoints round off
+	Random random(1);
+	for (BlockFormat format : formats)
+	{
+		int worst = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			uint8_t pixel[4] = { (uint8_t)random.Range(0, 256), (uint8_t)random.Range(0, 256), (uint8_t)random.Range(0, 256), (uint8_t)random.Range(0, 256) };
+			uint8_t rgba[64];
+			for (int p = 0; p < 16; p++)
+			{
+				memcpy(rgba + p * 4, pixel, 4);
+			}
+			uint8_t block[16];
+			uint8_t decoded[64];
+			int compared = format == BlockFormat::BC5 ? 2 : (format == BlockFormat::BC1 ? 3 : 4);
+			switch (format)
+			{
+			case BlockFormat::BC1: EncodeBC1(rgba, block); DecodeBC1(block, decoded); break;
+			case BlockFormat::BC3: EncodeBC3(rgba, block); DecodeBC3(block, decoded); break;
+			default: EncodeBC5(rgba, block); DecodeBC5(block, decoded); break;
+			}
+			for (int p = 0; p < 16; p++)
+			{
+				for (int c = 0; c < compared; c++)
+				{
+					worst = std::max(worst, std::abs((int)rgba[p * 4 + c] - (int)decoded[p * 4 + c]));
+				}
+			}
+		}
+		bool solidPassed = worst <= MAX_SOLID_ERROR;
+		snprintf(name, sizeof(name), "%s solid blocks", formatNames[(int)format]);
+		printf("%-28s off by at most %d (at most %d) %s\n", name, worst, (int)MAX_SOLID_ERROR, solidPassed ? "ok" : "FAILED");
+		passed = passed && solidPassed;
+	}
+
+	//Smooth gradients in every channel (BC5 gets a bumpy normal map's x and y)
+	const int size = 64;
+	std::vector<uint8_t> gradient((size_t)size * size * 4);
+	std::vector<uint8_t> normals((size_t)size * size * 4);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			uint8_t* pixel = &gradient[((size_t)y * size + x) * 4];
+			pixel[0] = (uint8_t)(x * 255 / (size - 1));
+			pixel[1] = (uint8_t)(y * 255 / (size - 1));
+			pixel[2] = (uint8_t)((x + y) * 255 / (size * 2 - 2));
+			pixel[3] = (uint8_t)(255 - x * 255 / (size - 1));
+
+			float nx = std::sin(x * 0.2f) * 0.5f;
+			float ny = std::cos(y * 0.15f) * 0.5f;
+			uint8_t* normal = &normals[((size_t)y * size + x) * 4];
+			normal[0] = (uint8_t)((nx * 0.5f + 0.5f) * 255.0f);
+			normal[1] = (uint8_t)((ny * 0.5f + 0.5f) * 255.0f);
+			normal[2] = 0;
+			normal[3] = 255;
+		}
+	}
+	passed = CheckRoundTrip("BC1 gradient", BlockFormat::BC1, gradient, size, size, MIN_GRADIENT_PSNR) && passed;
+	passed = CheckRoundTrip("BC3 gradient with alpha", BlockFormat::BC3, gradient, size, size, MIN_GRADIENT_PSNR) && passed;
+	passed = CheckRoundTrip("BC5 normal map", BlockFormat::BC5, normals, size, size, MIN_GRADIENT_PSNR) && passed;
+
+	//Every block picks two colours and scatters them, which both endpoints can hold exactly (bar rounding)
+	std::vector<uint8_t> twoColor((size_t)size * size * 4);
+	for (int by = 0; by < size; by += 4)
+	{
+		for (int bx = 0; bx < size; bx += 4)
+		{
+			uint8_t colors[2][4];
+			for (int c = 0; c < 2; c++)
+			{
+				colors[c][0] = (uint8_t)random.Range(0, 256);
+				colors[c][1] = (uint8_t)random.Range(0, 256);
+				colors[c][2] = (uint8_t)random.Range(0, 256);
+				colors[c][3] = (uint8_t)random.Range(0, 256);
+			}
+			for (int y = 0; y < 4; y++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					memcpy(&twoColor[((size_t)(by + y) * size + bx + x) * 4], colors[random.Range(0, 2)], 4);
+				}
+			}
+		}
+	}
+	for (BlockFormat format : formats)
+	{
+		snprintf(name, sizeof(name), "%s two colour blocks", formatNames[(int)format]);
+		passed = CheckRoundTrip(name, format, twoColor, size, size, MIN_TWO_COLOR_PSNR) && passed;
+	}
+
+	//Sizes that aren't a multiple of 4 repeat the edge into the last blocks
+	const int oddWidth = 13;
+	const int oddHeight = 7;
+	std::vector<uint8_t> odd((size_t)oddWidth * oddHeight * 4);
+	for (int y = 0; y < oddHeight; y++)
+	{
+		memcpy(&odd[(size_t)y * oddWidth * 4], &gradient[(size_t)y * size * 4], (size_t)oddWidth * 4);
+	}
+	passed = CheckRoundTrip("BC1 odd size", BlockFormat::BC1, odd, oddWidth, oddHeight, MIN_GRADIENT_PSNR) && passed;
+
+	printf(passed ? "Block compression self test passed\n" : "Block compression self test FAILED\n");
+	return passed;
+}
+
+void BlockCompression::EncodeBC4(const uint8_t* values, int stride, uint8_t* out)
+{
+	int minValue = 255;
+	int maxValue = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minValue = std::min(minValue, (int)values[i * stride]);
+		maxValue = std::max(maxValue, (int)values[i * stride]);
+	}
+
+	memset(out, 0, 8);
+
+	//Flat block, every index 0 picks the first endpoint
+	if (minValue == maxValue)
+	{
+		out[0] = (uint8_t)maxValue;
+		out[1] = (uint8_t)minValue;
+		return;
+	}
+
+	//First endpoint bigger means the 8 value mode
+	int palette[8];
+	palette[0] = maxValue;
+	palette[1] = minValue;
+	for (int i = 1; i < 7; i++)
+	{
+		palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+	}
+
+	out[0] = (uint8_t)maxValue;
+	out[1] = (uint8_t)minValue;
+
+	//16 indices, 3 bits each
+	uint64_t indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int value = values[i * stride];
+		int best = 0;
+		int bestError = 256;
+		for (int j = 0; j < 8; j++)
+		{
+			int error = std::abs(value - palette[j]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = j;
+			}
+		}
+		indices |= (uint64_t)best << (i * 3);
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		out[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+}
+
+void BlockCompression::DecodeBC4(const uint8_t* block, uint8_t* values, int stride)
+{
+	int palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+	if (palette[0] > palette[1])
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		indices |= (uint64_t)block[2 + i] << (i * 8);
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		values[i * stride] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+	}
+}
+
+void BlockCompression::EncodeColor(const uint8_t* rgba, uint8_t* out)
+{
+	//Find the axis the colours spread out along the most (principal component)
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += rgba[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float r = rgba[i * 4 + 0] - mean[0];
+		float g = rgba[i * 4 + 1] - mean[1];
+		float b = rgba[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	//A few rounds of power iteration is plenty for a 3x3
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+		if (length < 1e-6f)
+			break;
+
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	//The pixels furthest along the axis each way become the endpoints
+	int minIndex = 0;
+	int maxIndex = 0;
+	float minProjection = 1e30f;
+	float maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		float projection = rgba[i * 4 + 0] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+		if (projection < minProjection)
+		{
+			minProjection = projection;
+			minIndex = i;
+		}
+		if (projection > maxProjection)
+		{
+			maxProjection = projection;
+			maxIndex = i;
+		}
+	}
+
+	//Pull the endpoints in a little, the extremes are usually outliers
+	float maxColor[3];
+	float minColor[3];
+	for (int c = 0; c < 3; c++)
+	{
+		float inset = (rgba[maxIndex * 4 + c] - rgba[minIndex * 4 + c]) / 16.0f;
+		maxColor[c] = rgba[maxIndex * 4 + c] - inset;
+		minColor[c] = rgba[minIndex * 4 + c] + inset;
+	}
+
+	uint16_t color0 = PackRGB565(maxColor);
+	uint16_t color1 = PackRGB565(minColor);
+
+	//color0 has to be the bigger one for the 4 colour mode
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	out[0] = (uint8_t)(color0 & 0xFF);
+	out[1] = (uint8_t)(color0 >> 8);
+	out[2] = (uint8_t)(color1 & 0xFF);
+	out[3] = (uint8_t)(color1 >> 8);
+
+	//Both endpoints ended up the same, every index 0 picks it
+	if (color0 == color1)
+	{
+		memset(out + 4, 0, 4);
+		return;
+	}
+
+	int palette[4][3];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int best = 0;
+		int bestError = ColorDistance(rgba + i * 4, palette[0]);
+		for (int j = 1; j < 4; j++)
+		{
+			int error = ColorDistance(rgba + i * 4, palette[j]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = j;
+			}
+		}
+		indices |= (uint32_t)best << (i * 2);
+	}
+
+	out[4] = (uint8_t)(indices);
+	out[5] = (uint8_t)(indices >> 8);
+	out[6] = (uint8_t)(indices >> 16);
+	out[7] = (uint8_t)(indices >> 24);
+}
+
+void BlockCompression::DecodeColor(const uint8_t* block, uint8_t* rgba, bool allowThreeColor)
+{
+	uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+
+	int palette[4][4];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+
+	if (color0 > color1 || !allowThreeColor)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+	}
+	else
+	{
+		//3 colour mode, the last one is transparent black
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		const int* color = palette[(indices >> (i * 2)) & 3];
+		for (int c = 0; c < 4; c++)
+		{
+			rgba[i * 4 + c] = (uint8_t)color[c];
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//The block compressed formats we can encode
+//*BC1 for opaque colour, BC3 for colour with alpha, BC5 for two channel normal maps
+enum class BlockFormat : uint32_t
+{
+	BC1 = 1,
+	BC3 = 3,
+	BC5 = 5
+};
+
+//CPU encoder (and decoder) for BC1/BC3/BC5
+//*Doesn't touch OpenGL so it can run without a window
+class BlockCompression abstract
+{
+public:
+	//Encodes a 4x4 block of RGBA8 pixels (row major, 64 bytes)
+	//*BC1 writes 8 bytes, BC3 and BC5 write 16
+	static void EncodeBC1(const uint8_t* rgba, uint8_t* out);
+	static void EncodeBC3(const uint8_t* rgba, uint8_t* out);
+	static void EncodeBC5(const uint8_t* rgba, uint8_t* out);
+
+	//Decodes a block back into 4x4 RGBA8 pixels
+	//*BC5 puts its two channels in red and green, with blue 0 and alpha 255
+	static void DecodeBC1(const uint8_t* block, uint8_t* rgba);
+	static void DecodeBC3(const uint8_t* block, uint8_t* rgba);
+	static void DecodeBC5(const uint8_t* block, uint8_t* rgba);
+
+	//Encodes a whole RGBA8 image, edge blocks repeat the last row/column
+	static void EncodeImage(BlockFormat format, const uint8_t* rgba, int width, int height, std::vector<uint8_t>& out);
+	//Decodes a whole image back into RGBA8
+	static void DecodeImage(BlockFormat format, const uint8_t* blocks, int width, int height, std::vector<uint8_t>& out);
+
+	//How many bytes one 4x4 block takes
+	static size_t GetBlockSize(BlockFormat format);
+	//How many bytes an image of this size takes
+	static size_t GetImageSize(BlockFormat format, int width, int height);
+
+	//Peak signal to noise ratio between an image and its decoded copy, over the channels the format keeps (in dB)
+	static double GetPSNR(BlockFormat format, const uint8_t* original, const uint8_t* decoded, size_t pixels);
+
+	//Round trips synthetic images through every format and checks they come back close enough, printing each result
+	//*Needs no files or OpenGL (main runs it with --test-block-compression), returns false if any check failed
+	static bool RunSelfTest();
+
+	//Lowest PSNR the self test accepts for smooth gradients, and for blocks of two scattered colours
+	//*Colour endpoints get pulled in by a 16th of their range, so hard edges between very different colours lose a bit more
+	static constexpr double MIN_GRADIENT_PSNR = 36.0;
+	static constexpr double MIN_TWO_COLOR_PSNR = 28.0;
+	//Most a solid block's channel can be off by (5 and 6 bit endpoints round)
+	static const int MAX_SOLID_ERROR = 4;
+private:
+	//Round trips an image and checks its PSNR, printing the result
+	static bool CheckRoundTrip(const char* name, BlockFormat format, const std::vector<uint8_t>& rgba, int width, int height, double minPSNR);
+	//Single channel block (the alpha half of BC3, and both halves of BC5)
+	//*stride is the distance between values in the source, 16 values get read
+	static void EncodeBC4(const uint8_t* values, int stride, uint8_t* out);
+	static void DecodeBC4(const uint8_t* block, uint8_t* values, int stride);
+	//Colour half of BC1 and BC3 (BC3 never uses the 3 colour mode)
+	static void EncodeColor(const uint8_t* rgba, uint8_t* out);
+	static void DecodeColor(const uint8_t* block, uint8_t* rgba, bool allowThreeColor);
+};
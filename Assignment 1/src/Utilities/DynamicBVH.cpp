@@ -0,0 +1,512 @@
+#include "DynamicBVH.h"
+#include <cstdio>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include "Utilities/Random.h"
+
+bool AABB::Contains(const AABB& other) const
+{
+	return Min.x <= other.Min.x && Min.y <= other.Min.y && Min.z <= other.Min.z &&
+		Max.x >= other.Max.x && Max.y >= other.Max.y && Max.z >= other.Max.z;
+}
+
+bool AABB::Overlaps(const AABB& other) const
+{
+	return Min.x <= other.Max.x && Min.y <= other.Max.y && Min.z <= other.Max.z &&
+		Max.x >= other.Min.x && Max.y >= other.Min.y && Max.z >= other.Min.z;
+}
+
+AABB AABB::Merge(const AABB& a, const AABB& b)
+{
+	AABB result;
+	result.Min = glm::min(a.Min, b.Min);
+	result.Max = glm::max(a.Max, b.Max);
+	return result;
+}
+
+float AABB::GetCost() const
+{
+	glm::vec3 size = Max - Min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+DynamicBVH::DynamicBVH()
+{
+}
+
+int DynamicBVH::Insert(const AABB& box, uint32_t data)
+{
+	int proxy = AllocateNode();
+	Node& node = _nodes[proxy];
+	node.Box.Min = box.Min - glm::vec3(MARGIN);
+	node.Box.Max = box.Max + glm::vec3(MARGIN);
+	node.Data = data;
+	node.Height = 0;
+
+	InsertLeaf(proxy);
+	_proxyCount++;
+	return proxy;
+}
+
+void DynamicBVH::Remove(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	_proxyCount--;
+}
+
+bool DynamicBVH::Move(int proxy, const AABB& box)
+{
+	if (_nodes[proxy].Box.Contains(box))
+		return false;
+
+	RemoveLeaf(proxy);
+	_nodes[proxy].Box.Min = box.Min - glm::vec3(MARGIN);
+	_nodes[proxy].Box.Max = box.Max + glm::vec3(MARGIN);
+	InsertLeaf(proxy);
+	return true;
+}
+
+void DynamicBVH::Clear()
+{
+	_nodes.clear();
+	_root = NULL_NODE;
+	_freeList = NULL_NODE;
+	_proxyCount = 0;
+}
+
+void DynamicBVH::Rebuild()
+{
+	//Keep the leaves, free everything above them
+	std::vector<int> leaves;
+	leaves.reserve(_proxyCount);
+	for (int i = 0; i < (int)_nodes.size(); i++)
+	{
+		if (_nodes[i].Height == 0)
+		{
+			leaves.push_back(i);
+		}
+		else if (_nodes[i].Height > 0)
+		{
+			FreeNode(i);
+		}
+	}
+
+	_root = leaves.empty() ? NULL_NODE : BuildRange(leaves, 0, leaves.size());
+	if (_root != NULL_NODE)
+	{
+		_nodes[_root].Parent = NULL_NODE;
+	}
+}
+
+uint32_t DynamicBVH::GetData(int proxy) const
+{
+	return _nodes[proxy].Data;
+}
+
+const AABB& DynamicBVH::GetFatBox(int proxy) const
+{
+	return _nodes[proxy].Box;
+}
+
+int DynamicBVH::GetProxyCount() const
+{
+	return _proxyCount;
+}
+
+int DynamicBVH::GetHeight() const
+{
+	return _root == NULL_NODE ? 0 : _nodes[_root].Height + 1;
+}
+
+float DynamicBVH::GetQualityRatio() const
+{
+	if (_root == NULL_NODE)
+		return 0.0f;
+
+	float total = 0.0f;
+	for (const Node& node : _nodes)
+	{
+		if (node.Height > 0)
+			total += node.Box.GetCost();
+	}
+	return total / std::max(_nodes[_root].Box.GetCost(), 1e-6f);
+}
+
+int DynamicBVH::AllocateNode()
+{
+	if (_freeList == NULL_NODE)
+	{
+		_nodes.emplace_back();
+		return (int)_nodes.size() - 1;
+	}
+
+	int node = _freeList;
+	_freeList = _nodes[node].Parent;
+	_nodes[node] = Node();
+	return node;
+}
+
+void DynamicBVH::FreeNode(int node)
+{
+	_nodes[node].Parent = _freeList;
+	_nodes[node].Height = -1;
+	_freeList = node;
+}
+
+void DynamicBVH::InsertLeaf(int leaf)
+{
+	if (_root == NULL_NODE)
+	{
+		_root = leaf;
+		_nodes[leaf].Parent = NULL_NODE;
+		return;
+	}
+
+	//Walk down to the best sibling, going whichever way grows the tree the least
+	AABB leafBox = _nodes[leaf].Box;
+	int index = _root;
+	while (!_nodes[index].IsLeaf())
+	{
+		const Node& node = _nodes[index];
+		float cost = node.Box.GetCost();
+		float combinedCost = AABB::Merge(node.Box, leafBox).GetCost();
+
+		//Cost of making a new parent for this node and the leaf
+		float siblingCost = 2.0f * combinedCost;
+		//Everything under here grows by at least this much
+		float inheritedCost = 2.0f * (combinedCost - cost);
+
+		//Cost of going down each child
+		float childCosts[2];
+		int children[2] = { node.Child1, node.Child2 };
+		for (int i = 0; i < 2; i++)
+		{
+			const Node& child = _nodes[children[i]];
+			float merged = AABB::Merge(leafBox, child.Box).GetCost();
+			childCosts[i] = child.IsLeaf() ? merged + inheritedCost : merged - child.Box.GetCost() + inheritedCost;
+		}
+
+		if (siblingCost < childCosts[0] && siblingCost < childCosts[1])
+			break;
+
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	//Make a new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = _nodes[sibling].Parent;
+	int newParent = AllocateNode();
+	_nodes[newParent].Parent = oldParent;
+	_nodes[newParent].Box = AABB::Merge(leafBox, _nodes[sibling].Box);
+	_nodes[newParent].Height = _nodes[sibling].Height + 1;
+	_nodes[newParent].Child1 = sibling;
+	_nodes[newParent].Child2 = leaf;
+	_nodes[sibling].Parent = newParent;
+	_nodes[leaf].Parent = newParent;
+
+	if (oldParent == NULL_NODE)
+	{
+		_root = newParent;
+	}
+	else if (_nodes[oldParent].Child1 == sibling)
+	{
+		_nodes[oldParent].Child1 = newParent;
+	}
+	else
+	{
+		_nodes[oldParent].Child2 = newParent;
+	}
+
+	//Refit and rebalance back up to the root
+	index = _nodes[leaf].Parent;
+	while (index != NULL_NODE)
+	{
+		index = Balance(index);
+		Node& node = _nodes[index];
+		node.Height = 1 + std::max(_nodes[node.Child1].Height, _nodes[node.Child2].Height);
+		node.Box = AABB::Merge(_nodes[node.Child1].Box, _nodes[node.Child2].Box);
+		index = node.Parent;
+	}
+}
+
+void DynamicBVH::RemoveLeaf(int leaf)
+{
+	if (leaf == _root)
+	{
+		_root = NULL_NODE;
+		return;
+	}
+
+	//The leaf's parent goes, and its sibling takes the parent's place
+	int parent = _nodes[leaf].Parent;
+	int grandParent = _nodes[parent].Parent;
+	int sibling = _nodes[parent].Child1 == leaf ? _nodes[parent].Child2 : _nodes[parent].Child1;
+
+	if (grandParent == NULL_NODE)
+	{
+		_root = sibling;
+		_nodes[sibling].Parent = NULL_NODE;
+		FreeNode(parent);
+		return;
+	}
+
+	if (_nodes[grandParent].Child1 == parent)
+	{
+		_nodes[grandParent].Child1 = sibling;
+	}
+	else
+	{
+		_nodes[grandParent].Child2 = sibling;
+	}
+	_nodes[sibling].Parent = grandParent;
+	FreeNode(parent);
+
+	int index = grandParent;
+	while (index != NULL_NODE)
+	{
+		index = Balance(index);
+		Node& node = _nodes[index];
+		node.Box = AABB::Merge(_nodes[node.Child1].Box, _nodes[node.Child2].Box);
+		node.Height = 1 + std::max(_nodes[node.Child1].Height, _nodes[node.Child2].Height);
+		index = node.Parent;
+	}
+}
+
+int DynamicBVH::Balance(int a)
+{
+	Node& nodeA = _nodes[a];
+	if (nodeA.IsLeaf() || nodeA.Height < 2)
+		return a;
+
+	int b = nodeA.Child1;
+	int c = nodeA.Child2;
+	int balance = _nodes[c].Height - _nodes[b].Height;
+	if (balance >= -1 && balance <= 1)
+		return a;
+
+	//Lift the deeper child up into a's place, a takes the shallower of its children
+	//*up is the child being lifted, other is a's child that stays
+	int up = balance > 1 ? c : b;
+	int other = balance > 1 ? b : c;
+	Node& nodeUp = _nodes[up];
+	int f = nodeUp.Child1;
+	int g = nodeUp.Child2;
+
+	//Swap a and up
+	nodeUp.Child1 = a;
+	nodeUp.Parent = nodeA.Parent;
+	nodeA.Parent = up;
+
+	if (nodeUp.Parent == NULL_NODE)
+	{
+		_root = up;
+	}
+	else if (_nodes[nodeUp.Parent].Child1 == a)
+	{
+		_nodes[nodeUp.Parent].Child1 = up;
+	}
+	else
+	{
+		_nodes[nodeUp.Parent].Child2 = up;
+	}
+
+	//The taller of up's children stays with up, the other goes under a
+	int keep = _nodes[f].Height > _nodes[g].Height ? f : g;
+	int give = keep == f ? g : f;
+	nodeUp.Child2 = keep;
+	if (balance > 1)
+	{
+		nodeA.Child2 = give;
+	}
+	else
+	{
+		nodeA.Child1 = give;
+	}
+	_nodes[give].Parent = a;
+
+	nodeA.Box = AABB::Merge(_nodes[other].Box, _nodes[give].Box);
+	nodeUp.Box = AABB::Merge(nodeA.Box, _nodes[keep].Box);
+	nodeA.Height = 1 + std::max(_nodes[other].Height, _nodes[give].Height);
+	nodeUp.Height = 1 + std::max(nodeA.Height, _nodes[keep].Height);
+
+	return up;
+}
+
+int DynamicBVH::BuildRange(std::vector<int>& leaves, size_t begin, size_t end)
+{
+	if (end - begin == 1)
+		return leaves[begin];
+
+	//Split along whichever axis the centres are most spread out on (Min + Max is twice the centre, that's fine for sorting)
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+	for (size_t i = begin; i < end; i++)
+	{
+		glm::vec3 centre = _nodes[leaves[i]].Box.Min + _nodes[leaves[i]].Box.Max;
+		min = glm::min(min, centre);
+		max = glm::max(max, centre);
+	}
+	glm::vec3 spread = max - min;
+	int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+	auto centreOnAxis = [&](int node) {
+		const AABB& box = _nodes[node].Box;
+		return axis == 0 ? box.Min.x + box.Max.x : axis == 1 ? box.Min.y + box.Max.y : box.Min.z + box.Max.z;
+	};
+
+	size_t middle = begin + (end - begin) / 2;
+	std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end, [&](int a, int b) {
+		return centreOnAxis(a) < centreOnAxis(b);
+	});
+
+	int child1 = BuildRange(leaves, begin, middle);
+	int child2 = BuildRange(leaves, middle, end);
+
+	int parent = AllocateNode();
+	Node& node = _nodes[parent];
+	node.Child1 = child1;
+	node.Child2 = child2;
+	node.Box = AABB::Merge(_nodes[child1].Box, _nodes[child2].Box);
+	node.Height = 1 + std::max(_nodes[child1].Height, _nodes[child2].Height);
+	_nodes[child1].Parent = parent;
+	_nodes[child2].Parent = parent;
+	return parent;
+}
+
+void DynamicBVH::RunBenchmark()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	auto millis = [](Clock::time_point from) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+	};
+
+	const int counts[3] = { 10000, 100000, 1000000 };
+	const int queries = 1000;
+	for (int count : counts)
+	{
+		//Keep the density the same at every size, so each query finds about as many things
+		float side = std::cbrt((float)count) * 4.0f;
+		Random random(count);
+
+		std::vector<AABB> boxes(count);
+		for (AABB& box : boxes)
+		{
+			glm::vec3 centre = random.Range(glm::vec3(0.0f), glm::vec3(side));
+			glm::vec3 extents = random.Range(glm::vec3(0.1f), glm::vec3(1.0f));
+			box.Min = centre - extents;
+			box.Max = centre + extents;
+		}
+
+		DynamicBVH tree;
+		std::vector<int> proxies(count);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			proxies[i] = tree.Insert(boxes[i], (uint32_t)i);
+		}
+		double insertTime = millis(start);
+		printf("%d proxies: inserted one at a time in %.1f ms\n", count, insertTime);
+
+		//Every query gets the same shapes each time through
+		std::vector<glm::vec3> points(queries);
+		std::vector<glm::vec3> directions(queries);
+		for (int i = 0; i < queries; i++)
+		{
+			points[i] = random.Range(glm::vec3(0.0f), glm::vec3(side));
+			directions[i] = glm::normalize(random.Range(glm::vec3(-1.0f), glm::vec3(1.0f)));
+		}
+
+		auto runQueries = [&](const char* label) {
+			printf("  %s: height %d, quality %.1f\n", label, tree.GetHeight(), tree.GetQualityRatio());
+
+			size_t boxHits = 0;
+			Clock::time_point start = Clock::now();
+			for (const glm::vec3& point : points)
+			{
+				AABB query;
+				query.Min = point - glm::vec3(4.0f);
+				query.Max = point + glm::vec3(4.0f);
+				tree.QueryAABB(query, [&](uint32_t) { boxHits++; });
+			}
+			printf("    box     %.4f ms/query (%.1f hits)\n", millis(start) / queries, (double)boxHits / queries);
+
+			size_t sphereHits = 0;
+			start = Clock::now();
+			for (const glm::vec3& point : points)
+			{
+				tree.QuerySphere(point, 4.0f, [&](uint32_t) { sphereHits++; });
+			}
+			printf("    sphere  %.4f ms/query (%.1f hits)\n", millis(start) / queries, (double)sphereHits / queries);
+
+			//Rays across the whole volume, only keeping the closest hit
+			size_t rayHits = 0;
+			start = Clock::now();
+			for (int i = 0; i < queries; i++)
+			{
+				bool hit = false;
+				tree.RayCast(points[i], directions[i], side, [&](uint32_t, float distance) { hit = true; return distance; });
+				rayHits += hit ? 1 : 0;
+			}
+			printf("    ray     %.4f ms/query (%d%% hit something)\n", millis(start) / queries, (int)(rayHits * 100 / queries));
+
+			//A 90 degree frustum looking down +z, 20 units deep
+			size_t frustumHits = 0;
+			start = Clock::now();
+			for (const glm::vec3& eye : points)
+			{
+				float s = 0.70710678f;
+				glm::vec4 planes[6] = {
+					glm::vec4(s, 0.0f, s, -(s * eye.x + s * eye.z)),
+					glm::vec4(-s, 0.0f, s, -(-s * eye.x + s * eye.z)),
+					glm::vec4(0.0f, s, s, -(s * eye.y + s * eye.z)),
+					glm::vec4(0.0f, -s, s, -(-s * eye.y + s * eye.z)),
+					glm::vec4(0.0f, 0.0f, 1.0f, -(eye.z + 0.1f)),
+					glm::vec4(0.0f, 0.0f, -1.0f, eye.z + 20.0f)
+				};
+				tree.QueryFrustum(planes, 6, [&](uint32_t) { frustumHits++; });
+			}
+			printf("    frustum %.4f ms/query (%.1f hits)\n", millis(start) / queries, (double)frustumHits / queries);
+			return boxHits;
+		};
+
+		size_t insertedHits = runQueries("inserted");
+
+		start = Clock::now();
+		tree.Rebuild();
+		printf("  rebuilt in %.1f ms\n", millis(start));
+		size_t rebuiltHits = runQueries("rebuilt");
+
+		//What the tree saves over checking everything (the fat boxes catch a few extras, so the scan uses them too)
+		size_t scanHits = 0;
+		start = Clock::now();
+		for (const glm::vec3& point : points)
+		{
+			AABB query;
+			query.Min = point - glm::vec3(4.0f);
+			query.Max = point + glm::vec3(4.0f);
+			for (int proxy : proxies)
+			{
+				if (tree.GetFatBox(proxy).Overlaps(query))
+					scanHits++;
+			}
+		}
+		printf("  linear box scan %.4f ms/query (%s)\n", millis(start) / queries,
+			scanHits == insertedHits && scanHits == rebuiltHits ? "same hits" : "HITS DON'T MATCH");
+
+		//Nudge 1% of the boxes
+		int moved = count / 100;
+		int reinserted = 0;
+		start = Clock::now();
+		for (int i = 0; i < moved; i++)
+		{
+			int index = random.Range(0, count);
+			glm::vec3 offset = random.Range(glm::vec3(-0.15f), glm::vec3(0.15f));
+			boxes[index].Min += offset;
+			boxes[index].Max += offset;
+			reinserted += tree.Move(proxies[index], boxes[index]) ? 1 : 0;
+		}
+		printf("  moved %d, %d left their fat box, %.2f ms\n", moved, reinserted, millis(start));
+	}
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <GLM/glm.hpp>
+
+//An axis aligned box
+struct AABB
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+
+	//Does this box completely hold the other one
+	bool Contains(const AABB& other) const;
+	bool Overlaps(const AABB& other) const;
+	//Box around both boxes
+	static AABB Merge(const AABB& a, const AABB& b);
+	//Half the surface area, what the tree tries to keep small
+	float GetCost() const;
+};
+
+//A bounding volume hierarchy that things can be added to, moved in and removed from at any time
+//*Leaves hold "fat" boxes, grown by a margin, so something jiggling in place doesn't touch the tree
+//*Inserting picks the sibling that grows the tree's surface area the least, then rotates nodes to keep it balanced
+//*Queries walk down from the root and skip any branch whose box misses, so they cost log n instead of n
+class DynamicBVH
+{
+public:
+	DynamicBVH();
+
+	//Adds a box, returns the proxy id used to move or remove it
+	//*data is handed back by queries (an entity, an index, whatever you need)
+	int Insert(const AABB& box, uint32_t data);
+	//Takes a proxy out of the tree
+	void Remove(int proxy);
+	//Moves a proxy to a new box
+	//*Only touches the tree if the box left the fat box, returns whether it did
+	bool Move(int proxy, const AABB& box);
+	//Empties the tree
+	void Clear();
+	//Throws away the branches and builds them again top down, splitting the leaves in half along their longest axis each time
+	//*Inserting one at a time makes a looser tree than this, so do it after adding a lot at once (proxy ids stay the same)
+	void Rebuild();
+
+	uint32_t GetData(int proxy) const;
+	const AABB& GetFatBox(int proxy) const;
+
+	//Calls func(data) for every proxy whose box overlaps the box
+	template <typename Func>
+	void QueryAABB(const AABB& box, Func func) const;
+	//Calls func(data) for every proxy whose box touches the sphere
+	template <typename Func>
+	void QuerySphere(const glm::vec3& centre, float radius, Func func) const;
+	//Calls func(data) for every proxy whose box isn't completely outside the planes
+	//*Planes are (normal, distance) with the normals pointing inwards, like FrustumCuller's
+	//*Branches completely inside get handed over without testing anything under them
+	template <typename Func>
+	void QueryFrustum(const glm::vec4* planes, int planeCount, Func func) const;
+	//Calls func(data, distance) for every proxy whose box the ray hits within maxDistance, roughly front to back
+	//*func returns the distance to keep searching up to (return the hit distance to only find the closest thing,
+	// maxDistance to find everything, or 0 to stop)
+	template <typename Func>
+	void RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Func func) const;
+
+	//How many proxies are in the tree
+	int GetProxyCount() const;
+	//How many levels the tree has (0 when it's empty)
+	int GetHeight() const;
+	//Sum of every branch's cost over the root's, lower means tighter queries
+	float GetQualityRatio() const;
+
+	//Times building, querying and moving at 10k, 100k and 1M proxies, against a linear scan, and prints it
+	static void RunBenchmark();
+
+	//How far a leaf's box is grown past the real one
+	static constexpr float MARGIN = 0.1f;
+	//Deepest a query will go (a balanced tree of billions of proxies is nowhere near this)
+	static const int MAX_STACK = 256;
+private:
+	static const int NULL_NODE = -1;
+
+	struct Node
+	{
+		AABB Box;
+		//Parent while in the tree, next free node while on the free list
+		int Parent = NULL_NODE;
+		int Child1 = NULL_NODE;
+		int Child2 = NULL_NODE;
+		//Leaves are 0, free nodes are -1
+		int Height = -1;
+		uint32_t Data = 0;
+
+		bool IsLeaf() const { return Child1 == NULL_NODE; }
+	};
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	//Rotates the tree around a node if one side is deeper than the other, returns the node now in its place
+	int Balance(int node);
+	//Builds the branches over leaves [begin, end), returns the node at the top
+	int BuildRange(std::vector<int>& leaves, size_t begin, size_t end);
+
+	std::vector<Node> _nodes;
+	int _root = NULL_NODE;
+	int _freeList = NULL_NODE;
+	int _proxyCount = 0;
+};
+
+template <typename Func>
+void DynamicBVH::QueryAABB(const AABB& box, Func func) const
+{
+	if (_root == NULL_NODE)
+		return;
+
+	int stack[MAX_STACK];
+	int count = 0;
+	stack[count++] = _root;
+	while (count > 0)
+	{
+		const Node& node = _nodes[stack[--count]];
+		if (!node.Box.Overlaps(box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			func(node.Data);
+		}
+		else
+		{
+			stack[count++] = node.Child1;
+			stack[count++] = node.Child2;
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBVH::QuerySphere(const glm::vec3& centre, float radius, Func func) const
+{
+	if (_root == NULL_NODE)
+		return;
+
+	float radiusSquared = radius * radius;
+	int stack[MAX_STACK];
+	int count = 0;
+	stack[count++] = _root;
+	while (count > 0)
+	{
+		const Node& node = _nodes[stack[--count]];
+		//Closest point in the box to the centre
+		glm::vec3 offset = glm::clamp(centre, node.Box.Min, node.Box.Max) - centre;
+		if (glm::dot(offset, offset) > radiusSquared)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			func(node.Data);
+		}
+		else
+		{
+			stack[count++] = node.Child1;
+			stack[count++] = node.Child2;
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBVH::QueryFrustum(const glm::vec4* planes, int planeCount, Func func) const
+{
+	if (_root == NULL_NODE)
+		return;
+
+	//Each entry carries whether its parent was already completely inside
+	struct Entry
+	{
+		int Node;
+		bool Inside;
+	};
+	Entry stack[MAX_STACK];
+	int count = 0;
+	stack[count++] = { _root, false };
+	while (count > 0)
+	{
+		Entry entry = stack[--count];
+		const Node& node = _nodes[entry.Node];
+
+		bool inside = entry.Inside;
+		if (!inside)
+		{
+			glm::vec3 centre = (node.Box.Min + node.Box.Max) * 0.5f;
+			glm::vec3 extents = (node.Box.Max - node.Box.Min) * 0.5f;
+			bool outside = false;
+			inside = true;
+			for (int p = 0; p < planeCount && !outside; p++)
+			{
+				glm::vec3 normal = glm::vec3(planes[p]);
+				float distance = glm::dot(normal, centre) + planes[p].w;
+				//How far the box reaches along the normal
+				float reach = glm::dot(extents, glm::abs(normal));
+				if (distance < -reach)
+					outside = true;
+				else if (distance < reach)
+					inside = false;
+			}
+			if (outside)
+				continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			func(node.Data);
+		}
+		else
+		{
+			stack[count++] = { node.Child1, inside };
+			stack[count++] = { node.Child2, inside };
+		}
+	}
+}
+
+template <typename Func>
+void DynamicBVH::RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Func func) const
+{
+	if (_root == NULL_NODE)
+		return;
+
+	glm::vec3 inverse = 1.0f / direction;
+	//Slab test, returns the distance the ray enters the box at (or -1 if it misses)
+	auto enter = [&](const AABB& box) {
+		glm::vec3 t1 = (box.Min - origin) * inverse;
+		glm::vec3 t2 = (box.Max - origin) * inverse;
+		glm::vec3 tMin = glm::min(t1, t2);
+		glm::vec3 tMax = glm::max(t1, t2);
+		float nearest = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+		float furthest = glm::min(glm::min(tMax.x, tMax.y), tMax.z);
+		return nearest <= furthest && nearest <= maxDistance ? nearest : -1.0f;
+	};
+
+	struct Entry
+	{
+		int Node;
+		float Distance;
+	};
+	Entry stack[MAX_STACK];
+	int count = 0;
+	float rootDistance = enter(_nodes[_root].Box);
+	if (rootDistance >= 0.0f)
+	{
+		stack[count++] = { _root, rootDistance };
+	}
+	while (count > 0)
+	{
+		Entry entry = stack[--count];
+		//The ray might have been clipped since this got pushed
+		if (entry.Distance > maxDistance)
+			continue;
+
+		const Node& node = _nodes[entry.Node];
+		if (node.IsLeaf())
+		{
+			maxDistance = func(node.Data, entry.Distance);
+			if (maxDistance <= 0.0f)
+				return;
+			continue;
+		}
+
+		//Push the further child first so the nearer one gets looked at first
+		float distance1 = enter(_nodes[node.Child1].Box);
+		float distance2 = enter(_nodes[node.Child2].Box);
+		Entry first = { node.Child1, distance1 };
+		Entry second = { node.Child2, distance2 };
+		if (distance2 >= 0.0f && (distance1 < 0.0f || distance2 < distance1))
+		{
+			std::swap(first, second);
+		}
+		if (second.Distance >= 0.0f)
+			stack[count++] = second;
+		if (first.Distance >= 0.0f)
+			stack[count++] = first;
+	}
+}
@@ -1,7 +1,14 @@
 #include "EnvironmentGenerator.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "Utilities/Profiler.h"
 
-//The gameobject references to the spawned objects
-std::vector<std::vector<GameObject>> EnvironmentGenerator::_objectsSpawned;
+//The entities spawned, grouped by object
+std::vector<std::vector<entt::entity>> EnvironmentGenerator::_objectsSpawned;
 
 //Object information for being spawned
 std::vector<VertexArrayObject::sptr> EnvironmentGenerator::_vaosToSpawn;
@@ -12,10 +19,26 @@ std::vector<glm::vec2> EnvironmentGenerator::_spawnFromAll;
 std::vector<glm::vec2> EnvironmentGenerator::_spawnToAll;
 std::vector<std::vector<glm::vec2>> EnvironmentGenerator::_avoidFromAll;
 std::vector<std::vector<glm::vec2>> EnvironmentGenerator::_avoidToAll;
+std::vector<float> EnvironmentGenerator::_spacingAll;
+std::vector<std::vector<float>> EnvironmentGenerator::_lodSizesAll;
+std::vector<std::vector<std::string>> EnvironmentGenerator::_lodFilesAll;
+std::vector<LODChain::sptr> EnvironmentGenerator::_lodChains;
 
 //The filenames of the objects to spawn
 std::vector<std::string> EnvironmentGenerator::_objectsToSpawn;
 
+//Instancing settings and the batches it spawns
+bool EnvironmentGenerator::_useInstancing = false;
+float EnvironmentGenerator::_densityMultiplier = 1.0f;
+uint64_t EnvironmentGenerator::_seed = 0;
+std::vector<InstanceBatch::sptr> EnvironmentGenerator::_instanceBatches;
+
+//World streaming settings and the tiles it has loaded
+bool EnvironmentGenerator::_streaming = false;
+float EnvironmentGenerator::_streamRadius = 40.0f;
+std::unordered_map<uint64_t, EnvironmentGenerator::Tile> EnvironmentGenerator::_tiles;
+std::unordered_map<uint64_t, std::future<std::vector<std::vector<EnvironmentGenerator::Placement>>>> EnvironmentGenerator::_pendingTiles;
+
 ////Not implemented//
 //std::vector<char> EnvironmentGenerator::_letterRepresentation;
 //std::vector<std::vector<char>> EnvironmentGenerator::_generatedMapPlacements;
@@ -30,48 +53,170 @@ void EnvironmentGenerator::RegenerateEnvironment()
 
 void EnvironmentGenerator::GenerateEnvironment()
 {
+	if (_objectsToSpawn.empty())
+		return;
+
+	//Load in the object vaos (the asset cache hands back the same one if it's already loaded)
 	for (int i = 0; i < _objectsToSpawn.size(); i++)
 	{
-		std::vector<GameObject> temp;
+		if (!_loadedIn[i])
 		{
-			//Load in this object vao
-			if (!_loadedIn[i])
-			{
-				VertexArrayObject::sptr vao = ObjLoader::LoadFromFile(_objectsToSpawn[i]);
-				_vaosToSpawn.push_back(vao);
-				_loadedIn[i] = true;
-			}
+			_vaosToSpawn[i] = AssetCache::GetMesh(_objectsToSpawn[i]);
+			_lodChains[i] = LoadLODChain(i);
+			_loadedIn[i] = true;
+		}
+	}
 
-			for (int j = 0; j < _numToSpawn[i]; j++)
-			{
-				temp.push_back(Application::Instance().ActiveScene->CreateEntity(_objectsToSpawn[i] + (std::to_string(j + 1))));
-				temp[j].emplace<RendererComponent>().SetMesh(_vaosToSpawn[i]).SetMaterial(_materialsForSpawning[i]);
-				//Randomly places
-				temp[j].get<Transform>().SetLocalPosition(glm::vec3(Util::GetRandomNumberBetween(_spawnFromAll[i],
-					_spawnToAll[i], _avoidFromAll[i], _avoidToAll[i]), 0.0f));
-				temp[j].get<Transform>().SetLocalRotation(Util::GetRandomNumberBetween(glm::vec3(90.0f, 0.f, 0.f), glm::vec3(90.0f, 0.0f, 360.0f)));
-				//temp[j].get<Transform>().SetLocalScale(glm::vec3(0.5f));
-			}
+	//Tiles get generated around the camera as it moves instead (see UpdateStreaming)
+	if (_streaming)
+		return;
+
+	//Every chunk any object can spawn in
+	glm::vec2 areaFrom = glm::min(_spawnFromAll[0], _spawnToAll[0]);
+	glm::vec2 areaTo = glm::max(_spawnFromAll[0], _spawnToAll[0]);
+	for (int i = 1; i < _objectsToSpawn.size(); i++)
+	{
+		areaFrom = glm::min(areaFrom, glm::min(_spawnFromAll[i], _spawnToAll[i]));
+		areaTo = glm::max(areaTo, glm::max(_spawnFromAll[i], _spawnToAll[i]));
+	}
+	std::vector<glm::ivec2> chunks;
+	for (int y = (int)std::floor(areaFrom.y / CHUNK_SIZE); y < (int)std::ceil(areaTo.y / CHUNK_SIZE); y++)
+	{
+		for (int x = (int)std::floor(areaFrom.x / CHUNK_SIZE); x < (int)std::ceil(areaTo.x / CHUNK_SIZE); x++)
+		{
+			chunks.push_back(glm::ivec2(x, y));
+		}
+	}
+
+	//Place every chunk at once across the job system
+	std::vector<std::vector<int>> counts = GetChunkCounts(chunks);
+	std::vector<std::vector<std::vector<Placement>>> chunkPlacements(chunks.size());
+	JobSystem::ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			chunkPlacements[i] = PlaceChunk(chunks[i], counts[i], _seed, true);
+		}
+	});
+
+	//Gather them up per object type (in chunk order, so a seed always comes out the same)
+	std::vector<std::vector<Placement>> placements(_objectsToSpawn.size());
+	for (int i = 0; i < _objectsToSpawn.size(); i++)
+	{
+		size_t total = 0;
+		for (const std::vector<std::vector<Placement>>& chunk : chunkPlacements)
+		{
+			total += chunk[i].size();
 		}
 
-		//Add object to the spawned list
-		_objectsSpawned.push_back(temp);
+		placements[i].reserve(total);
+		for (const std::vector<std::vector<Placement>>& chunk : chunkPlacements)
+		{
+			placements[i].insert(placements[i].end(), chunk[i].begin(), chunk[i].end());
+		}
 	}
+
+	CommitPlacements(placements, _objectsSpawned, _instanceBatches);
 }
 
-void EnvironmentGenerator::CleanEnvironment()
+void EnvironmentGenerator::UpdateStreaming(glm::vec3 centre)
 {
-	//Remove all the entities
-	for (int i = 0; i < _objectsSpawned.size(); i++)
+	PROFILE_SCOPE("Environment Streaming");
+	if (!_streaming || _objectsToSpawn.empty())
+		return;
+
+	glm::vec2 position = glm::vec2(centre.x, centre.y);
+	//Tiles only unload once they're a tile past the radius, so walking along the edge doesn't keep reloading them
+	float unloadRadius = _streamRadius + CHUNK_SIZE;
+
+	//Unload the tiles we've walked away from
+	for (auto it = _tiles.begin(); it != _tiles.end();)
+	{
+		if (glm::length(GetTileCentre(GetTileCoord(it->first)) - position) > unloadRadius)
+		{
+			UnloadTile(it->second);
+			it = _tiles.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	//Put in the tiles that finished generating, a few a frame so it doesn't hitch
+	int committed = 0;
+	for (auto it = _pendingTiles.begin(); it != _pendingTiles.end() && committed < MAX_TILE_COMMITS;)
+	{
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		std::vector<std::vector<Placement>> placements = it->second.get();
+		//We might have walked off while it was generating
+		if (glm::length(GetTileCentre(GetTileCoord(it->first)) - position) <= unloadRadius)
+		{
+			Tile& tile = _tiles[it->first];
+			CommitPlacements(placements, tile.Objects, tile.Batches);
+			_instanceBatches.insert(_instanceBatches.end(), tile.Batches.begin(), tile.Batches.end());
+			committed++;
+		}
+		it = _pendingTiles.erase(it);
+	}
+
+	//Find the tiles in range that we don't have yet
+	std::vector<std::pair<float, glm::ivec2>> missing;
+	int minX = (int)std::floor((position.x - _streamRadius) / CHUNK_SIZE);
+	int maxX = (int)std::floor((position.x + _streamRadius) / CHUNK_SIZE);
+	int minY = (int)std::floor((position.y - _streamRadius) / CHUNK_SIZE);
+	int maxY = (int)std::floor((position.y + _streamRadius) / CHUNK_SIZE);
+	for (int y = minY; y <= maxY; y++)
 	{
-		for (int j = 0; j < _objectsSpawned[i].size(); j++)
+		for (int x = minX; x <= maxX; x++)
 		{
-			Application::Instance().ActiveScene->RemoveEntity(_objectsSpawned[i][j]);
+			glm::ivec2 coord = glm::ivec2(x, y);
+			float distance = glm::length(GetTileCentre(coord) - position);
+			uint64_t key = GetTileKey(coord);
+			if (distance <= _streamRadius && _tiles.find(key) == _tiles.end() && _pendingTiles.find(key) == _pendingTiles.end())
+				missing.push_back(std::make_pair(distance, coord));
 		}
 	}
 
+	//Closest ones first, without flooding the job system
+	std::sort(missing.begin(), missing.end(), [](const std::pair<float, glm::ivec2>& a, const std::pair<float, glm::ivec2>& b) {
+		return a.first < b.first;
+	});
+	for (size_t i = 0; i < missing.size() && _pendingTiles.size() < MAX_PENDING_TILES; i++)
+	{
+		glm::ivec2 coord = missing[i].second;
+		std::vector<int> counts = GetTileCounts(coord);
+		uint64_t seed = _seed;
+		_pendingTiles[GetTileKey(coord)] = JobSystem::Submit([coord, counts, seed]() {
+			return PlaceChunk(coord, counts, seed, false);
+		});
+	}
+}
+
+void EnvironmentGenerator::CleanEnvironment()
+{
+	//Drop the streamed tiles (and anything still generating)
+	FinishPendingTiles();
+	for (auto& tile : _tiles)
+	{
+		UnloadTile(tile.second);
+	}
+	_tiles.clear();
+
+	//Remove all the entities, a whole object's worth at a time
+	for (std::vector<entt::entity>& objects : _objectsSpawned)
+	{
+		DestroyObjects(objects);
+	}
+
 	//Clear out objects spawned
 	_objectsSpawned.clear();
+	//Clear out the instance batches (frees their buffers)
+	_instanceBatches.clear();
 }
 
 void EnvironmentGenerator::CleanUpPointers()
@@ -80,11 +225,21 @@ void EnvironmentGenerator::CleanUpPointers()
 	_vaosToSpawn.clear();
 	//Clear up material references so the smart pointers can clear
 	_materialsForSpawning.clear();
+	//And the LOD chains' meshes
+	_lodChains.clear();
+	//Clear up the instance batches so their buffers get freed
+	_instanceBatches.clear();
+	//The scene's already gone, so just forget the tiles
+	FinishPendingTiles();
+	_tiles.clear();
 }
 
 void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMaterial::sptr objMat, int numToSpawn, glm::vec2 spawnFrom, 
-													glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, std::vector<glm::vec2> avoidTo)
+													glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, std::vector<glm::vec2> avoidTo, float spacing)
 {
+	//Tiles still generating read the lists we're about to change
+	FinishPendingTiles();
+
 	//Find the filename in the list
 	int index = Util::FindInVector(fileName, _objectsToSpawn);
 	//If the filename was found in the list we ain't adding it again
@@ -94,9 +249,8 @@ void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMat
 		return;
 	}
 
-	//Loads in the mesh and adds to list
-	VertexArrayObject::sptr vao = ObjLoader::LoadFromFile(fileName);
-	_vaosToSpawn.push_back(vao);
+	//Saves a spot for the mesh, it gets loaded when we first generate
+	_vaosToSpawn.push_back(nullptr);
 	//Adds material to list
 	_materialsForSpawning.push_back(objMat);
 	//Adds number to spawn for this object
@@ -107,6 +261,12 @@ void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMat
 	_spawnToAll.push_back(spawnTo);
 	_avoidFromAll.push_back(avoidFrom);
 	_avoidToAll.push_back(avoidTo);
+	//Adds how far apart to place it
+	_spacingAll.push_back(spacing);
+	//No LODs until they're set
+	_lodSizesAll.push_back(std::vector<float>());
+	_lodFilesAll.push_back(std::vector<std::string>());
+	_lodChains.push_back(nullptr);
 
 	//Adds the filename to the list
 	_objectsToSpawn.push_back(fileName);
@@ -114,8 +274,27 @@ void EnvironmentGenerator::AddObjectToGeneration(std::string fileName, ShaderMat
 	_loadedIn.push_back(false);
 }
 
+void EnvironmentGenerator::SetObjectLODs(std::string fileName, std::vector<float> screenSizes, std::vector<std::string> lodFiles)
+{
+	FinishPendingTiles();
+
+	int index = Util::FindInVector(fileName, _objectsToSpawn);
+	if (index == -1)
+	{
+		printf("Object not found in list\n");
+		return;
+	}
+
+	_lodSizesAll[index] = screenSizes;
+	_lodFilesAll[index] = lodFiles;
+	//Loads the chain again on the next generation
+	_loadedIn[index] = false;
+}
+
 void EnvironmentGenerator::RemoveObjectFromGeneration(std::string fileName)
 {
+	FinishPendingTiles();
+
 	int index = Util::FindInVector(fileName, _objectsToSpawn);
 	if (index == -1)
 	{
@@ -128,8 +307,14 @@ void EnvironmentGenerator::RemoveObjectFromGeneration(std::string fileName)
 	_loadedIn.erase(_loadedIn.begin() + index);
 	_materialsForSpawning.erase(_materialsForSpawning.begin() + index);
 	_numToSpawn.erase(_numToSpawn.begin() + index);
+	_spawnFromAll.erase(_spawnFromAll.begin() + index);
+	_spawnToAll.erase(_spawnToAll.begin() + index);
 	_avoidFromAll.erase(_avoidFromAll.begin() + index);
 	_avoidToAll.erase(_avoidToAll.begin() + index);
+	_spacingAll.erase(_spacingAll.begin() + index);
+	_lodSizesAll.erase(_lodSizesAll.begin() + index);
+	_lodFilesAll.erase(_lodFilesAll.begin() + index);
+	_lodChains.erase(_lodChains.begin() + index);
 	
 	//erase the filename from the list
 	_objectsToSpawn.erase(_objectsToSpawn.begin() + index);
@@ -139,3 +324,364 @@ std::vector<std::string> EnvironmentGenerator::GetObjectsOnList()
 {
 	return _objectsToSpawn;
 }
+
+void EnvironmentGenerator::SetInstancing(bool instancing)
+{
+	_useInstancing = instancing;
+}
+
+bool EnvironmentGenerator::GetInstancing()
+{
+	return _useInstancing;
+}
+
+void EnvironmentGenerator::SetDensityMultiplier(float multiplier)
+{
+	//Can't spawn a negative amount
+	_densityMultiplier = glm::max(multiplier, 0.0f);
+}
+
+float EnvironmentGenerator::GetDensityMultiplier()
+{
+	return _densityMultiplier;
+}
+
+void EnvironmentGenerator::SetSeed(uint64_t seed)
+{
+	_seed = seed;
+}
+
+uint64_t EnvironmentGenerator::GetSeed()
+{
+	return _seed;
+}
+
+void EnvironmentGenerator::SetStreaming(bool streaming)
+{
+	_streaming = streaming;
+}
+
+bool EnvironmentGenerator::GetStreaming()
+{
+	return _streaming;
+}
+
+void EnvironmentGenerator::SetStreamRadius(float radius)
+{
+	//Always keep at least the tile we're standing on
+	_streamRadius = glm::max(radius, CHUNK_SIZE);
+}
+
+float EnvironmentGenerator::GetStreamRadius()
+{
+	return _streamRadius;
+}
+
+int EnvironmentGenerator::GetLoadedTileCount()
+{
+	return (int)_tiles.size();
+}
+
+int EnvironmentGenerator::GetPendingTileCount()
+{
+	return (int)_pendingTiles.size();
+}
+
+const std::vector<InstanceBatch::sptr>& EnvironmentGenerator::GetInstanceBatches()
+{
+	return _instanceBatches;
+}
+
+std::vector<std::vector<int>> EnvironmentGenerator::GetChunkCounts(const std::vector<glm::ivec2>& chunks)
+{
+	std::vector<std::vector<int>> counts(chunks.size(), std::vector<int>(_objectsToSpawn.size(), 0));
+	for (int i = 0; i < _objectsToSpawn.size(); i++)
+	{
+		glm::vec2 spawnFrom = glm::min(_spawnFromAll[i], _spawnToAll[i]);
+		glm::vec2 spawnTo = glm::max(_spawnFromAll[i], _spawnToAll[i]);
+
+		//Roughly how much of each chunk this object can spawn in (inside its area, outside its avoid areas)
+		std::vector<float> freeArea(chunks.size(), 0.0f);
+		float totalFree = 0.0f;
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			glm::vec2 from = glm::max(glm::vec2(chunks[c]) * CHUNK_SIZE, spawnFrom);
+			glm::vec2 to = glm::min(glm::vec2(chunks[c]) * CHUNK_SIZE + CHUNK_SIZE, spawnTo);
+			freeArea[c] = GetFreeArea(i, from, to);
+			totalFree += freeArea[c];
+		}
+
+		if (totalFree <= 0.0f)
+			continue;
+
+		//Share the count out by free area, handing what the rounding lost to the biggest remainders
+		int numToSpawn = GetNumToSpawn(i);
+		int given = 0;
+		std::vector<std::pair<float, size_t>> remainders;
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			float share = numToSpawn * freeArea[c] / totalFree;
+			counts[c][i] = (int)share;
+			given += counts[c][i];
+			remainders.push_back(std::make_pair(share - (int)share, c));
+		}
+		std::stable_sort(remainders.begin(), remainders.end(), [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+			return a.first > b.first;
+		});
+		for (size_t r = 0; given < numToSpawn && r < remainders.size(); r++, given++)
+		{
+			counts[remainders[r].second][i]++;
+		}
+	}
+
+	return counts;
+}
+
+std::vector<int> EnvironmentGenerator::GetTileCounts(glm::ivec2 tile)
+{
+	glm::vec2 tileFrom = GetTileCentre(tile) - CHUNK_SIZE * 0.5f;
+	glm::vec2 tileTo = tileFrom + CHUNK_SIZE;
+
+	//The fractions get rounded up or down randomly (but the same way every time for this tile and seed)
+	Random random(Random::DeriveSeed(_seed ^ 0xC0FFEEull, GetTileKey(tile)));
+
+	std::vector<int> counts(_objectsToSpawn.size(), 0);
+	for (int i = 0; i < _objectsToSpawn.size(); i++)
+	{
+		//Keeps the same density as the spawn area would have, just everywhere
+		glm::vec2 spawnSize = glm::abs(_spawnToAll[i] - _spawnFromAll[i]);
+		float spawnArea = spawnSize.x * spawnSize.y;
+		if (spawnArea <= 0.0f)
+			continue;
+
+		float expected = GetNumToSpawn(i) / spawnArea * GetFreeArea(i, tileFrom, tileTo);
+		counts[i] = (int)expected + (random.NextFloat() < expected - (int)expected ? 1 : 0);
+	}
+
+	return counts;
+}
+
+float EnvironmentGenerator::GetFreeArea(int index, glm::vec2 from, glm::vec2 to)
+{
+	//How many samples along each side we check when guessing how much of it is free
+	const int SAMPLES = 16;
+
+	if (from.x >= to.x || from.y >= to.y)
+		return 0.0f;
+
+	int free = 0;
+	for (int y = 0; y < SAMPLES; y++)
+	{
+		for (int x = 0; x < SAMPLES; x++)
+		{
+			glm::vec2 sample = from + (to - from) * (glm::vec2((float)x, (float)y) + 0.5f) / (float)SAMPLES;
+			bool avoided = false;
+			for (int a = 0; a < _avoidFromAll[index].size() && a < _avoidToAll[index].size() && !avoided; a++)
+			{
+				avoided = Util::CheckNumBetween(sample, _avoidFromAll[index][a], _avoidToAll[index][a]);
+			}
+			free += avoided ? 0 : 1;
+		}
+	}
+
+	return (to.x - from.x) * (to.y - from.y) * (float)free / (SAMPLES * SAMPLES);
+}
+
+std::vector<std::vector<EnvironmentGenerator::Placement>> EnvironmentGenerator::PlaceChunk(glm::ivec2 chunk, const std::vector<int>& counts,
+	uint64_t seed, bool useSpawnArea)
+{
+	glm::vec2 chunkFrom = glm::vec2(chunk) * CHUNK_SIZE;
+	glm::vec2 chunkTo = chunkFrom + CHUNK_SIZE;
+
+	//Each chunk gets its own streams off the seed, so it doesn't matter what order or thread they run on
+	uint64_t stream = GetTileKey(chunk);
+	PoissonPlacer placer(chunkFrom, chunkTo, Random::DeriveSeed(seed, stream * 2));
+	Random random(Random::DeriveSeed(seed, stream * 2 + 1));
+
+	std::vector<std::vector<Placement>> placements(_objectsToSpawn.size());
+	for (int i = 0; i < _objectsToSpawn.size(); i++)
+	{
+		if (counts[i] <= 0)
+			continue;
+
+		//Staying half our spacing in from the chunk's edges keeps us clear of whatever the next chunk over places
+		float inset = _spacingAll[i] * 0.5f;
+		glm::vec2 from = chunkFrom + inset;
+		glm::vec2 to = chunkTo - inset;
+		//Streamed tiles go on forever, otherwise we stay in the spawn area
+		if (useSpawnArea)
+		{
+			from = glm::max(glm::min(_spawnFromAll[i], _spawnToAll[i]), from);
+			to = glm::min(glm::max(_spawnFromAll[i], _spawnToAll[i]), to);
+		}
+
+		//Might be fewer than asked for if the area is full
+		std::vector<glm::vec2> points = placer.Place(counts[i], _spacingAll[i], from, to, _avoidFromAll[i], _avoidToAll[i]);
+		placements[i].reserve(points.size());
+		for (const glm::vec2& point : points)
+		{
+			Placement placement;
+			placement.Position = glm::vec3(point, 0.0f);
+			placement.Rotation = GetRandomRotation(random);
+			placements[i].push_back(placement);
+		}
+	}
+
+	return placements;
+}
+
+void EnvironmentGenerator::CommitPlacements(const std::vector<std::vector<Placement>>& placements, std::vector<std::vector<entt::entity>>& objects,
+	std::vector<InstanceBatch::sptr>& batches)
+{
+	for (int i = 0; i < placements.size(); i++)
+	{
+		const std::vector<Placement>& placed = placements[i];
+
+		//Instancing gets one batch per object, with all the transforms in one buffer
+		if (_useInstancing)
+		{
+			//Building the matrices is the slow bit, so spread it out
+			std::vector<glm::mat4> transforms(placed.size());
+			JobSystem::ParallelFor(placed.size(), 1024, [&](size_t begin, size_t end) {
+				for (size_t j = begin; j < end; j++)
+				{
+					//Same as the transform component would
+					glm::mat4 transform = glm::translate(glm::mat4(1.0f), placed[j].Position);
+					transform *= glm::mat4_cast(glm::quat(glm::radians(placed[j].Rotation)));
+					transforms[j] = transform;
+				}
+			});
+
+			InstanceBatch::sptr batch = InstanceBatch::Create(_vaosToSpawn[i], _materialsForSpawning[i]);
+			batch->SetInstances(transforms);
+			batch->SetLODChain(_lodChains[i]);
+			batches.push_back(batch);
+			continue;
+		}
+
+		//Entities have to be made on this thread, everything they need is worked out already
+		objects.emplace_back();
+		CreateObjects(i, placed, objects.back());
+	}
+}
+
+void EnvironmentGenerator::CreateObjects(int index, const std::vector<Placement>& placed, std::vector<entt::entity>& entities)
+{
+	entt::registry& registry = Application::Instance().ActiveScene->Registry();
+
+	//Make all the entities at once, then give each component to the whole group (each pool grows once, not per entity)
+	//*No GameObjectTag, a unique name per object was a string built and allocated for every single one,
+	// which group an entity is in already says what it is
+	entities.resize(placed.size());
+	registry.create(entities.begin(), entities.end());
+
+	RendererComponent renderer;
+	renderer.SetMesh(_vaosToSpawn[index]).SetMaterial(_materialsForSpawning[index]);
+	registry.insert<RendererComponent>(entities.begin(), entities.end(), renderer);
+	registry.insert<Transform>(entities.begin(), entities.end());
+	if (_lodChains[index] != nullptr)
+	{
+		LODGroup group;
+		group.Chain = _lodChains[index];
+		registry.insert<LODGroup>(entities.begin(), entities.end(), group);
+	}
+
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		Transform& transform = registry.get<Transform>(entities[i]);
+		transform.SetLocalPosition(placed[i].Position);
+		transform.SetLocalRotation(placed[i].Rotation);
+	}
+
+	//Scenery never moves, so it only needs its world matrix once
+	TransformSystem::MarkStatic(registry, entities);
+}
+
+void EnvironmentGenerator::DestroyObjects(std::vector<entt::entity>& entities)
+{
+	Application::Instance().ActiveScene->Registry().destroy(entities.begin(), entities.end());
+	entities.clear();
+}
+
+void EnvironmentGenerator::UnloadTile(Tile& tile)
+{
+	for (std::vector<entt::entity>& objects : tile.Objects)
+	{
+		DestroyObjects(objects);
+	}
+	tile.Objects.clear();
+
+	//Take its batches out of the ones we draw
+	for (const InstanceBatch::sptr& batch : tile.Batches)
+	{
+		_instanceBatches.erase(std::remove(_instanceBatches.begin(), _instanceBatches.end(), batch), _instanceBatches.end());
+	}
+	tile.Batches.clear();
+}
+
+void EnvironmentGenerator::FinishPendingTiles()
+{
+	for (auto& pending : _pendingTiles)
+	{
+		//Help out so we're not just sat waiting on the workers
+		while (pending.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (!JobSystem::RunPendingJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+	_pendingTiles.clear();
+}
+
+LODChain::sptr EnvironmentGenerator::LoadLODChain(int index)
+{
+	const std::vector<float>& sizes = _lodSizesAll[index];
+	if (sizes.empty() || _vaosToSpawn[index] == nullptr)
+		return nullptr;
+
+	//Level 0 is the object's own mesh, the rest are the files given or simplified from it
+	std::vector<VertexArrayObject::sptr> meshes;
+	meshes.push_back(_vaosToSpawn[index]);
+	for (int level = 1; level < (int)sizes.size(); level++)
+	{
+		const std::vector<std::string>& files = _lodFilesAll[index];
+		VertexArrayObject::sptr mesh = level - 1 < (int)files.size() ?
+			AssetCache::GetMesh(files[level - 1]) : AssetCache::GetMeshLOD(_objectsToSpawn[index], level);
+		//Stop at a level that won't load, the one before it gets used down to the cutoff
+		if (mesh == nullptr)
+			break;
+		meshes.push_back(mesh);
+	}
+
+	std::vector<float> screenSizes(sizes.begin(), sizes.begin() + meshes.size());
+	screenSizes.back() = sizes.back();
+	return LODChain::Create(meshes, screenSizes);
+}
+
+uint64_t EnvironmentGenerator::GetTileKey(glm::ivec2 tile)
+{
+	return ((uint64_t)(uint32_t)tile.x << 32) | (uint32_t)tile.y;
+}
+
+glm::ivec2 EnvironmentGenerator::GetTileCoord(uint64_t key)
+{
+	return glm::ivec2((int32_t)(uint32_t)(key >> 32), (int32_t)(uint32_t)key);
+}
+
+glm::vec2 EnvironmentGenerator::GetTileCentre(glm::ivec2 tile)
+{
+	return (glm::vec2(tile) + 0.5f) * CHUNK_SIZE;
+}
+
+glm::vec3 EnvironmentGenerator::GetRandomRotation(Random& random)
+{
+	//Stood up, spun randomly around the up axis
+	return glm::vec3(90.0f, 0.0f, random.Range(0.0f, 360.0f));
+}
+
+int EnvironmentGenerator::GetNumToSpawn(int index)
+{
+	return (int)(_numToSpawn[index] * _densityMultiplier);
+}
\ No newline at end of file
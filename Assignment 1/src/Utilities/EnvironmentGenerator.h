@@ -5,8 +5,16 @@
 #include <RendererComponent.h>
 #include <Transform.h>
 #include <vector>
+#include <unordered_map>
+#include <future>
 
 #include "Utilities/Util.h"
+#include "Utilities/TransformSystem.h"
+#include "Utilities/PoissonPlacer.h"
+#include "Utilities/JobSystem.h"
+#include "Graphics/InstanceBatch.h"
+#include "Graphics/LODChain.h"
+#include "Utilities/AssetCache.h"
 
 class EnvironmentGenerator abstract
 {
@@ -22,16 +30,120 @@ public:
 	static void CleanUpPointers();
 
 	//Adds object to generation
+	//*spacing is the closest it can be placed to anything else that's generated
 	static void AddObjectToGeneration(std::string fileName, ShaderMaterial::sptr objMat, int numToSpawn, 
 										glm::vec2 spawnFrom, glm::vec2 spawnTo, std::vector<glm::vec2> avoidFrom, 
-											std::vector<glm::vec2> avoidTo);
+											std::vector<glm::vec2> avoidTo, float spacing = 1.0f);
+	//Gives an object levels of detail, each used down to a screen size (how much of the screen's height it covers)
+	//*screenSizes[0] is for the object's own mesh, the rest are for lodFiles in order, or meshes simplified from it when there aren't enough files
+	//*Anything smaller on screen than the last size isn't drawn (make it 0 to always draw)
+	//*Takes effect on the next generation
+	static void SetObjectLODs(std::string fileName, std::vector<float> screenSizes, std::vector<std::string> lodFiles = std::vector<std::string>());
 	//Removes object from generation
 	static void RemoveObjectFromGeneration(std::string fileName);
 
 	static std::vector<std::string> GetObjectsOnList();
+
+	//Sets whether generated objects are drawn as instance batches instead of entities
+	//*Takes effect on the next generation
+	static void SetInstancing(bool instancing);
+	static bool GetInstancing();
+	//Multiplies the number of every object spawned
+	//*Takes effect on the next generation
+	static void SetDensityMultiplier(float multiplier);
+	static float GetDensityMultiplier();
+
+	//Sets the seed generation uses, the same seed and objects always generate the same environment
+	//*Takes effect on the next generation
+	static void SetSeed(uint64_t seed);
+	static uint64_t GetSeed();
+
+	//Sets whether the environment streams in around the camera instead of filling the spawn areas once
+	//*Each object keeps the density it'd have in its spawn area, just spread across an endless world
+	//*Takes effect on the next generation
+	static void SetStreaming(bool streaming);
+	static bool GetStreaming();
+	//How far around the camera tiles get loaded
+	static void SetStreamRadius(float radius);
+	static float GetStreamRadius();
+	//Loads tiles coming into range and unloads the ones that left it (call once a frame when streaming)
+	//*Tiles generate on the job system and get committed a few a frame once they're ready
+	static void UpdateStreaming(glm::vec3 centre);
+	static int GetLoadedTileCount();
+	static int GetPendingTileCount();
+
+	//The instance batches spawned when instancing is on (one per object type, per tile when streaming)
+	static const std::vector<InstanceBatch::sptr>& GetInstanceBatches();
 private:
-	//The gameobjects spawned here
-	static std::vector<std::vector<GameObject>> _objectsSpawned;
+	//One object placed by generation
+	struct Placement
+	{
+		glm::vec3 Position;
+		glm::vec3 Rotation;
+	};
+
+	//What a streamed tile spawned
+	struct Tile
+	{
+		std::vector<std::vector<entt::entity>> Objects;
+		std::vector<InstanceBatch::sptr> Batches;
+	};
+
+	//Splits each object's number to spawn across the chunks, by how much of each chunk it can spawn in
+	static std::vector<std::vector<int>> GetChunkCounts(const std::vector<glm::ivec2>& chunks);
+	//How many of each object go in a streamed tile
+	static std::vector<int> GetTileCounts(glm::ivec2 tile);
+	//Roughly how much of an area the object at index can spawn in (what's not in its avoid areas)
+	static float GetFreeArea(int index, glm::vec2 from, glm::vec2 to);
+	//Places counts[i] of each object in a chunk (safe to run on any thread)
+	//*useSpawnArea keeps everything inside each object's spawn area, streamed tiles don't
+	static std::vector<std::vector<Placement>> PlaceChunk(glm::ivec2 chunk, const std::vector<int>& counts, uint64_t seed, bool useSpawnArea);
+	//Makes the entities or instance batches for everything placed (has to run on the main thread)
+	static void CommitPlacements(const std::vector<std::vector<Placement>>& placements, std::vector<std::vector<entt::entity>>& objects,
+		std::vector<InstanceBatch::sptr>& batches);
+	//Makes an entity for everything placed of the object at index, in bulk
+	static void CreateObjects(int index, const std::vector<Placement>& placed, std::vector<entt::entity>& entities);
+	//Destroys a group of spawned entities in one pass, and empties the list
+	static void DestroyObjects(std::vector<entt::entity>& entities);
+	//Removes everything a tile spawned
+	static void UnloadTile(Tile& tile);
+	//Waits for the tiles still generating and throws them away
+	static void FinishPendingTiles();
+	//Packs tile coordinates into a key (also what each tile's seed comes from)
+	static uint64_t GetTileKey(glm::ivec2 tile);
+	static glm::ivec2 GetTileCoord(uint64_t key);
+	static glm::vec2 GetTileCentre(glm::ivec2 tile);
+	//Loads the LOD chain for the object at index (nullptr if it doesn't have one)
+	static LODChain::sptr LoadLODChain(int index);
+	//Rolls a random rotation
+	static glm::vec3 GetRandomRotation(Random& random);
+	//Gets the number of objects to spawn for the object at index
+	static int GetNumToSpawn(int index);
+
+	//Generation gets split into square chunks this wide, each placed on its own job (streamed tiles are the same size)
+	static constexpr float CHUNK_SIZE = 8.0f;
+	//Most tiles generating at once, and most put in the scene each frame
+	static const int MAX_PENDING_TILES = 16;
+	static const int MAX_TILE_COMMITS = 2;
+
+	//Whether we spawn instance batches or entities
+	static bool _useInstancing;
+	//Scales the number of objects spawned
+	static float _densityMultiplier;
+	//Where the generation's random numbers come from
+	static uint64_t _seed;
+	//The instance batches spawned
+	static std::vector<InstanceBatch::sptr> _instanceBatches;
+
+	//Whether we stream tiles around the camera, and how far
+	static bool _streaming;
+	static float _streamRadius;
+	//The tiles in the scene, and the ones still generating
+	static std::unordered_map<uint64_t, Tile> _tiles;
+	static std::unordered_map<uint64_t, std::future<std::vector<std::vector<Placement>>>> _pendingTiles;
+
+	//The entities spawned here, one group per object
+	static std::vector<std::vector<entt::entity>> _objectsSpawned;
 
 	//The vaos to spawn in
 	static std::vector<VertexArrayObject::sptr> _vaosToSpawn;
@@ -42,6 +154,11 @@ private:
 	static std::vector<glm::vec2> _spawnToAll;
 	static std::vector<std::vector<glm::vec2>> _avoidFromAll;
 	static std::vector<std::vector<glm::vec2>> _avoidToAll;
+	static std::vector<float> _spacingAll;
+	//Each object's LOD screen sizes and files, and the chain loaded from them
+	static std::vector<std::vector<float>> _lodSizesAll;
+	static std::vector<std::vector<std::string>> _lodFilesAll;
+	static std::vector<LODChain::sptr> _lodChains;
 
 	//Allows us to go through and remove from list
 	static std::vector<std::string> _objectsToSpawn;
@@ -0,0 +1,177 @@
+#include "JobSystem.h"
+#include <atomic>
+#include <algorithm>
+
+std::vector<std::thread> JobSystem::_workers;
+std::deque<std::function<void()>> JobSystem::_jobs;
+std::deque<JobSystem::Batch> JobSystem::_batches;
+std::mutex JobSystem::_mutex;
+std::condition_variable JobSystem::_condition;
+bool JobSystem::_running = false;
+
+void JobSystem::Init(unsigned numThreads)
+{
+	//Makes sure we don't double up on workers
+	Shutdown();
+
+	if (numThreads == 0)
+	{
+		//Leave one for the main thread
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	_running = true;
+	for (unsigned i = 0; i < numThreads; i++)
+	{
+		_workers.emplace_back(WorkerLoop);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running = false;
+	}
+	_condition.notify_all();
+
+	//Workers finish what's queued before leaving
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+	_workers.clear();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t minBatch, const std::function<void(size_t, size_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	//Aim for a few batches per thread so uneven batches even out
+	size_t threads = _workers.size() + 1;
+	size_t batchSize = std::max(std::max(minBatch, (size_t)1), (count + threads * 4 - 1) / (threads * 4));
+	size_t numBatches = (count + batchSize - 1) / batchSize;
+
+	//Not worth spreading out
+	if (numBatches == 1 || _workers.empty())
+	{
+		func(0, count);
+		return;
+	}
+
+	//The counter lives until every batch is done, so its address tags this call's batches
+	std::atomic<size_t> remaining(numBatches - 1);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (size_t batch = 1; batch < numBatches; batch++)
+		{
+			size_t begin = batch * batchSize;
+			size_t end = std::min(begin + batchSize, count);
+			_batches.push_back({ &remaining, [&func, &remaining, begin, end]() {
+				func(begin, end);
+				remaining--;
+			} });
+		}
+	}
+	_condition.notify_all();
+
+	//The first batch runs here
+	func(0, std::min(batchSize, count));
+
+	//Help out with our own batches until every one is done (the rest are already running on workers)
+	while (remaining > 0)
+	{
+		if (!RunOwnBatch(&remaining))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::RunOwnBatch(const void* owner)
+{
+	std::function<void()> run;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = std::find_if(_batches.begin(), _batches.end(), [owner](const Batch& batch) { return batch.Owner == owner; });
+		if (it == _batches.end())
+			return false;
+
+		run = std::move(it->Run);
+		_batches.erase(it);
+	}
+
+	run();
+	return true;
+}
+
+bool JobSystem::RunPendingJob()
+{
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_jobs.empty())
+			return false;
+
+		job = std::move(_jobs.front());
+		_jobs.pop_front();
+	}
+
+	job();
+	return true;
+}
+
+unsigned JobSystem::GetWorkerCount()
+{
+	return (unsigned)_workers.size();
+}
+
+void JobSystem::Enqueue(std::function<void()> job)
+{
+	//No workers, so we do it ourselves
+	if (_workers.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_condition.notify_one();
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			//Sleep until there's work or we're shutting down
+			_condition.wait(lock, []() { return !_batches.empty() || !_jobs.empty() || !_running; });
+
+			//Someone is waiting on ParallelFor batches, so they go first
+			if (!_batches.empty())
+			{
+				job = std::move(_batches.front().Run);
+				_batches.pop_front();
+			}
+			//Only leave once the queues are drained
+			else if (_jobs.empty())
+			{
+				return;
+			}
+			else
+			{
+				job = std::move(_jobs.front());
+				_jobs.pop_front();
+			}
+		}
+
+		job();
+	}
+}
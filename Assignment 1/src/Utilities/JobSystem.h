@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+//A pool of worker threads to spread work across
+class JobSystem abstract
+{
+public:
+	//Starts up the workers
+	//*0 threads uses one less than the number of hardware threads (the main thread works too)
+	static void Init(unsigned numThreads = 0);
+	//Finishes the queued jobs and joins the workers
+	static void Shutdown();
+
+	//Queues a job to run on a worker, the future holds the result
+	//*Runs right away on this thread if there aren't any workers
+	template <typename Func>
+	static auto Submit(Func&& func) -> std::future<decltype(func())>
+	{
+		typedef decltype(func()) Result;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+		std::future<Result> result = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	//Splits [0, count) into batches of at least minBatch and runs func(begin, end) on each
+	//*Blocks until every batch is done, the calling thread only helps with this call's own batches while it waits
+	//*Batches go in their own queue, which workers take from before the background jobs
+	static void ParallelFor(size_t count, size_t minBatch, const std::function<void(size_t, size_t)>& func);
+
+	//Runs one queued background job (from Submit) on this thread if there is one
+	//*Returns false if the queue was empty
+	static bool RunPendingJob();
+
+	//How many worker threads there are
+	static unsigned GetWorkerCount();
+private:
+	//A slice of a ParallelFor, tagged with the call it belongs to
+	struct Batch
+	{
+		const void* Owner;
+		std::function<void()> Run;
+	};
+
+	//Adds a job to the queue (or runs it if there are no workers)
+	static void Enqueue(std::function<void()> job);
+	//Runs one of a ParallelFor call's queued batches on this thread
+	//*Returns false if none of them are left in the queue
+	static bool RunOwnBatch(const void* owner);
+	//What every worker runs
+	static void WorkerLoop();
+
+	static std::vector<std::thread> _workers;
+	//Background jobs from Submit
+	static std::deque<std::function<void()>> _jobs;
+	//ParallelFor batches, kept apart so a caller waiting on its batches never picks up a long background job
+	static std::deque<Batch> _batches;
+	static std::mutex _mutex;
+	static std::condition_variable _condition;
+	static bool _running;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+//A read only view of a whole file, mapped straight into memory
+//*Lets binary caches get handed to OpenGL without reading them into a buffer first
+class MappedFile
+{
+public:
+	MappedFile();
+	//Maps the file at path (check IsOpen to see if it worked)
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	//Only one owner per mapping
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	//Maps the file at path, closing whatever was mapped before
+	//*Returns false if the file is missing or empty
+	bool Open(const std::string& path);
+	//Unmaps the file
+	void Close();
+
+	bool IsOpen() const;
+	//The start of the file's contents
+	const uint8_t* GetData() const;
+	//How many bytes are mapped
+	size_t GetSize() const;
+private:
+	const uint8_t* _data = nullptr;
+	size_t _size = 0;
+
+#ifdef _WIN32
+	//Windows handles for the file and its mapping
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#else
+	//POSIX file descriptor
+	int _file = -1;
+#endif
+};
@@ -0,0 +1,222 @@
+#include "PoissonPlacer.h"
+#include <cmath>
+#include <algorithm>
+#include "Utilities/Util.h"
+
+PoissonPlacer::PoissonPlacer(glm::vec2 from, glm::vec2 to, uint64_t seed) :
+	_random(seed)
+{
+	_from = glm::min(from, to);
+	_to = glm::max(from, to);
+}
+
+std::vector<glm::vec2> PoissonPlacer::Place(int count, float spacing, glm::vec2 from, glm::vec2 to,
+	const std::vector<glm::vec2>& avoidFrom, const std::vector<glm::vec2>& avoidTo, int attempts)
+{
+	std::vector<glm::vec2> result;
+	if (count <= 0)
+		return result;
+
+	spacing = std::max(spacing, MIN_SPACING);
+	attempts = std::max(attempts, 1);
+
+	//Nothing can go outside the placer's area
+	glm::vec2 areaFrom = glm::max(glm::min(from, to), _from);
+	glm::vec2 areaTo = glm::min(glm::max(from, to), _to);
+	if (areaFrom.x >= areaTo.x || areaFrom.y >= areaTo.y)
+		return result;
+
+	//Roughly how many points fit if we packed the area as tight as Bridson does
+	glm::vec2 size = areaTo - areaFrom;
+	float capacity = 0.65f * size.x * size.y / (spacing * spacing);
+
+	//Sparse enough that random spots almost never collide, so just throw darts
+	//*Bridson fills the whole area, which is a lot of wasted work for a handful of objects
+	if ((float)count * 4.0f < capacity)
+	{
+		Layer& layer = GetLayer(spacing);
+		int tries = count * attempts;
+		for (int i = 0; i < tries && (int)result.size() < count; i++)
+		{
+			glm::vec2 point = _random.Range(areaFrom, areaTo);
+			if (IsValid(point, spacing, areaFrom, areaTo, avoidFrom, avoidTo, nullptr))
+			{
+				Insert(layer, point);
+				result.push_back(point);
+			}
+		}
+		return result;
+	}
+
+	//Dense, so fill the area with Bridson's algorithm, then keep a random count of what it made
+	//*Taking the first count instead would bunch everything up around the first seed
+	Layer filled = CreateLayer(spacing);
+	std::vector<int> active;
+	const float pi = 3.14159265f;
+	while (true)
+	{
+		//Seed (or reseed, to get to pockets the last seed couldn't reach)
+		bool seeded = false;
+		for (int i = 0; i < attempts && !seeded; i++)
+		{
+			glm::vec2 point = _random.Range(areaFrom, areaTo);
+			if (IsValid(point, spacing, areaFrom, areaTo, avoidFrom, avoidTo, &filled))
+			{
+				active.push_back((int)filled.Points.size());
+				Insert(filled, point);
+				seeded = true;
+			}
+		}
+		if (!seeded)
+			break;
+
+		while (!active.empty())
+		{
+			int index = _random.Range(0, (int)active.size());
+			glm::vec2 centre = filled.Points[active[index]];
+
+			//Try spots in the ring between spacing and twice spacing around it
+			bool found = false;
+			for (int i = 0; i < attempts; i++)
+			{
+				float angle = _random.Range(0.0f, 2.0f * pi);
+				float distance = _random.Range(spacing, 2.0f * spacing);
+				glm::vec2 point = centre + glm::vec2(std::cos(angle), std::sin(angle)) * distance;
+				if (IsValid(point, spacing, areaFrom, areaTo, avoidFrom, avoidTo, &filled))
+				{
+					active.push_back((int)filled.Points.size());
+					Insert(filled, point);
+					found = true;
+					break;
+				}
+			}
+
+			//Surrounded, so it's done
+			if (!found)
+			{
+				active[index] = active.back();
+				active.pop_back();
+			}
+		}
+	}
+
+	//Shuffle and keep count of them
+	std::vector<glm::vec2>& points = filled.Points;
+	int kept = std::min(count, (int)points.size());
+	for (int i = 0; i < kept; i++)
+	{
+		int swapWith = _random.Range(i, (int)points.size());
+		std::swap(points[i], points[swapWith]);
+	}
+	result.assign(points.begin(), points.begin() + kept);
+
+	Layer& layer = GetLayer(spacing);
+	for (const glm::vec2& point : result)
+	{
+		Insert(layer, point);
+	}
+	return result;
+}
+
+void PoissonPlacer::Clear()
+{
+	_layers.clear();
+}
+
+int PoissonPlacer::GetPointCount() const
+{
+	int count = 0;
+	for (const Layer& layer : _layers)
+	{
+		count += (int)layer.Points.size();
+	}
+	return count;
+}
+
+PoissonPlacer::Layer PoissonPlacer::CreateLayer(float spacing) const
+{
+	Layer layer;
+	layer.Spacing = spacing;
+	//Bridson's cell size, a cell can only ever hold one point from this layer
+	layer.CellSize = spacing / std::sqrt(2.0f);
+	layer.Width = std::max((int)std::ceil((_to.x - _from.x) / layer.CellSize), 1);
+	layer.Height = std::max((int)std::ceil((_to.y - _from.y) / layer.CellSize), 1);
+	layer.Heads.assign((size_t)layer.Width * layer.Height, -1);
+	return layer;
+}
+
+PoissonPlacer::Layer& PoissonPlacer::GetLayer(float spacing)
+{
+	for (Layer& layer : _layers)
+	{
+		if (layer.Spacing == spacing)
+			return layer;
+	}
+
+	_layers.push_back(CreateLayer(spacing));
+	return _layers.back();
+}
+
+void PoissonPlacer::Insert(Layer& layer, glm::vec2 point) const
+{
+	int x = glm::clamp((int)((point.x - _from.x) / layer.CellSize), 0, layer.Width - 1);
+	int y = glm::clamp((int)((point.y - _from.y) / layer.CellSize), 0, layer.Height - 1);
+	int cell = y * layer.Width + x;
+
+	layer.Next.push_back(layer.Heads[cell]);
+	layer.Heads[cell] = (int)layer.Points.size();
+	layer.Points.push_back(point);
+}
+
+bool PoissonPlacer::IsFree(const Layer& layer, glm::vec2 point, float spacing) const
+{
+	if (layer.Points.empty())
+		return true;
+
+	//Spacing is how wide a berth something needs, so two different things meet halfway
+	float radius = (spacing + layer.Spacing) * 0.5f;
+	int minX = std::max((int)((point.x - radius - _from.x) / layer.CellSize), 0);
+	int maxX = std::min((int)((point.x + radius - _from.x) / layer.CellSize), layer.Width - 1);
+	int minY = std::max((int)((point.y - radius - _from.y) / layer.CellSize), 0);
+	int maxY = std::min((int)((point.y + radius - _from.y) / layer.CellSize), layer.Height - 1);
+
+	float radiusSquared = radius * radius;
+	for (int y = minY; y <= maxY; y++)
+	{
+		for (int x = minX; x <= maxX; x++)
+		{
+			for (int i = layer.Heads[y * layer.Width + x]; i != -1; i = layer.Next[i])
+			{
+				glm::vec2 offset = layer.Points[i] - point;
+				if (offset.x * offset.x + offset.y * offset.y < radiusSquared)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PoissonPlacer::IsValid(glm::vec2 point, float spacing, glm::vec2 from, glm::vec2 to, const std::vector<glm::vec2>& avoidFrom,
+	const std::vector<glm::vec2>& avoidTo, const Layer* extra) const
+{
+	if (!Util::CheckNumBetween(point, from, to))
+		return false;
+
+	for (size_t i = 0; i < avoidFrom.size() && i < avoidTo.size(); i++)
+	{
+		if (Util::CheckNumBetween(point, avoidFrom[i], avoidTo[i]))
+			return false;
+	}
+
+	if (extra != nullptr && !IsFree(*extra, point, spacing))
+		return false;
+
+	for (const Layer& layer : _layers)
+	{
+		if (!IsFree(layer, point, spacing))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+#include "Utilities/Random.h"
+
+//Places objects so that nothing lands closer to anything else than its spacing (Poisson disk sampling)
+//*Every object type placed through the same placer avoids the others too, kept apart by the average of their two spacings
+//*Points get bucketed in a uniform grid per spacing, so checking a spot only looks at the cells around it
+//*Placing always finishes in a bounded number of tries, if the area is too full it just places fewer than asked
+//*The same seed and the same calls always place the same points
+class PoissonPlacer
+{
+public:
+	//from/to is the area anything can be placed in
+	PoissonPlacer(glm::vec2 from, glm::vec2 to, uint64_t seed = 0);
+
+	//Places up to count points at least spacing apart, inside from/to and outside every avoid area
+	//*attempts is how many spots get tried around each point before it's considered surrounded (Bridson's k)
+	std::vector<glm::vec2> Place(int count, float spacing, glm::vec2 from, glm::vec2 to,
+		const std::vector<glm::vec2>& avoidFrom = std::vector<glm::vec2>(), const std::vector<glm::vec2>& avoidTo = std::vector<glm::vec2>(),
+		int attempts = DEFAULT_ATTEMPTS);
+
+	//Forgets everything placed so far
+	void Clear();
+
+	//How many points have been placed
+	int GetPointCount() const;
+
+	static const int DEFAULT_ATTEMPTS = 30;
+	//Anything tighter than this gets bumped up to it, so the grid stays a sane size
+	static constexpr float MIN_SPACING = 0.05f;
+private:
+	//A grid of points that all share one spacing
+	struct Layer
+	{
+		float Spacing;
+		float CellSize;
+		int Width;
+		int Height;
+		//The first point in each cell (-1 if it's empty), the rest are linked through Next
+		std::vector<int> Heads;
+		std::vector<int> Next;
+		std::vector<glm::vec2> Points;
+	};
+
+	//Sets up an empty layer over the placer's area
+	Layer CreateLayer(float spacing) const;
+	//Finds the layer for a spacing, making it if there isn't one
+	Layer& GetLayer(float spacing);
+	//Adds a point to a layer's grid
+	void Insert(Layer& layer, glm::vec2 point) const;
+	//Is there nothing in the layer too close to the point
+	bool IsFree(const Layer& layer, glm::vec2 point, float spacing) const;
+	//Is the point in the area, out of the avoid areas and clear of every layer (and the extra one if it's given)
+	bool IsValid(glm::vec2 point, float spacing, glm::vec2 from, glm::vec2 to, const std::vector<glm::vec2>& avoidFrom,
+		const std::vector<glm::vec2>& avoidTo, const Layer* extra) const;
+
+	glm::vec2 _from;
+	glm::vec2 _to;
+	//One layer per spacing placed with
+	std::vector<Layer> _layers;
+	Random _random;
+};
@@ -0,0 +1,474 @@
+#include "Profiler.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <Logging.h>
+#include "imgui.h"
+
+bool Profiler::_enabled = true;
+bool Profiler::_active = false;
+bool Profiler::_paused = false;
+Profiler::Clock::time_point Profiler::_epoch = Profiler::Clock::now();
+uint64_t Profiler::_frame = 0;
+double Profiler::_frameStart = 0.0;
+
+std::vector<Profiler::Event> Profiler::_events;
+std::vector<size_t> Profiler::_open;
+std::vector<Profiler::Event> Profiler::_lastEvents;
+std::vector<Profiler::Event> Profiler::_lastGPUEvents;
+double Profiler::_lastFrameTime = 0.0;
+
+GLuint Profiler::_queries[GPU_FRAMES][MAX_GPU_PASSES] = {};
+std::vector<Profiler::GPUPass> Profiler::_gpuPasses[GPU_FRAMES];
+int Profiler::_gpuSlot = 0;
+bool Profiler::_gpuOpen = false;
+int Profiler::_gpuCaptureIndex[GPU_FRAMES] = { -1, -1, -1, -1 };
+uint64_t Profiler::_gpuFrame[GPU_FRAMES] = {};
+std::vector<Profiler::Event> Profiler::_resolvedGPUEvents;
+uint64_t Profiler::_resolvedGPUFrame = 0;
+bool Profiler::_resolvedGPUNew = false;
+
+std::vector<Profiler::ScopeStats> Profiler::_stats;
+
+std::vector<Profiler::CapturedFrame> Profiler::_captured;
+int Profiler::_captureRemaining = 0;
+int Profiler::_captureFlush = 0;
+std::string Profiler::_capturePath;
+
+void Profiler::Init()
+{
+	//Makes sure we don't double up
+	Unload();
+
+	glGenQueries(GPU_FRAMES * MAX_GPU_PASSES, &_queries[0][0]);
+	for (int slot = 0; slot < GPU_FRAMES; slot++)
+	{
+		_gpuPasses[slot].clear();
+		_gpuCaptureIndex[slot] = -1;
+	}
+	_gpuSlot = 0;
+	_epoch = Clock::now();
+}
+
+void Profiler::Unload()
+{
+	if (_queries[0][0] != 0)
+	{
+		glDeleteQueries(GPU_FRAMES * MAX_GPU_PASSES, &_queries[0][0]);
+		memset(_queries, 0, sizeof(_queries));
+	}
+	for (int slot = 0; slot < GPU_FRAMES; slot++)
+	{
+		_gpuPasses[slot].clear();
+	}
+
+	_stats.clear();
+	_events.clear();
+	_open.clear();
+	_lastEvents.clear();
+	_lastGPUEvents.clear();
+	_resolvedGPUEvents.clear();
+	_resolvedGPUNew = false;
+	_captured.clear();
+	_captureRemaining = 0;
+	_captureFlush = 0;
+	_active = false;
+	_gpuOpen = false;
+}
+
+void Profiler::BeginFrame()
+{
+	_active = _enabled && _queries[0][0] != 0;
+	if (!_active)
+		return;
+
+	_frameStart = Now();
+	_events.clear();
+	_open.clear();
+
+	//This slot's queries went in a few frames ago, so they should be done by now
+	ReadGPUFrame(_gpuSlot);
+	_gpuFrame[_gpuSlot] = _frame;
+
+	if (_captureRemaining > 0)
+	{
+		CapturedFrame frame;
+		frame.Start = _frameStart;
+		_captured.push_back(frame);
+		_gpuCaptureIndex[_gpuSlot] = (int)_captured.size() - 1;
+	}
+}
+
+void Profiler::EndFrame()
+{
+	if (!_active)
+		return;
+
+	//Anything left open gets closed at the end of the frame
+	while (!_open.empty())
+	{
+		EndScope();
+	}
+	EndGPU();
+
+	double frameTime = Now() - _frameStart;
+	if (!_paused)
+	{
+		for (const Event& event : _events)
+		{
+			Record(event.Name, event.Depth, false, (float)(event.End - event.Start));
+		}
+
+		//Scopes that didn't run this frame took 0
+		int index = (int)(_frame % HISTORY_SIZE);
+		for (ScopeStats& stats : _stats)
+		{
+			stats.History[index] = stats.LastFrame == _frame ? stats.Last : 0.0f;
+			float total = 0.0f;
+			stats.Max = 0.0f;
+			for (float ms : stats.History)
+			{
+				total += ms;
+				stats.Max = std::max(stats.Max, ms);
+			}
+			stats.Average = total / HISTORY_SIZE;
+		}
+
+		_lastEvents = _events;
+		_lastFrameTime = frameTime;
+	}
+
+	//Keep the frame if we're capturing, and write the capture once its last GPU passes come back
+	if (_captureRemaining > 0)
+	{
+		_captured.back().CPU = _events;
+		_captureRemaining--;
+		if (_captureRemaining == 0)
+		{
+			_captureFlush = GPU_FRAMES;
+		}
+	}
+	else if (_captureFlush > 0)
+	{
+		_captureFlush--;
+		if (_captureFlush == 0)
+		{
+			ExportChromeTrace(_capturePath);
+			_captured.clear();
+		}
+	}
+
+	_gpuSlot = (_gpuSlot + 1) % GPU_FRAMES;
+	_frame++;
+	_active = false;
+}
+
+void Profiler::BeginScope(const char* name)
+{
+	if (!_active)
+		return;
+
+	Event event;
+	event.Name = name;
+	event.Depth = (int)_open.size();
+	event.Start = Now() - _frameStart;
+	event.End = event.Start;
+	_open.push_back(_events.size());
+	_events.push_back(event);
+}
+
+void Profiler::EndScope()
+{
+	//Turning the profiler on mid frame can leave an end without a begin
+	if (_open.empty())
+		return;
+
+	_events[_open.back()].End = Now() - _frameStart;
+	_open.pop_back();
+}
+
+void Profiler::BeginGPU(const char* name)
+{
+	if (!_active || _gpuOpen || _gpuPasses[_gpuSlot].size() >= MAX_GPU_PASSES)
+		return;
+
+	GLuint query = _queries[_gpuSlot][_gpuPasses[_gpuSlot].size()];
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	_gpuPasses[_gpuSlot].push_back({ name, query });
+	_gpuOpen = true;
+}
+
+void Profiler::EndGPU()
+{
+	if (!_gpuOpen)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	_gpuOpen = false;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	_enabled = enabled;
+}
+
+bool Profiler::GetEnabled()
+{
+	return _enabled;
+}
+
+void Profiler::CaptureFrames(int frames, const std::string& path)
+{
+	//Already capturing
+	if (_captureRemaining > 0 || _captureFlush > 0)
+		return;
+
+	_captured.clear();
+	_captureRemaining = std::min(std::max(frames, 1), (int)MAX_CAPTURE_FRAMES);
+	_capturePath = path;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		LOG_WARN("Couldn't write profiler trace {}", path);
+		return false;
+	}
+
+	//Complete ("X") events in microseconds, CPU scopes on one track and GPU passes on another
+	//*Elapsed queries only give how long a pass took, so GPU passes are laid back to back from the start of their frame
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	char line[256];
+	for (const CapturedFrame& frame : _captured)
+	{
+		for (int track = 1; track <= 2; track++)
+		{
+			for (const Event& event : track == 1 ? frame.CPU : frame.GPU)
+			{
+				snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					event.Name, track == 1 ? "cpu" : "gpu", (frame.Start + event.Start) * 1000.0, (event.End - event.Start) * 1000.0, track);
+				file << line;
+			}
+		}
+	}
+	file << "\n]}\n";
+
+	LOG_INFO("Wrote {} profiled frames to {}", _captured.size(), path);
+	return true;
+}
+
+void Profiler::GetLastFrame(std::vector<ScopeTime>& times)
+{
+	times.clear();
+	for (const Event& event : _lastEvents)
+	{
+		times.push_back({ event.Name, event.Depth, false, (float)(event.End - event.Start) });
+	}
+	for (const Event& event : _lastGPUEvents)
+	{
+		times.push_back({ event.Name, 0, true, (float)(event.End - event.Start) });
+	}
+}
+
+bool Profiler::GetResolvedGPUFrame(std::vector<ScopeTime>& times, uint64_t& frame)
+{
+	times.clear();
+	if (!_resolvedGPUNew)
+		return false;
+
+	for (const Event& event : _resolvedGPUEvents)
+	{
+		times.push_back({ event.Name, 0, true, (float)(event.End - event.Start) });
+	}
+	frame = _resolvedGPUFrame;
+	_resolvedGPUNew = false;
+	return true;
+}
+
+uint64_t Profiler::GetFrameIndex()
+{
+	return _frame;
+}
+
+float Profiler::GetLastFrameTime()
+{
+	return (float)_lastFrameTime;
+}
+
+void Profiler::RenderImGui()
+{
+	if (!ImGui::Begin("Profiler"))
+	{
+		ImGui::End();
+		return;
+	}
+
+	bool enabled = _enabled;
+	if (ImGui::Checkbox("Enabled", &enabled))
+	{
+		SetEnabled(enabled);
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Paused", &_paused);
+	ImGui::SameLine();
+	if (_captureRemaining > 0 || _captureFlush > 0)
+	{
+		ImGui::Text("Capturing...");
+	}
+	else if (ImGui::Button("Capture 120 Frames"))
+	{
+		CaptureFrames(120, "profile.json");
+	}
+
+	//Timeline of the last frame, a row per nesting depth and a row for the GPU under them
+	double gpuTime = _lastGPUEvents.empty() ? 0.0 : _lastGPUEvents.back().End;
+	double span = std::max(std::max(_lastFrameTime, gpuTime), 0.001);
+	ImGui::Text("Last frame: %.2f ms CPU, %.2f ms GPU", _lastFrameTime, gpuTime);
+
+	int depth = 0;
+	for (const Event& event : _lastEvents)
+	{
+		depth = std::max(depth, event.Depth + 1);
+	}
+	const float rowHeight = 18.0f;
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+	float height = rowHeight * (depth + 1);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(30, 30, 30, 255));
+
+	//Colours come from the name, so a scope keeps its colour between frames
+	static const ImU32 colours[] = {
+		IM_COL32(86, 156, 214, 255), IM_COL32(78, 201, 176, 255), IM_COL32(220, 160, 90, 255), IM_COL32(197, 134, 192, 255),
+		IM_COL32(181, 206, 168, 255), IM_COL32(206, 145, 120, 255), IM_COL32(156, 220, 254, 255), IM_COL32(215, 186, 125, 255)
+	};
+	auto drawEvent = [&](const Event& event, int row, bool gpu) {
+		size_t hash = std::hash<std::string>()(event.Name);
+		ImVec2 min = ImVec2(origin.x + (float)(event.Start / span) * width, origin.y + row * rowHeight);
+		ImVec2 max = ImVec2(origin.x + (float)(event.End / span) * width, min.y + rowHeight - 1.0f);
+		max.x = std::max(max.x, min.x + 1.0f);
+		drawList->AddRectFilled(min, max, gpu ? IM_COL32(200, 90, 90, 255) : colours[hash % 8]);
+
+		//Names only go on the bars that fit them
+		drawList->PushClipRect(min, max, true);
+		drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), event.Name);
+		drawList->PopClipRect();
+
+		if (ImGui::IsMouseHoveringRect(min, max))
+		{
+			ImGui::SetTooltip("%s%s: %.3f ms", gpu ? "GPU " : "", event.Name, event.End - event.Start);
+		}
+	};
+	for (const Event& event : _lastEvents)
+	{
+		drawEvent(event, event.Depth, false);
+	}
+	for (const Event& event : _lastGPUEvents)
+	{
+		drawEvent(event, depth, true);
+	}
+	ImGui::Dummy(ImVec2(width, height));
+
+	//Every scope's history
+	if (ImGui::CollapsingHeader("Scopes"))
+	{
+		char overlay[64];
+		for (size_t i = 0; i < _stats.size(); i++)
+		{
+			const ScopeStats& stats = _stats[i];
+			ImGui::PushID((int)i);
+			snprintf(overlay, sizeof(overlay), "%.2f ms (avg %.2f, max %.2f)", stats.Last, stats.Average, stats.Max);
+			ImGui::Indent(stats.Depth * 10.0f + 1.0f);
+			ImGui::Text("%s%s", stats.GPU ? "GPU " : "", stats.Name);
+			ImGui::PlotLines("", stats.History, HISTORY_SIZE, (int)(_frame % HISTORY_SIZE), overlay, 0.0f, stats.Max * 1.2f + 0.01f, ImVec2(0.0f, 30.0f));
+			ImGui::Unindent(stats.Depth * 10.0f + 1.0f);
+			ImGui::PopID();
+		}
+	}
+
+	ImGui::End();
+}
+
+void Profiler::Record(const char* name, int depth, bool gpu, float ms)
+{
+	if (_paused)
+		return;
+
+	//Names are usually the same literal, so the pointer check catches almost everything
+	auto it = std::find_if(_stats.begin(), _stats.end(), [&](const ScopeStats& stats) {
+		return stats.GPU == gpu && (stats.Name == name || strcmp(stats.Name, name) == 0);
+	});
+	if (it == _stats.end())
+	{
+		ScopeStats stats;
+		stats.Name = name;
+		stats.Depth = depth;
+		stats.GPU = gpu;
+		stats.LastFrame = _frame + 1;
+		_stats.push_back(stats);
+		it = _stats.end() - 1;
+	}
+
+	//A scope that runs more than once a frame adds up
+	if (it->LastFrame != _frame)
+	{
+		it->LastFrame = _frame;
+		it->Last = 0.0f;
+	}
+	it->Last += ms;
+}
+
+void Profiler::ReadGPUFrame(int slot)
+{
+	std::vector<Event> events;
+	double cursor = 0.0;
+	bool whole = true;
+	for (const GPUPass& pass : _gpuPasses[slot])
+	{
+		//Still not done, drop it instead of stalling on it
+		GLuint available = 0;
+		glGetQueryObjectuiv(pass.Query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			whole = false;
+			continue;
+		}
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(pass.Query, GL_QUERY_RESULT, &nanoseconds);
+		double ms = nanoseconds / 1000000.0;
+		Record(pass.Name, 0, true, (float)ms);
+		events.push_back({ pass.Name, 0, cursor, cursor + ms });
+		cursor += ms;
+	}
+	_gpuPasses[slot].clear();
+
+	if (!events.empty() && !_paused)
+	{
+		_lastGPUEvents = events;
+	}
+	//A frame missing passes would read as faster than it was, so only whole ones get handed out
+	if (!events.empty() && whole)
+	{
+		_resolvedGPUEvents = events;
+		_resolvedGPUFrame = _gpuFrame[slot];
+		_resolvedGPUNew = true;
+	}
+	int capture = _gpuCaptureIndex[slot];
+	if (capture >= 0 && capture < (int)_captured.size())
+	{
+		_captured[capture].GPU = events;
+	}
+	_gpuCaptureIndex[slot] = -1;
+}
+
+double Profiler::Now()
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - _epoch).count();
+}
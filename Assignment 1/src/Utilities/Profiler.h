@@ -0,0 +1,176 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <glad/glad.h>
+
+//Times nested CPU scopes and GPU passes every frame
+//*CPU scopes can nest, GPU passes can't (GL_TIME_ELAPSED queries can't overlap), so time each pass on its own
+//*GPU queries go in a ring a few frames deep, and get read back once they're done so we never stall waiting on them
+//*Every scope keeps a history of its last HISTORY_SIZE frames, and a capture can be saved as Chrome trace JSON (chrome://tracing)
+class Profiler abstract
+{
+public:
+	//Makes the GPU query ring
+	static void Init();
+	//Deletes the queries
+	static void Unload();
+
+	//Starts and ends a frame, every scope has to be inside one
+	static void BeginFrame();
+	static void EndFrame();
+
+	//Times a CPU scope (name has to outlive the profiler, so stick to string literals)
+	static void BeginScope(const char* name);
+	static void EndScope();
+	//Times a GPU pass (name has to outlive the profiler)
+	static void BeginGPU(const char* name);
+	static void EndGPU();
+
+	//Turning it off skips the timing (scopes become a branch and a return)
+	static void SetEnabled(bool enabled);
+	static bool GetEnabled();
+
+	//Records the next few frames, then writes them to a Chrome trace file
+	static void CaptureFrames(int frames, const std::string& path);
+	//Writes whatever has been captured so far to a Chrome trace file, returns false if it couldn't
+	static bool ExportChromeTrace(const std::string& path);
+
+	//A scope from the last finished frame
+	struct ScopeTime
+	{
+		const char* Name;
+		int Depth;
+		bool GPU;
+		float Milliseconds;
+	};
+	//Fills times with the last frame's CPU scopes, then the GPU passes read back most recently (those are a few frames older)
+	static void GetLastFrame(std::vector<ScopeTime>& times);
+	//Fills times with the GPU passes of the newest frame whose queries have all come back, and frame with the frame they were issued on
+	//*Returns false if no frame has come back whole since the last call, so each one only gets handed out once
+	static bool GetResolvedGPUFrame(std::vector<ScopeTime>& times, uint64_t& frame);
+	//The frame BeginFrame will start next (or the one that's running)
+	static uint64_t GetFrameIndex();
+	//How long the last frame took on the CPU, from BeginFrame to EndFrame
+	static float GetLastFrameTime();
+
+	//Draws the profiler window, with a timeline of the last frame and each scope's history
+	static void RenderImGui();
+
+	//How many frames of history each scope keeps
+	static const int HISTORY_SIZE = 128;
+	//How many frames the GPU queries can fall behind by
+	static const int GPU_FRAMES = 4;
+	//Most GPU passes in a frame
+	static const int MAX_GPU_PASSES = 16;
+	//Most frames a capture can hold
+	static const int MAX_CAPTURE_FRAMES = 1000;
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	//A scope that ran this frame (times in ms from the start of the frame)
+	struct Event
+	{
+		const char* Name;
+		int Depth;
+		double Start;
+		double End;
+	};
+
+	//A scope's timings over the last frames
+	struct ScopeStats
+	{
+		const char* Name;
+		int Depth;
+		bool GPU;
+		float History[HISTORY_SIZE] = {};
+		//How long it took this frame, and the average and max over the history
+		float Last = 0.0f;
+		float Average = 0.0f;
+		float Max = 0.0f;
+		//The last frame it ran in
+		uint64_t LastFrame = 0;
+	};
+
+	//A GPU pass waiting on its query
+	struct GPUPass
+	{
+		const char* Name;
+		GLuint Query;
+	};
+
+	//A frame kept for a trace
+	struct CapturedFrame
+	{
+		double Start;
+		std::vector<Event> CPU;
+		std::vector<Event> GPU;
+	};
+
+	//Adds this frame's time to a scope's history
+	static void Record(const char* name, int depth, bool gpu, float ms);
+	//Reads back the GPU passes of the oldest frame in the ring
+	static void ReadGPUFrame(int slot);
+	//Milliseconds since the profiler started
+	static double Now();
+
+	static bool _enabled;
+	//Whether this frame is being timed (turning it off only takes effect between frames)
+	static bool _active;
+	static bool _paused;
+	static Clock::time_point _epoch;
+	static uint64_t _frame;
+	static double _frameStart;
+
+	//This frame's CPU scopes, and the ones still open
+	static std::vector<Event> _events;
+	static std::vector<size_t> _open;
+	//The last finished frame's CPU and GPU scopes, for the timeline
+	static std::vector<Event> _lastEvents;
+	static std::vector<Event> _lastGPUEvents;
+	static double _lastFrameTime;
+
+	//Query ring, each slot is a frame's passes
+	static GLuint _queries[GPU_FRAMES][MAX_GPU_PASSES];
+	static std::vector<GPUPass> _gpuPasses[GPU_FRAMES];
+	static int _gpuSlot;
+	static bool _gpuOpen;
+	//Which captured frame each slot's GPU passes belong to (-1 if it's not being captured)
+	static int _gpuCaptureIndex[GPU_FRAMES];
+	//The frame each slot's GPU passes were issued on
+	static uint64_t _gpuFrame[GPU_FRAMES];
+	//The newest GPU frame that came back whole, and whether it's been handed out yet
+	static std::vector<Event> _resolvedGPUEvents;
+	static uint64_t _resolvedGPUFrame;
+	static bool _resolvedGPUNew;
+
+	static std::vector<ScopeStats> _stats;
+
+	//The frames captured for a trace, and how many more to take
+	static std::vector<CapturedFrame> _captured;
+	static int _captureRemaining;
+	//Frames left to wait for the capture's GPU passes before writing it
+	static int _captureFlush;
+	static std::string _capturePath;
+};
+
+//Times the rest of the block it's in
+struct ProfileScope
+{
+	ProfileScope(const char* name) { Profiler::BeginScope(name); }
+	~ProfileScope() { Profiler::EndScope(); }
+};
+
+//Times the rest of the block it's in on the GPU
+struct GPUProfileScope
+{
+	GPUProfileScope(const char* name) { Profiler::BeginGPU(name); }
+	~GPUProfileScope() { Profiler::EndGPU(); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//Times the rest of the block on the CPU
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+//Times the rest of the block on the GPU
+#define PROFILE_GPU(name) GPUProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
@@ -0,0 +1,247 @@
+#include "Random.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RANDOM_USE_SSE2
+#endif
+
+std::atomic<uint64_t> Random::_globalSeed(0);
+std::atomic<uint32_t> Random::_seedGeneration(0);
+std::atomic<uint32_t> Random::_threadCount(0);
+
+//Spreads the bits of a 64 bit number out (used for seeding)
+static uint64_t SplitMix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+static inline uint32_t RotateLeft(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+//Turns the top 24 bits into a float in [0, 1)
+static inline float ToFloat(uint32_t x)
+{
+	return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+Random::Random(uint64_t seed)
+{
+	Seed(seed);
+}
+
+void Random::Seed(uint64_t seed)
+{
+	uint64_t mixer = seed;
+	uint64_t a = SplitMix64(mixer);
+	uint64_t b = SplitMix64(mixer);
+	_state[0] = (uint32_t)a;
+	_state[1] = (uint32_t)(a >> 32);
+	_state[2] = (uint32_t)b;
+	_state[3] = (uint32_t)(b >> 32);
+
+	//xoshiro gets stuck on all zeros
+	if ((_state[0] | _state[1] | _state[2] | _state[3]) == 0)
+		_state[0] = 1;
+}
+
+uint32_t Random::Next()
+{
+	uint32_t result = RotateLeft(_state[1] * 5, 7) * 9;
+	uint32_t t = _state[1] << 9;
+
+	_state[2] ^= _state[0];
+	_state[3] ^= _state[1];
+	_state[1] ^= _state[2];
+	_state[0] ^= _state[3];
+	_state[2] ^= t;
+	_state[3] = RotateLeft(_state[3], 11);
+
+	return result;
+}
+
+float Random::NextFloat()
+{
+	return ToFloat(Next());
+}
+
+int Random::Range(int from, int to)
+{
+	if (to <= from)
+		return from;
+
+	//Multiply and shift instead of % so small ranges don't favour low numbers
+	uint32_t range = (uint32_t)((int64_t)to - from);
+	return from + (int)(((uint64_t)Next() * range) >> 32);
+}
+
+float Random::Range(float from, float to)
+{
+	return from + (to - from) * NextFloat();
+}
+
+glm::vec2 Random::Range(glm::vec2 from, glm::vec2 to)
+{
+	float x = Range(from.x, to.x);
+	float y = Range(from.y, to.y);
+	return glm::vec2(x, y);
+}
+
+glm::vec3 Random::Range(glm::vec3 from, glm::vec3 to)
+{
+	float x = Range(from.x, to.x);
+	float y = Range(from.y, to.y);
+	float z = Range(from.z, to.z);
+	return glm::vec3(x, y, z);
+}
+
+glm::vec4 Random::Range(glm::vec4 from, glm::vec4 to)
+{
+	float x = Range(from.x, to.x);
+	float y = Range(from.y, to.y);
+	float z = Range(from.z, to.z);
+	float w = Range(from.w, to.w);
+	return glm::vec4(x, y, z, w);
+}
+
+void Random::FillFloats(float* out, size_t count, float from, float to)
+{
+	float scale = to - from;
+	size_t i = 0;
+
+	if (count >= 8)
+	{
+		//4 xoshiro128+ generators side by side, one per lane, each seeded off this stream
+		uint32_t lanes[4][4];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			for (int word = 0; word < 4; word++)
+			{
+				lanes[word][lane] = Next();
+			}
+			if ((lanes[0][lane] | lanes[1][lane] | lanes[2][lane] | lanes[3][lane]) == 0)
+				lanes[0][lane] = 1;
+		}
+
+		//Putting 23 random bits under the exponent of 1.0 makes a float in [1, 2)
+		//*(value in [1, 2)) * scale + (from - scale) lands in [from, to)
+		float offset = from - scale;
+#ifdef RANDOM_USE_SSE2
+		__m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[0]));
+		__m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[1]));
+		__m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[2]));
+		__m128i s3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[3]));
+
+		const __m128i one = _mm_set1_epi32(0x3F800000);
+		const __m128 offsets = _mm_set1_ps(offset);
+		const __m128 scales = _mm_set1_ps(scale);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i result = _mm_add_epi32(s0, s3);
+			__m128i t = _mm_slli_epi32(s1, 9);
+
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+			__m128 unit = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(result, 9), one));
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(unit, scales), offsets));
+		}
+#else
+		//The same 4 lanes one at a time, so a seed gives the same numbers with or without SSE2
+		for (; i + 4 <= count; i += 4)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				uint32_t result = lanes[0][lane] + lanes[3][lane];
+				uint32_t t = lanes[1][lane] << 9;
+
+				lanes[2][lane] ^= lanes[0][lane];
+				lanes[3][lane] ^= lanes[1][lane];
+				lanes[1][lane] ^= lanes[2][lane];
+				lanes[0][lane] ^= lanes[3][lane];
+				lanes[2][lane] ^= t;
+				lanes[3][lane] = RotateLeft(lanes[3][lane], 11);
+
+				uint32_t bits = (result >> 9) | 0x3F800000;
+				float unit;
+				memcpy(&unit, &bits, sizeof(float));
+				out[i + lane] = unit * scale + offset;
+			}
+		}
+#endif
+	}
+
+	for (; i < count; i++)
+	{
+		out[i] = from + scale * NextFloat();
+	}
+}
+
+void Random::FillVec2(glm::vec2* out, size_t count, glm::vec2 from, glm::vec2 to)
+{
+	//glm vectors are tightly packed floats, so fill every component in one go then stretch them into range
+	float* components = reinterpret_cast<float*>(out);
+	FillFloats(components, count * 2);
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = from + (to - from) * out[i];
+	}
+}
+
+void Random::FillVec3(glm::vec3* out, size_t count, glm::vec3 from, glm::vec3 to)
+{
+	float* components = reinterpret_cast<float*>(out);
+	FillFloats(components, count * 3);
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = from + (to - from) * out[i];
+	}
+}
+
+uint64_t Random::DeriveSeed(uint64_t seed, uint64_t stream)
+{
+	uint64_t mixer = seed ^ (stream * 0xD1B54A32D192ED03ull);
+	return SplitMix64(mixer);
+}
+
+Random& Random::ThreadLocal()
+{
+	struct ThreadGenerator
+	{
+		Random Generator;
+		uint32_t Generation = UINT32_MAX;
+		uint32_t Stream = _threadCount++;
+	};
+	thread_local ThreadGenerator thread;
+
+	//Pick up a new global seed
+	uint32_t generation = _seedGeneration.load();
+	if (thread.Generation != generation)
+	{
+		thread.Generator.Seed(DeriveSeed(_globalSeed.load(), thread.Stream));
+		thread.Generation = generation;
+	}
+
+	return thread.Generator;
+}
+
+void Random::SetGlobalSeed(uint64_t seed)
+{
+	_globalSeed = seed;
+	_seedGeneration++;
+}
+
+uint64_t Random::GetGlobalSeed()
+{
+	return _globalSeed.load();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <GLM/glm.hpp>
+
+//A seedable random number generator (xoshiro128**, seeded through splitmix64)
+//*Each Random is its own stream with no shared state, so threads never fight over one
+//*The same seed always gives the same numbers, on every platform
+class Random
+{
+public:
+	Random(uint64_t seed = 0);
+
+	//Restarts the stream from a seed
+	void Seed(uint64_t seed);
+
+	//Next raw 32 bits
+	uint32_t Next();
+	//Uniform float in [0, 1)
+	float NextFloat();
+
+	//Uniform number in [from, to) (ints can't return to, same as the old rand() % range)
+	int Range(int from, int to);
+	float Range(float from, float to);
+	glm::vec2 Range(glm::vec2 from, glm::vec2 to);
+	glm::vec3 Range(glm::vec3 from, glm::vec3 to);
+	glm::vec4 Range(glm::vec4 from, glm::vec4 to);
+
+	//Fills a buffer with uniform numbers in [from, to)
+	//*Generates 4 floats at a time with SSE2, from 4 lanes forked off this stream
+	//*Without SSE2 the same 4 lanes run one at a time, so a seed fills the same numbers either way
+	void FillFloats(float* out, size_t count, float from = 0.0f, float to = 1.0f);
+	void FillVec2(glm::vec2* out, size_t count, glm::vec2 from, glm::vec2 to);
+	void FillVec3(glm::vec3* out, size_t count, glm::vec3 from, glm::vec3 to);
+
+	//Mixes a seed with a stream number, for giving each chunk/thread/object its own reproducible stream
+	static uint64_t DeriveSeed(uint64_t seed, uint64_t stream);
+
+	//The calling thread's own generator
+	//*Seeded from the global seed and the order threads first asked for one
+	static Random& ThreadLocal();
+	//Reseeds every thread's generator (each thread picks it up the next time it asks for its generator)
+	static void SetGlobalSeed(uint64_t seed);
+	static uint64_t GetGlobalSeed();
+private:
+	uint32_t _state[4];
+
+	//The seed thread generators come from, and a count that goes up whenever it changes
+	static std::atomic<uint64_t> _globalSeed;
+	static std::atomic<uint32_t> _seedGeneration;
+	//Hands out stream numbers to threads
+	static std::atomic<uint32_t> _threadCount;
+};
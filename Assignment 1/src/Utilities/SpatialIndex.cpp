@@ -0,0 +1,180 @@
+#include "SpatialIndex.h"
+#include <cmath>
+#include "Graphics/FrustumCuller.h"
+#include "Utilities/Profiler.h"
+
+SpatialIndex::SpatialIndex()
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+	Unload();
+}
+
+void SpatialIndex::Init(entt::registry& registry)
+{
+	Unload();
+
+	_registry = &registry;
+	_registry->on_construct<WorldBounds>().connect<&SpatialIndex::OnBoundsAdded>(*this);
+	_registry->on_destroy<SpatialProxy>().connect<&SpatialIndex::OnProxyRemoved>(*this);
+
+	//Pick up anything that already has bounds
+	_registry->view<WorldBounds>().each([&](entt::entity entity, WorldBounds&) {
+		_pending.push_back(entity);
+	});
+}
+
+void SpatialIndex::Unload()
+{
+	if (_registry != nullptr)
+	{
+		_registry->on_construct<WorldBounds>().disconnect<&SpatialIndex::OnBoundsAdded>(*this);
+		_registry->on_destroy<SpatialProxy>().disconnect<&SpatialIndex::OnProxyRemoved>(*this);
+		_registry->clear<SpatialProxy>();
+		_registry = nullptr;
+	}
+
+	_tree.Clear();
+	_pending.clear();
+}
+
+void SpatialIndex::Update(const std::vector<entt::entity>& refitted)
+{
+	PROFILE_SCOPE("Spatial Index");
+	if (_registry == nullptr)
+		return;
+
+	int inserted = 0;
+	for (entt::entity entity : _pending)
+	{
+		if (!_registry->valid(entity) || _registry->has<SpatialProxy>(entity))
+			continue;
+
+		const WorldBounds* bounds = _registry->try_get<WorldBounds>(entity);
+		if (bounds == nullptr || bounds->Radius < 0.0f)
+			continue;
+
+		_registry->emplace<SpatialProxy>(entity, _tree.Insert(GetBox(*bounds), (uint32_t)entity));
+		inserted++;
+	}
+	_pending.clear();
+
+	//Something like the environment regenerating, build it properly instead of leaving it loose
+	if (inserted >= REBUILD_THRESHOLD)
+	{
+		_tree.Rebuild();
+	}
+
+	//Follow whatever moved (most don't leave their fat box, so this is cheap)
+	for (entt::entity entity : TransformSystem::GetLastUpdated())
+	{
+		MoveProxy(entity);
+	}
+	//Culling goes through the tree, so a new mesh's size can't wait for next frame
+	for (entt::entity entity : refitted)
+	{
+		if (_registry->valid(entity))
+		{
+			MoveProxy(entity);
+		}
+	}
+}
+
+void SpatialIndex::QueryAABB(const AABB& box, std::vector<entt::entity>& results) const
+{
+	_tree.QueryAABB(box, [&](uint32_t data) { results.push_back((entt::entity)data); });
+}
+
+void SpatialIndex::QuerySphere(const glm::vec3& centre, float radius, std::vector<entt::entity>& results) const
+{
+	_tree.QuerySphere(centre, radius, [&](uint32_t data) { results.push_back((entt::entity)data); });
+}
+
+void SpatialIndex::QueryFrustum(const glm::mat4& viewProjection, std::vector<entt::entity>& results) const
+{
+	glm::vec4 planes[6];
+	FrustumCuller::ExtractPlanes(viewProjection, planes);
+	_tree.QueryFrustum(planes, 6, [&](uint32_t data) { results.push_back((entt::entity)data); });
+}
+
+entt::entity SpatialIndex::RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* hitDistance) const
+{
+	entt::entity closest = entt::null;
+	if (_registry == nullptr)
+		return closest;
+
+	glm::vec3 normal = glm::normalize(direction);
+	_tree.RayCast(origin, normal, maxDistance, [&](uint32_t data, float) {
+		//The tree only knows the fat box, so check the actual sphere
+		const WorldBounds& bounds = _registry->get<WorldBounds>((entt::entity)data);
+		glm::vec3 offset = origin - bounds.Centre;
+		float b = glm::dot(offset, normal);
+		float c = glm::dot(offset, offset) - bounds.Radius * bounds.Radius;
+		float discriminant = b * b - c;
+		if (discriminant < 0.0f)
+			return maxDistance;
+
+		//Starting inside the sphere counts as hitting it straight away
+		float distance = glm::max(-b - std::sqrt(discriminant), 0.0f);
+		if (distance > maxDistance || -b + std::sqrt(discriminant) < 0.0f)
+			return maxDistance;
+
+		closest = (entt::entity)data;
+		maxDistance = distance;
+		return distance;
+	});
+
+	if (hitDistance != nullptr && closest != entt::null)
+	{
+		*hitDistance = maxDistance;
+	}
+	return closest;
+}
+
+const DynamicBVH& SpatialIndex::GetTree() const
+{
+	return _tree;
+}
+
+AABB SpatialIndex::GetBox(const WorldBounds& bounds)
+{
+	AABB box;
+	box.Min = bounds.Centre - glm::vec3(bounds.Radius);
+	box.Max = bounds.Centre + glm::vec3(bounds.Radius);
+	return box;
+}
+
+void SpatialIndex::MoveProxy(entt::entity entity)
+{
+	SpatialProxy* proxy = _registry->try_get<SpatialProxy>(entity);
+	const WorldBounds* bounds = _registry->try_get<WorldBounds>(entity);
+	if (bounds == nullptr || bounds->Radius < 0.0f)
+	{
+		//Swapped to a mesh we don't know the size of
+		if (proxy != nullptr)
+		{
+			_registry->remove<SpatialProxy>(entity);
+		}
+		return;
+	}
+
+	//Swapped back to a mesh we know, the bounds already existed so it won't be pending
+	if (proxy == nullptr)
+	{
+		_registry->emplace<SpatialProxy>(entity, _tree.Insert(GetBox(*bounds), (uint32_t)entity));
+		return;
+	}
+	_tree.Move(proxy->Proxy, GetBox(*bounds));
+}
+
+void SpatialIndex::OnBoundsAdded(entt::registry& registry, entt::entity entity)
+{
+	_pending.push_back(entity);
+}
+
+void SpatialIndex::OnProxyRemoved(entt::registry& registry, entt::entity entity)
+{
+	_tree.Remove(registry.get<SpatialProxy>(entity).Proxy);
+}
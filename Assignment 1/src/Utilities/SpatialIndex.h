@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include "Utilities/DynamicBVH.h"
+#include "Utilities/TransformSystem.h"
+
+//Which proxy in the spatial index an entity is
+struct SpatialProxy
+{
+	int Proxy;
+};
+
+//Keeps every entity with known WorldBounds in a DynamicBVH, for finding things by where they are
+//*New bounds get added on the next update, and entities get moved when TransformSystem updates their matrix
+//*Destroyed entities leave the tree straight away
+class SpatialIndex
+{
+public:
+	SpatialIndex();
+	~SpatialIndex();
+
+	//Starts tracking the bounds in the registry
+	void Init(entt::registry& registry);
+	//Stops tracking the registry and empties the tree
+	void Unload();
+
+	//Adds the new bounds and moves the ones that changed
+	//*Call after FrustumCuller::UpdateBounds, so bounds made this frame go in right away
+	//*refitted is the bounds UpdateBounds refit for a new mesh, they only reach TransformSystem's list next frame
+	void Update(const std::vector<entt::entity>& refitted);
+
+	//Fills results with every entity whose bounds might touch the shape (they're tested against the tree's boxes)
+	void QueryAABB(const AABB& box, std::vector<entt::entity>& results) const;
+	void QuerySphere(const glm::vec3& centre, float radius, std::vector<entt::entity>& results) const;
+	void QueryFrustum(const glm::mat4& viewProjection, std::vector<entt::entity>& results) const;
+	//The closest entity whose bounding sphere the ray hits (entt::null if there isn't one)
+	entt::entity RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* hitDistance = nullptr) const;
+
+	const DynamicBVH& GetTree() const;
+
+	//Adding at least this many in one update rebuilds the tree (it's looser when built one at a time)
+	static const int REBUILD_THRESHOLD = 1024;
+private:
+	//The box around a bounding sphere
+	static AABB GetBox(const WorldBounds& bounds);
+	//Moves an entity's proxy to its bounds, adding it if it got known bounds back and taking it out if they're unknown now
+	void MoveProxy(entt::entity entity);
+
+	//Registry callbacks
+	void OnBoundsAdded(entt::registry& registry, entt::entity entity);
+	void OnProxyRemoved(entt::registry& registry, entt::entity entity);
+
+	entt::registry* _registry = nullptr;
+	DynamicBVH _tree;
+	//Entities that got bounds since the last update
+	std::vector<entt::entity> _pending;
+};
@@ -0,0 +1,200 @@
+#include "TextureBaker.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <stb_image.h>
+#include "Utilities/Util.h"
+
+const char TextureBaker::MAGIC[4] = { 'C', 'T', 'E', 'X' };
+
+bool TextureBaker::BakeDirectory(const std::string& directory, bool force)
+{
+	std::error_code error;
+	std::filesystem::directory_iterator files(directory, error);
+	if (error)
+	{
+		printf("Couldn't open %s to bake\n", directory.c_str());
+		return false;
+	}
+
+	int baked = 0;
+	int skipped = 0;
+	int failed = 0;
+	for (const std::filesystem::directory_entry& entry : files)
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension != ".jpg" && extension != ".jpeg" && extension != ".png" && extension != ".bmp" && extension != ".tga")
+			continue;
+
+		std::string path = entry.path().generic_string();
+		if (!force && IsUpToDate(path))
+		{
+			skipped++;
+			continue;
+		}
+
+		if (BakeFile(path))
+			baked++;
+		else
+			failed++;
+	}
+
+	printf("Baked %d textures (%d already up to date, %d failed)\n", baked, skipped, failed);
+	return failed == 0;
+}
+
+bool TextureBaker::BakeFile(const std::string& path)
+{
+	//Same as the streamer, ignore the shared flip flag and flip it ourselves
+	stbi_set_flip_vertically_on_load_thread(0);
+	int width, height, channels;
+	uint8_t* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (pixels == nullptr)
+	{
+		printf("Couldn't load %s to bake\n", path.c_str());
+		return false;
+	}
+	//Same orientation the streamer uploads with
+	Util::FlipRows(pixels, width, height, 4);
+
+	std::vector<uint8_t> level(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	BlockFormat format = ChooseFormat(path, level.data(), width, height);
+
+	//Encode every mip down to 1x1
+	std::vector<CTexMip> mips;
+	std::vector<std::vector<uint8_t>> blocks;
+	int mipWidth = width;
+	int mipHeight = height;
+	while (true)
+	{
+		blocks.emplace_back();
+		BlockCompression::EncodeImage(format, level.data(), mipWidth, mipHeight, blocks.back());
+
+		CTexMip mip;
+		mip.Width = (uint32_t)mipWidth;
+		mip.Height = (uint32_t)mipHeight;
+		mip.Offset = 0;
+		mip.Size = (uint32_t)blocks.back().size();
+		mips.push_back(mip);
+
+		if (mipWidth == 1 && mipHeight == 1)
+			break;
+
+		std::vector<uint8_t> next;
+		Downsample(level, mipWidth, mipHeight, next);
+		level.swap(next);
+		mipWidth = std::max(mipWidth / 2, 1);
+		mipHeight = std::max(mipHeight / 2, 1);
+	}
+
+	CTexHeader header;
+	memcpy(header.Magic, MAGIC, 4);
+	header.Version = VERSION;
+	header.Format = (uint32_t)format;
+	header.Width = (uint32_t)width;
+	header.Height = (uint32_t)height;
+	header.MipCount = (uint32_t)mips.size();
+	header.SourceTime = 0;
+	header.SourceSize = 0;
+	Util::GetFileStamp(path, header.SourceTime, header.SourceSize);
+
+	uint32_t offset = (uint32_t)(sizeof(CTexHeader) + mips.size() * sizeof(CTexMip));
+	for (CTexMip& mip : mips)
+	{
+		mip.Offset = offset;
+		offset += mip.Size;
+	}
+
+	std::string bakedPath = GetBakedPath(path);
+	std::ofstream file(bakedPath, std::ios::binary);
+	if (!file)
+	{
+		printf("Couldn't write %s\n", bakedPath.c_str());
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CTexHeader));
+	file.write(reinterpret_cast<const char*>(mips.data()), mips.size() * sizeof(CTexMip));
+	for (const std::vector<uint8_t>& data : blocks)
+	{
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	return true;
+}
+
+BlockFormat TextureBaker::ChooseFormat(const std::string& path, const uint8_t* rgba, int width, int height)
+{
+	std::string name = std::filesystem::path(path).stem().string();
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	if (name.find("normal") != std::string::npos || name.find("_nrm") != std::string::npos)
+		return BlockFormat::BC5;
+
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		if (rgba[i * 4 + 3] != 255)
+			return BlockFormat::BC3;
+	}
+
+	return BlockFormat::BC1;
+}
+
+std::string TextureBaker::GetBakedPath(const std::string& imagePath)
+{
+	return std::filesystem::path(imagePath).replace_extension(".ctex").generic_string();
+}
+
+bool TextureBaker::IsUpToDate(const std::string& imagePath)
+{
+	std::ifstream file(GetBakedPath(imagePath), std::ios::binary);
+	if (!file)
+		return false;
+
+	CTexHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(CTexHeader)))
+		return false;
+
+	if (memcmp(header.Magic, MAGIC, 4) != 0 || header.Version != VERSION)
+		return false;
+
+	//A .ctex without its image is still fine to use
+	int64_t time;
+	uint64_t size;
+	if (Util::GetFileStamp(imagePath, time, size))
+		return time == header.SourceTime && size == header.SourceSize;
+	return true;
+}
+
+void TextureBaker::Downsample(const std::vector<uint8_t>& source, int width, int height, std::vector<uint8_t>& result)
+{
+	int resultWidth = std::max(width / 2, 1);
+	int resultHeight = std::max(height / 2, 1);
+	result.resize((size_t)resultWidth * resultHeight * 4);
+
+	for (int y = 0; y < resultHeight; y++)
+	{
+		//Clamped so 1 pixel wide/high images still work
+		int y0 = std::min(y * 2, height - 1);
+		int y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < resultWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1);
+			int x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c] +
+					source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+				result[((size_t)y * resultWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Utilities/BlockCompression.h"
+
+//Sits at the start of a .ctex, followed by MipCount CTexMip entries and then the block data
+struct CTexHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	//A BlockFormat
+	uint32_t Format;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipCount;
+	//The image the .ctex was baked from, so editing it rebakes
+	int64_t SourceTime;
+	uint64_t SourceSize;
+};
+
+//Where one mip level's blocks are in a .ctex
+struct CTexMip
+{
+	uint32_t Width;
+	uint32_t Height;
+	//From the start of the file
+	uint32_t Offset;
+	uint32_t Size;
+};
+
+//Bakes images into block compressed .ctex files with their whole mip chain
+//*Runs without a window (main does it with --bake-textures)
+class TextureBaker abstract
+{
+public:
+	//Bakes every image in the directory that doesn't have an up to date .ctex
+	//*Returns false if any of them failed
+	static bool BakeDirectory(const std::string& directory, bool force = false);
+	//Bakes one image into a .ctex next to it
+	static bool BakeFile(const std::string& path);
+
+	//Picks BC5 for normal maps, BC3 if there's any transparency and BC1 otherwise
+	static BlockFormat ChooseFormat(const std::string& path, const uint8_t* rgba, int width, int height);
+
+	//Where the .ctex for an image goes
+	static std::string GetBakedPath(const std::string& imagePath);
+	//Does the image have a .ctex baked from its current contents
+	static bool IsUpToDate(const std::string& imagePath);
+
+	static const char MAGIC[4];
+	static const uint32_t VERSION = 1;
+private:
+	//Box filters an RGBA8 image down to the next mip
+	static void Downsample(const std::vector<uint8_t>& source, int width, int height, std::vector<uint8_t>& result);
+};
@@ -0,0 +1,122 @@
+#include "TransformSystem.h"
+#include "Utilities/JobSystem.h"
+#include <cmath>
+
+std::vector<Transform*> TransformSystem::_toUpdate;
+std::vector<WorldBounds*> TransformSystem::_boundsToUpdate;
+std::vector<entt::entity> TransformSystem::_updated;
+size_t TransformSystem::_parallelThreshold = 1024;
+size_t TransformSystem::_lastUpdateCount = 0;
+
+void TransformSystem::Update(entt::registry& registry)
+{
+	_toUpdate.clear();
+	_boundsToUpdate.clear();
+	_updated.clear();
+
+	//Dynamic transforms update every frame
+	auto dynamicView = registry.view<Transform>(entt::exclude<StaticTransform>);
+	for (entt::entity entity : dynamicView)
+	{
+		_toUpdate.push_back(&dynamicView.get<Transform>(entity));
+		_boundsToUpdate.push_back(registry.try_get<WorldBounds>(entity));
+		_updated.push_back(entity);
+	}
+
+	//Static transforms only update when something changed them
+	auto dirtyView = registry.view<Transform, TransformDirty>();
+	for (entt::entity entity : dirtyView)
+	{
+		_toUpdate.push_back(&dirtyView.get<Transform>(entity));
+		_boundsToUpdate.push_back(registry.try_get<WorldBounds>(entity));
+		_updated.push_back(entity);
+	}
+	registry.clear<TransformDirty>();
+
+	//Every transform is independent, so big batches get spread across the workers
+	if (_toUpdate.size() >= _parallelThreshold)
+	{
+		JobSystem::ParallelFor(_toUpdate.size(), 256, [](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				UpdateOne(i);
+			}
+		});
+	}
+	else
+	{
+		for (size_t i = 0; i < _toUpdate.size(); i++)
+		{
+			UpdateOne(i);
+		}
+	}
+
+	_lastUpdateCount = _toUpdate.size();
+}
+
+void TransformSystem::UpdateOne(size_t index)
+{
+	_toUpdate[index]->UpdateWorldMatrix();
+	//Bounds follow the matrix while it's still in cache
+	if (_boundsToUpdate[index] != nullptr)
+	{
+		_boundsToUpdate[index]->Refit(_toUpdate[index]->WorldTransform());
+	}
+}
+
+void TransformSystem::MarkStatic(entt::registry& registry, entt::entity entity)
+{
+	registry.emplace_or_replace<StaticTransform>(entity);
+	//Needs one update to get its world matrix
+	registry.emplace_or_replace<TransformDirty>(entity);
+}
+
+void TransformSystem::MarkStatic(entt::registry& registry, const std::vector<entt::entity>& entities)
+{
+	registry.insert<StaticTransform>(entities.begin(), entities.end());
+	registry.insert<TransformDirty>(entities.begin(), entities.end());
+}
+
+void TransformSystem::MarkDynamic(entt::registry& registry, entt::entity entity)
+{
+	registry.remove_if_exists<StaticTransform>(entity);
+	registry.remove_if_exists<TransformDirty>(entity);
+}
+
+void TransformSystem::MarkDirty(entt::registry& registry, entt::entity entity)
+{
+	//Dynamic transforms get updated anyways
+	if (registry.has<StaticTransform>(entity))
+	{
+		registry.emplace_or_replace<TransformDirty>(entity);
+	}
+}
+
+void TransformSystem::SetParallelThreshold(size_t threshold)
+{
+	_parallelThreshold = threshold;
+}
+
+size_t TransformSystem::GetLastUpdateCount()
+{
+	return _lastUpdateCount;
+}
+
+void WorldBounds::Refit(const glm::mat4& world)
+{
+	if (LocalRadius < 0.0f)
+	{
+		Radius = -1.0f;
+		return;
+	}
+
+	Centre = glm::vec3(world * glm::vec4(LocalCentre, 1.0f));
+	//Non uniform scale stretches the sphere, so cover it with the biggest axis
+	float scale = glm::max(glm::max(glm::dot(world[0], world[0]), glm::dot(world[1], world[1])), glm::dot(world[2], world[2]));
+	Radius = LocalRadius * std::sqrt(scale);
+}
+
+const std::vector<entt::entity>& TransformSystem::GetLastUpdated()
+{
+	return _updated;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <entt.hpp>
+#include <Transform.h>
+
+//Tag for transforms that don't move on their own (scenery, props)
+//*They only get their world matrix recomputed when marked dirty
+struct StaticTransform {};
+
+//Tag for static transforms that changed and need their world matrix recomputed
+struct TransformDirty {};
+
+class VertexArrayObject;
+
+//A renderer's bounding sphere, around its mesh and out in the world
+//*The world sphere gets refit whenever the transform's world matrix is updated
+//*A negative radius means the mesh has no known bounds (it's never culled)
+struct WorldBounds
+{
+	//The mesh the local sphere was fit to, so swapping meshes refits it
+	const VertexArrayObject* Mesh = nullptr;
+	glm::vec3 LocalCentre = glm::vec3(0.0f);
+	float LocalRadius = -1.0f;
+	glm::vec3 Centre = glm::vec3(0.0f);
+	float Radius = -1.0f;
+
+	//Moves the world sphere to a world matrix (scaled by the matrix's biggest axis)
+	void Refit(const glm::mat4& world);
+};
+
+//Updates world matrices, skipping static transforms that haven't changed
+class TransformSystem abstract
+{
+public:
+	//Updates every dynamic transform and the dirty static ones (and their world bounds)
+	//*Spreads the work across the job system when there's enough of it
+	static void Update(entt::registry& registry);
+
+	//Marks a transform as static (it gets updated once, then only when marked dirty)
+	static void MarkStatic(entt::registry& registry, entt::entity entity);
+	//Marks a group of brand new entities as static in one go (they can't have been marked already)
+	static void MarkStatic(entt::registry& registry, const std::vector<entt::entity>& entities);
+	//Marks a transform as dynamic again (updated every frame)
+	static void MarkDynamic(entt::registry& registry, entt::entity entity);
+	//Tells us a static transform changed
+	//*Transform in this tree has no parent links, so each entity is its own subtree
+	static void MarkDirty(entt::registry& registry, entt::entity entity);
+
+	//How many transforms there need to be before we go wide
+	static void SetParallelThreshold(size_t threshold);
+	//How many world matrices got recomputed last update
+	static size_t GetLastUpdateCount();
+	//The entities whose world matrices got recomputed last update
+	static const std::vector<entt::entity>& GetLastUpdated();
+private:
+	//Updates the world matrix (and bounds) at an index in _toUpdate
+	static void UpdateOne(size_t index);
+
+	//The transforms that need updating this frame
+	static std::vector<Transform*> _toUpdate;
+	//Their bounds and entities, lined up with _toUpdate (nullptr if they don't have any bounds)
+	static std::vector<WorldBounds*> _boundsToUpdate;
+	static std::vector<entt::entity> _updated;
+	static size_t _parallelThreshold;
+	static size_t _lastUpdateCount;
+};
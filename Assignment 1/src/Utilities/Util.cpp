@@ -1,9 +1,11 @@
 #include "Util.h"
+#include <filesystem>
+#include <algorithm>
 
 bool Util::Init()
 {
-    //Seeds random so we can use it
-    srand(time(NULL));
+    //Seeds random so we can use it (set a fixed seed with Random::SetGlobalSeed to get the same numbers every run)
+    Random::SetGlobalSeed((uint64_t)time(NULL));
 
     return true;
 }
@@ -60,100 +62,133 @@ bool Util::CheckNumBetween(glm::vec4 num, glm::vec4 min, glm::vec4 max)
     return (x && y && z && w);
 }
 
-int Util::GetRandomNumberBetween(int from, int to, std::vector<int> avoidFrom, std::vector<int> avoidTo)
+//Is the number inside any of the avoided ranges
+template <typename T>
+static bool IsAvoided(const T& num, const std::vector<T>& avoidFrom, const std::vector<T>& avoidTo)
 {
-    //Just the typical random number generation within range
-    int randomNum = (rand() % (to - from)) + from;
-
-    for (int i = 0; i < avoidFrom.size(); i++)
+    for (size_t i = 0; i < avoidFrom.size() && i < avoidTo.size(); i++)
     {
-        if (CheckNumBetween(randomNum, avoidFrom[i], avoidTo[i]))
+        if (Util::CheckNumBetween(num, avoidFrom[i], avoidTo[i]))
         {
-            return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+            return true;
         }
     }
 
-    return randomNum;
+    return false;
 }
 
-float Util::GetRandomNumberBetween(float from, float to, std::vector<float> avoidFrom, std::vector<float> avoidTo)
+int Util::GetRandomNumberBetween(int from, int to, const std::vector<int>& avoidFrom, const std::vector<int>& avoidTo)
 {
-    //DO NOT DIVIDE BY Z    if (to == 0.0f || from == 0.0f)
+    //Rerolls in a loop rather than recursing, so an area that's mostly avoided can't blow the stack
+    int randomNum = from;
+    for (int attempt = 0; attempt < MAX_AVOID_ATTEMPTS; attempt++)
     {
-        //Just add very small number to make sure it isn't zero
-        to += 0.0001f;
-        from += 0.0001f;
+        //Just the typical random number generation within range
+        randomNum = Random::ThreadLocal().Range(from, to);
+
+        if (!IsAvoided(randomNum, avoidFrom, avoidTo))
+        {
+            return randomNum;
+        }
     }
 
-    //Uses static casting to convert rand to a float to allow us
-    //to divide it by RAND_MAX (which has been modified to suit our range)
-    //in order to convert it into a float range
-    float randomNum = from + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (to - from)));
+    return randomNum;
+}
 
-    for (int i = 0; i < avoidFrom.size(); i++)
+float Util::GetRandomNumberBetween(float from, float to, const std::vector<float>& avoidFrom, const std::vector<float>& avoidTo)
+{
+    float randomNum = from;
+    for (int attempt = 0; attempt < MAX_AVOID_ATTEMPTS; attempt++)
     {
-        if (CheckNumBetween(randomNum, avoidFrom[i], avoidTo[i]))
+        //Scales a random [0, 1) float into our range
+        randomNum = Random::ThreadLocal().Range(from, to);
+
+        if (!IsAvoided(randomNum, avoidFrom, avoidTo))
         {
-            return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+            return randomNum;
         }
     }
 
     return randomNum;
 }
 
-glm::vec2 Util::GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, std::vector <glm::vec2> avoidFrom, std::vector <glm::vec2> avoidTo)
+glm::vec2 Util::GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, const std::vector <glm::vec2>& avoidFrom, const std::vector <glm::vec2>& avoidTo)
 {
-    //Calls the float version on individual components
-    glm::vec2 randomNum;
-    randomNum.x = GetRandomNumberBetween(from.x, to.x);
-    randomNum.y = GetRandomNumberBetween(from.y, to.y);
-
-    for (int i = 0; i < avoidFrom.size(); i++)
+    glm::vec2 randomNum = from;
+    for (int attempt = 0; attempt < MAX_AVOID_ATTEMPTS; attempt++)
     {
-        if (CheckNumBetween(randomNum, avoidFrom[i], avoidTo[i]))
+        //Calls the float version on individual components
+        randomNum.x = GetRandomNumberBetween(from.x, to.x);
+        randomNum.y = GetRandomNumberBetween(from.y, to.y);
+
+        if (!IsAvoided(randomNum, avoidFrom, avoidTo))
         {
-            return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+            return randomNum;
         }
     }
 
     return randomNum;
 }
 
-glm::vec3 Util::GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, std::vector <glm::vec3> avoidFrom, std::vector <glm::vec3> avoidTo)
+glm::vec3 Util::GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, const std::vector <glm::vec3>& avoidFrom, const std::vector <glm::vec3>& avoidTo)
 {
-    //Calls the float version on individual components
-    glm::vec3 randomNum;
-    randomNum.x = GetRandomNumberBetween(from.x, to.x);
-    randomNum.y = GetRandomNumberBetween(from.y, to.y);
-    randomNum.z = GetRandomNumberBetween(from.z, to.z);
-    
-    for (int i = 0; i < avoidFrom.size(); i++)
+    glm::vec3 randomNum = from;
+    for (int attempt = 0; attempt < MAX_AVOID_ATTEMPTS; attempt++)
     {
-        if (CheckNumBetween(randomNum, avoidFrom[i], avoidTo[i]))
+        //Calls the float version on individual components
+        randomNum.x = GetRandomNumberBetween(from.x, to.x);
+        randomNum.y = GetRandomNumberBetween(from.y, to.y);
+        randomNum.z = GetRandomNumberBetween(from.z, to.z);
+
+        if (!IsAvoided(randomNum, avoidFrom, avoidTo))
         {
-            return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+            return randomNum;
         }
     }
 
     return randomNum;
 }
 
-glm::vec3 Util::GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, std::vector <glm::vec4> avoidFrom, std::vector <glm::vec4> avoidTo)
+glm::vec3 Util::GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, const std::vector <glm::vec4>& avoidFrom, const std::vector <glm::vec4>& avoidTo)
 {
-    //Calls the float version on individual components
-    glm::vec4 randomNum;
-    randomNum.x = GetRandomNumberBetween(from.x, to.x);
-    randomNum.y = GetRandomNumberBetween(from.y, to.y);
-    randomNum.z = GetRandomNumberBetween(from.z, to.z);
-    randomNum.w = GetRandomNumberBetween(from.w, to.w);
-    
-    for (int i = 0; i < avoidFrom.size(); i++)
+    glm::vec4 randomNum = from;
+    for (int attempt = 0; attempt < MAX_AVOID_ATTEMPTS; attempt++)
     {
-        if (CheckNumBetween(randomNum, avoidFrom[i], avoidTo[i]))
+        //Calls the float version on individual components
+        randomNum.x = GetRandomNumberBetween(from.x, to.x);
+        randomNum.y = GetRandomNumberBetween(from.y, to.y);
+        randomNum.z = GetRandomNumberBetween(from.z, to.z);
+        randomNum.w = GetRandomNumberBetween(from.w, to.w);
+
+        if (!IsAvoided(randomNum, avoidFrom, avoidTo))
         {
-            return GetRandomNumberBetween(from, to, avoidFrom, avoidTo);
+            return randomNum;
         }
     }
 
     return randomNum;
 }
+
+bool Util::GetFileStamp(const std::string& path, int64_t& time, uint64_t& size)
+{
+    std::error_code error;
+    auto writeTime = std::filesystem::last_write_time(path, error);
+    if (error)
+        return false;
+
+    size = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+
+    time = (int64_t)writeTime.time_since_epoch().count();
+    return true;
+}
+
+void Util::FlipRows(uint8_t* pixels, int width, int height, int channels)
+{
+    size_t rowSize = (size_t)width * channels;
+    for (int top = 0, bottom = height - 1; top < bottom; top++, bottom--)
+    {
+        std::swap_ranges(pixels + rowSize * top, pixels + rowSize * (top + 1), pixels + rowSize * bottom);
+    }
+}
\ No newline at end of file
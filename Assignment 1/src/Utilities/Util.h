@@ -2,6 +2,9 @@
 #include <GLM/glm.hpp>
 #include <time.h>
 #include <vector>
+#include <string>
+#include <cstdint>
+#include "Utilities/Random.h"
 
 namespace Util
 {
@@ -31,9 +34,21 @@ namespace Util
 	bool CheckNumBetween(glm::vec4 num, glm::vec4 min, glm::vec4 max);
 
 	//Get random number between two values, while avoiding multiple specific ranges of numbers (or none)
-	int GetRandomNumberBetween(int from, int to, std::vector<int> avoidFrom = std::vector<int>(), std::vector<int> avoidTo = std::vector<int>());
-	float GetRandomNumberBetween(float from, float to, std::vector<float> avoidFrom = std::vector<float>(), std::vector<float> avoidTo = std::vector<float>());
-	glm::vec2 GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, std::vector <glm::vec2> avoidFrom = std::vector <glm::vec2>(), std::vector <glm::vec2> avoidTo = std::vector <glm::vec2>());
-	glm::vec3 GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, std::vector <glm::vec3> avoidFrom = std::vector <glm::vec3>(), std::vector <glm::vec3> avoidTo = std::vector <glm::vec3>());
-	glm::vec3 GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, std::vector <glm::vec4> avoidFrom = std::vector <glm::vec4>(), std::vector <glm::vec4> avoidTo = std::vector <glm::vec4>());
+	//*Draws from the calling thread's Random, so it's safe to call from jobs
+	//*Gives up after MAX_AVOID_ATTEMPTS rolls that all land in avoided ranges and returns the last roll
+	int GetRandomNumberBetween(int from, int to, const std::vector<int>& avoidFrom = std::vector<int>(), const std::vector<int>& avoidTo = std::vector<int>());
+	float GetRandomNumberBetween(float from, float to, const std::vector<float>& avoidFrom = std::vector<float>(), const std::vector<float>& avoidTo = std::vector<float>());
+	glm::vec2 GetRandomNumberBetween(glm::vec2 from, glm::vec2 to, const std::vector <glm::vec2>& avoidFrom = std::vector <glm::vec2>(), const std::vector <glm::vec2>& avoidTo = std::vector <glm::vec2>());
+	glm::vec3 GetRandomNumberBetween(glm::vec3 from, glm::vec3 to, const std::vector <glm::vec3>& avoidFrom = std::vector <glm::vec3>(), const std::vector <glm::vec3>& avoidTo = std::vector <glm::vec3>());
+	glm::vec3 GetRandomNumberBetween(glm::vec4 from, glm::vec4 to, const std::vector <glm::vec4>& avoidFrom = std::vector <glm::vec4>(), const std::vector <glm::vec4>& avoidTo = std::vector <glm::vec4>());
+
+	const int MAX_AVOID_ATTEMPTS = 1000;
+
+	//Gets the last write time and size of a file (for checking if a cache built from it is stale)
+	//*Returns false if the file isn't there
+	bool GetFileStamp(const std::string& path, int64_t& time, uint64_t& size);
+
+	//Flips an image upside down in place (images load top down, OpenGL wants them bottom up)
+	//*Use this instead of stbi_set_flip_vertically_on_load, that flag is shared by every thread loading images
+	void FlipRows(uint8_t* pixels, int width, int height, int channels);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <json.hpp>
 #include <fstream>
+#include <cstring>
 
 #include <Texture2D.h>
 #include <Texture2DData.h>
@@ -28,7 +29,27 @@
 
 bool lighton;
 
-int main() {
+int main(int argc, char** argv) {
+	// Bake res/images into block compressed .ctex files and leave (doesn't need a window)
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--bake-textures") == 0) {
+			return TextureBaker::BakeDirectory("images") ? 0 : 1;
+		}
+		// Round trip synthetic blocks through the texture compressor and check how close they come back (no window needed)
+		if (strcmp(argv[i], "--test-block-compression") == 0) {
+			return BlockCompression::RunSelfTest() ? 0 : 1;
+		}
+		// Time the spatial index's queries at a few sizes and leave
+		if (strcmp(argv[i], "--bench-bvh") == 0) {
+			DynamicBVH::RunBenchmark();
+			return 0;
+		}
+		// Render a scene description along a fixed camera path in a hidden window and write out the timings
+		if (strcmp(argv[i], "--benchmark") == 0) {
+			return Benchmark::Run(argc, argv);
+		}
+	}
+
 	int frameIx = 0;
 	float fpsBuffer[128];
 	float minFps, maxFps, avgFps;
@@ -47,17 +68,33 @@ int main() {
 	// Push another scope so most memory should be freed *before* we exit the app
 	{
 		#pragma region Shader and ImGui
-		Shader::sptr passthroughShader = Shader::Create();
-		passthroughShader->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
-		passthroughShader->LoadShaderPartFromFile("shaders/passthrough_frag.glsl", GL_FRAGMENT_SHADER);
-		passthroughShader->Link();
-
+		Shader::sptr passthroughShader = AssetCache::GetShader("shaders/passthrough_vert.glsl", "shaders/passthrough_frag.glsl");
+
+		// Sorts, culls and draws the scene, then runs the post effects
+		SceneRenderer renderer;
+
+		// Post processing gets run over the scene before it hits the screen, every effect starts off
+		PostEffectChain& postEffects = renderer.GetPostEffects();
+		GreyscaleEffect::sptr greyscaleEffect = GreyscaleEffect::Create();
+		greyscaleEffect->SetEnabled(false);
+		postEffects.AddEffect(greyscaleEffect);
+		SepiaEffect::sptr sepiaEffect = SepiaEffect::Create();
+		sepiaEffect->SetEnabled(false);
+		postEffects.AddEffect(sepiaEffect);
+		LUTEffect::sptr lutEffect = LUTEffect::Create();
+		lutEffect->SetEnabled(false);
+		postEffects.AddEffect(lutEffect);
+		char lutFile[128] = "";
+
+		// Renderers and instance batches off screen get skipped before they're drawn
+		FrustumCuller& culler = renderer.GetCuller();
+		// Everything with bounds, kept in a tree so it can be found by where it is
+		SpatialIndex& spatialIndex = renderer.GetSpatialIndex();
+		// Static renderers merged into shared buffers, drawn with one indirect call per material
+		StaticGeometry& staticGeometry = renderer.GetStaticGeometry();
 
 		// Load our shaders
-		Shader::sptr shader = Shader::Create();
-		shader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		shader->LoadShaderPartFromFile("shaders/frag_phong.glsl", GL_FRAGMENT_SHADER);
-		shader->Link();
+		Shader::sptr shader = AssetCache::GetShader("shaders/vertex_shader.glsl", "shaders/frag_phong.glsl");
 
 		glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 5.0f);
 		glm::vec3 lightCol = glm::vec3(0.5f, 0.5f, 0.7f);
@@ -69,62 +106,176 @@ int main() {
 		float     lightQuadraticFalloff = 0.032f;
 		float	  diffuse = 1.0f;
 
+		// The lighting goes on the phong shader, and the deferred lighting pass that shares its uniforms
+		auto setLighting = [&](const char* name, const auto& value) {
+			shader->SetUniform(name, value);
+			renderer.GetLightingShader()->SetUniform(name, value);
+		};
+		// Materials using the phong shader can be written to the G-buffer when deferred shading is on
+		renderer.SetDeferredShader(shader);
+		// Point lights spawned from the UI, binned into clusters so each pixel only loops over the ones that reach it
+		std::vector<entt::entity> pointLights;
+
 
 		// These are our application / scene level uniforms that don't necessarily update
 		// every frame
-		shader->SetUniform("u_LightPos", lightPos);
-		shader->SetUniform("u_LightCol", lightCol);
-		shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-		shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-		shader->SetUniform("u_AmbientCol", ambientCol);
-		shader->SetUniform("u_AmbientStrength", ambientPow);
-		shader->SetUniform("u_LightAttenuationConstant", 1.0f);
-		shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-		shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
-		shader->SetUniform("u_toonShading", diffuse);
+		setLighting("u_LightPos", lightPos);
+		setLighting("u_LightCol", lightCol);
+		setLighting("u_AmbientLightStrength", lightAmbientPow);
+		setLighting("u_SpecularLightStrength", lightSpecularPow);
+		setLighting("u_AmbientCol", ambientCol);
+		setLighting("u_AmbientStrength", ambientPow);
+		setLighting("u_LightAttenuationConstant", 1.0f);
+		setLighting("u_LightAttenuationLinear", lightLinearFalloff);
+		setLighting("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+		setLighting("u_toonShading", diffuse);
 
 		// We'll add some ImGui controls to control our shader
 		BackendHandler::imGuiCallbacks.push_back([&]() {
 			if (ImGui::CollapsingHeader("Environment generation"))
 			{
+				// Regenerating rolls a new seed, typing one in brings that exact environment back
 				if (ImGui::Button("Regenerate Environment", ImVec2(200.0f, 40.0f)))
 				{
+					EnvironmentGenerator::SetSeed(Random::ThreadLocal().Next());
 					EnvironmentGenerator::RegenerateEnvironment();
 				}
+				int seed = (int)EnvironmentGenerator::GetSeed();
+				if (ImGui::InputInt("Seed", &seed))
+				{
+					EnvironmentGenerator::SetSeed((uint32_t)seed);
+					EnvironmentGenerator::RegenerateEnvironment();
+				}
+				// Instancing draws each object type with one draw call instead of one per object
+				bool instancing = EnvironmentGenerator::GetInstancing();
+				if (ImGui::Checkbox("Instanced Environment", &instancing))
+				{
+					EnvironmentGenerator::SetInstancing(instancing);
+					EnvironmentGenerator::RegenerateEnvironment();
+				}
+				float density = EnvironmentGenerator::GetDensityMultiplier();
+				if (ImGui::SliderFloat("Density Multiplier", &density, 0.0f, 100.0f))
+				{
+					EnvironmentGenerator::SetDensityMultiplier(density);
+				}
+				// Streaming fills tiles in around the camera as it moves, instead of one fixed patch
+				bool streaming = EnvironmentGenerator::GetStreaming();
+				if (ImGui::Checkbox("Stream World Tiles", &streaming))
+				{
+					EnvironmentGenerator::SetStreaming(streaming);
+					EnvironmentGenerator::RegenerateEnvironment();
+				}
+				float streamRadius = EnvironmentGenerator::GetStreamRadius();
+				if (ImGui::SliderFloat("Stream Radius", &streamRadius, 8.0f, 200.0f))
+				{
+					EnvironmentGenerator::SetStreamRadius(streamRadius);
+				}
+				if (streaming)
+				{
+					ImGui::Text("Tiles loaded: %d (%d generating)", EnvironmentGenerator::GetLoadedTileCount(), EnvironmentGenerator::GetPendingTileCount());
+				}
 			}
 			if (ImGui::CollapsingHeader("Scene Level Lighting Settings"))
 			{
 				if (ImGui::ColorPicker3("Ambient Color", glm::value_ptr(ambientCol))) {
-					shader->SetUniform("u_AmbientCol", ambientCol);
+					setLighting("u_AmbientCol", ambientCol);
 				}
 				if (ImGui::SliderFloat("Fixed Ambient Power", &ambientPow, 0.01f, 1.0f)) {
-					shader->SetUniform("u_AmbientStrength", ambientPow);
+					setLighting("u_AmbientStrength", ambientPow);
 				}
 			}
 			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
 			{
 				if (ImGui::DragFloat3("Light Pos", glm::value_ptr(lightPos), 0.01f, -10.0f, 10.0f)) {
-					shader->SetUniform("u_LightPos", lightPos);
+					setLighting("u_LightPos", lightPos);
 				}
 				if (ImGui::ColorPicker3("Light Col", glm::value_ptr(lightCol))) {
-					shader->SetUniform("u_LightCol", lightCol);
+					setLighting("u_LightCol", lightCol);
 				}
 				if (ImGui::SliderFloat("Light Ambient Power", &lightAmbientPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
 				}
 				if (ImGui::SliderFloat("Light Specular Power", &lightSpecularPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 				}
 				if (ImGui::DragFloat("Light Linear Falloff", &lightLinearFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
+					setLighting("u_LightAttenuationLinear", lightLinearFalloff);
 				}
 				if (ImGui::DragFloat("Light Quadratic Falloff", &lightQuadraticFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+					setLighting("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+				}
+			}
+			if (ImGui::CollapsingHeader("Deferred Shading and Point Lights"))
+			{
+				// Lights the phong materials once per pixel from a G-buffer, instead of per object
+				bool deferred = renderer.GetDeferred();
+				if (ImGui::Checkbox("Deferred Shading", &deferred)) {
+					renderer.SetDeferred(deferred);
 				}
+				int lightCount = (int)pointLights.size();
+				if (ImGui::SliderInt("Point Lights", &lightCount, 0, LightBuffer::MAX_LIGHTS)) {
+					entt::registry& registry = Application::Instance().ActiveScene->Registry();
+					while ((int)pointLights.size() < lightCount) {
+						GameObject light = Application::Instance().ActiveScene->CreateEntity("point light");
+						light.get<Transform>().SetLocalPosition(Random::ThreadLocal().Range(glm::vec3(-30.0f, -30.0f, 0.5f), glm::vec3(30.0f, 30.0f, 3.0f)));
+						PointLight& pointLight = light.emplace<PointLight>();
+						pointLight.Colour = Random::ThreadLocal().Range(glm::vec3(0.2f), glm::vec3(1.0f));
+						pointLight.Radius = 4.0f;
+						TransformSystem::MarkStatic(registry, light.entity());
+						pointLights.push_back(light.entity());
+					}
+					while ((int)pointLights.size() > lightCount) {
+						registry.destroy(pointLights.back());
+						pointLights.pop_back();
+					}
+				}
+				ImGui::Text("Point lights uploaded: %d", renderer.GetLightBuffer().GetCount());
+				const LightClusters& clusters = renderer.GetLightClusters();
+				ImGui::Text("Light clusters: %d of %d lit, %d light indices, at most %d lights in one", clusters.GetOccupiedCount(),
+					(int)LightClusters::CLUSTER_COUNT, clusters.GetIndexCount(), clusters.GetMaxPerCluster());
 			}
 
 			auto name = controllables[selectedVao].get<GameObjectTag>().Name;
 			ImGui::Text(name.c_str());
+			if (ImGui::CollapsingHeader("Post Processing"))
+			{
+				bool enabled = greyscaleEffect->GetEnabled();
+				if (ImGui::Checkbox("Greyscale", &enabled)) {
+					greyscaleEffect->SetEnabled(enabled);
+				}
+				float intensity = greyscaleEffect->GetIntensity();
+				if (ImGui::SliderFloat("Greyscale Intensity", &intensity, 0.0f, 1.0f)) {
+					greyscaleEffect->SetIntensity(intensity);
+				}
+				enabled = sepiaEffect->GetEnabled();
+				if (ImGui::Checkbox("Sepia", &enabled)) {
+					sepiaEffect->SetEnabled(enabled);
+				}
+				intensity = sepiaEffect->GetIntensity();
+				if (ImGui::SliderFloat("Sepia Intensity", &intensity, 0.0f, 1.0f)) {
+					sepiaEffect->SetIntensity(intensity);
+				}
+				enabled = lutEffect->GetEnabled();
+				if (ImGui::Checkbox("Colour Grading", &enabled)) {
+					lutEffect->SetEnabled(enabled);
+				}
+				intensity = lutEffect->GetIntensity();
+				if (ImGui::SliderFloat("Colour Grading Intensity", &intensity, 0.0f, 1.0f)) {
+					lutEffect->SetIntensity(intensity);
+				}
+				// Cubes get loaded from Resources/cube
+				ImGui::InputText("LUT File", lutFile, 128);
+				if (ImGui::Button("Load LUT")) {
+					lutEffect->SetLUT(std::make_shared<LUT3D>(std::string(lutFile)));
+				}
+				// Adjacent per-pixel effects share a pass, so this stays at 1 with all three on
+				ImGui::Text("Post passes: %d", postEffects.GetPassCount());
+				// Targets whose passes don't overlap share a framebuffer
+				const FrameGraph& frameGraph = renderer.GetFrameGraph();
+				ImGui::Text("Render targets: %d transient in %d framebuffers, %.1f MB allocated (%.1f MB peak live, %.1f MB unaliased)",
+					frameGraph.GetTargetCount(), frameGraph.GetPooledCount(), frameGraph.GetAllocatedBytes() / 1048576.0,
+					frameGraph.GetPeakBytes() / 1048576.0, frameGraph.GetUnaliasedBytes() / 1048576.0);
+			}
 			auto behaviour = BehaviourBinding::Get<SimpleMoveBehaviour>(controllables[selectedVao]);
 			ImGui::Checkbox("Relative Rotation", &behaviour->Relative);
 
@@ -140,6 +291,28 @@ int main() {
 			}
 			ImGui::PlotLines("FPS", fpsBuffer, 128);
 			ImGui::Text("MIN: %f MAX: %f AVG: %f", minFps, maxFps, avgFps / 128.0f);
+			ImGui::Text("Transforms updated: %d", (int)TransformSystem::GetLastUpdateCount());
+			bool culling = culler.GetEnabled();
+			if (ImGui::Checkbox("Frustum Culling", &culling)) {
+				culler.SetEnabled(culling);
+			}
+			ImGui::Text("Culled: %d of %d renderers, %d of %d instance batches", culler.GetCulledCount(),
+				culler.GetCulledCount() + culler.GetVisibleCount(), renderer.GetBatchesCulled(), (int)EnvironmentGenerator::GetInstanceBatches().size());
+			bool indirect = staticGeometry.GetEnabled();
+			if (ImGui::Checkbox("Indirect Static Draws", &indirect)) {
+				staticGeometry.SetEnabled(indirect);
+			}
+			ImGui::Text("Indirect: %d static renderers, %d meshes, %d draw calls (%d rebuilds)", staticGeometry.GetMergedCount(),
+				staticGeometry.GetMeshCount(), (int)staticGeometry.GetGroupCount(), staticGeometry.GetRebuildCount());
+			ImGui::Text("LOD: %d switched, %d too small to draw", LODSystem::GetLastSwitchCount(), LODSystem::GetHiddenCount());
+			ImGui::Text("Spatial index: %d entities, height %d", spatialIndex.GetTree().GetProxyCount(), spatialIndex.GetTree().GetHeight());
+			ImGui::Text("Textures streaming: %d", TextureStreamer::GetPendingCount());
+			ImGui::Text("Render target allocations: %d", Framebuffer::GetAllocationCount());
+			ImGui::Text("Assets cached: %d meshes, %d textures, %d shaders (%d meshes tracked)", AssetCache::GetMeshCount(), AssetCache::GetTextureCount(),
+				AssetCache::GetShaderCount(), MeshCache::GetMeshCount());
+			if (ImGui::Button("Evict Unused Assets")) {
+				AssetCache::EvictUnused();
+			}
 			});
 
 		#pragma endregion 
@@ -151,27 +324,27 @@ int main() {
 
 		#pragma region TEXTURE LOADING
 
-		// Load some textures from files
-		Texture2D::sptr stone = Texture2D::LoadFromFile("images/stone.jpg");
-		Texture2D::sptr stoneBump = Texture2D::LoadFromFile("images/stone_bump.jpg");
-		Texture2D::sptr stoneSpec = Texture2D::LoadFromFile("images/Stone_001_Specular.png");
-		Texture2D::sptr grass = Texture2D::LoadFromFile("images/grass.jpg");
-		Texture2D::sptr noSpec = Texture2D::LoadFromFile("images/grassSpec.png");
-		Texture2D::sptr box = Texture2D::LoadFromFile("images/box.bmp");
-		Texture2D::sptr boxSpec = Texture2D::LoadFromFile("images/box-reflections.bmp");
-		Texture2D::sptr simpleFlora = Texture2D::LoadFromFile("images/SimpleFlora.png");
-		Texture2D::sptr snowSpec = Texture2D::LoadFromFile("images/snow.jpg");
-		Texture2D::sptr snowSpec_spec = Texture2D::LoadFromFile("images/snow_spec.jpg");
-		Texture2D::sptr flowerSpec = Texture2D::LoadFromFile("images/flower_texture.png");
-		Texture2D::sptr mooshSpec = Texture2D::LoadFromFile("images/mushroom_texture.png");
-		Texture2D::sptr grassLeafSpec = Texture2D::LoadFromFile("images/grass_leaf.png");
-		Texture2D::sptr bushSpec = Texture2D::LoadFromFile("images/bush.png");
-
-
 		// Load the cube map
 		//TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/sample.jpg");
 		TextureCubeMap::sptr environmentMap = TextureCubeMap::LoadFromImages("images/cubemaps/skybox/ToonSky.jpg"); 
 
+		// Stream our textures in, these are placeholders until they've been decoded and uploaded
+		// (run with --bake-textures once to have them load pre-compressed instead)
+		Texture2D::sptr stone = AssetCache::GetTexture("images/stone.jpg");
+		Texture2D::sptr stoneBump = AssetCache::GetTexture("images/stone_bump.jpg");
+		Texture2D::sptr stoneSpec = AssetCache::GetTexture("images/Stone_001_Specular.png");
+		Texture2D::sptr grass = AssetCache::GetTexture("images/grass.jpg");
+		Texture2D::sptr noSpec = AssetCache::GetTexture("images/grassSpec.png");
+		Texture2D::sptr box = AssetCache::GetTexture("images/box.bmp");
+		Texture2D::sptr boxSpec = AssetCache::GetTexture("images/box-reflections.bmp");
+		Texture2D::sptr simpleFlora = AssetCache::GetTexture("images/SimpleFlora.png");
+		Texture2D::sptr snowSpec = AssetCache::GetTexture("images/snow.jpg");
+		Texture2D::sptr snowSpec_spec = AssetCache::GetTexture("images/snow_spec.jpg");
+		Texture2D::sptr flowerSpec = AssetCache::GetTexture("images/flower_texture.png");
+		Texture2D::sptr mooshSpec = AssetCache::GetTexture("images/mushroom_texture.png");
+		Texture2D::sptr grassLeafSpec = AssetCache::GetTexture("images/grass_leaf.png");
+		Texture2D::sptr bushSpec = AssetCache::GetTexture("images/bush.png");
+
 		// Creating an empty texture
 		Texture2DDescription desc = Texture2DDescription();  
 		desc.Width = 1;
@@ -195,9 +368,8 @@ int main() {
 		GameScene::sptr scene = GameScene::Create("test");
 		Application::Instance().ActiveScene = scene;
 
-		// We can create a group ahead of time to make iterating on the group faster
-		entt::basic_group<entt::entity, entt::exclude_t<>, entt::get_t<Transform>, RendererComponent> renderGroup =
-			scene->Registry().group<RendererComponent>(entt::get_t<Transform>());
+		// Start tracking the scene's renderers
+		renderer.Init(scene->Registry());
 
 		// Create a material and set some properties for it
 		ShaderMaterial::sptr stoneMat = ShaderMaterial::Create();  
@@ -265,14 +437,15 @@ int main() {
 
 		GameObject obj1 = scene->CreateEntity("Ground"); 
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/plane.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/plane.obj");
 			obj1.emplace<RendererComponent>().SetMesh(vao).SetMaterial(grassMat);
 			obj1.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
+			TransformSystem::MarkStatic(scene->Registry(), obj1.entity());
 		}
 
 		GameObject obj2 = scene->CreateEntity("tombstone");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/tombstone.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/tombstone.obj");
 			obj2.emplace<RendererComponent>().SetMesh(vao).SetMaterial(stoneMat);
 			obj2.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			obj2.get<Transform>().SetLocalRotation(90.0f, 0.0f, -90.0f);
@@ -281,48 +454,52 @@ int main() {
 
 		GameObject obj3 = scene->CreateEntity("arm");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Hand_L.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/Hand_L.obj");
 			obj3.emplace<RendererComponent>().SetMesh(vao).SetMaterial(snowMat);
 			obj3.get<Transform>().SetLocalPosition(0.0f, 0.0f, -0.5f);
 			obj3.get<Transform>().SetLocalRotation(180.0f, 0.0f, 30.0f);
 			obj3.get<Transform>().SetLocalScale(glm::vec3(3.0f));
+			TransformSystem::MarkStatic(scene->Registry(), obj3.entity());
 			//BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj3);
 		}
 
 		GameObject obj4 = scene->CreateEntity("rib");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/ribs.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/ribs.obj");
 			obj4.emplace<RendererComponent>().SetMesh(vao).SetMaterial(snowMat);
 			obj4.get<Transform>().SetLocalPosition(-5.0f, 15.0f, -0.5f);
 			obj4.get<Transform>().SetLocalRotation(180.0f, -20.0f, 30.0f);
 			obj4.get<Transform>().SetLocalScale(glm::vec3(2.0f));
+			TransformSystem::MarkStatic(scene->Registry(), obj4.entity());
 			//BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj3);
 		}
 
 		GameObject obj5 = scene->CreateEntity("skull");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/skull.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/skull.obj");
 			obj5.emplace<RendererComponent>().SetMesh(vao).SetMaterial(snowMat);
 			obj5.get<Transform>().SetLocalPosition(-5.0f, 15.0f, -0.5f);
 			obj5.get<Transform>().SetLocalRotation(180.0f, 20.0f, 30.0f);
 			obj5.get<Transform>().SetLocalScale(glm::vec3(2.0f));
+			TransformSystem::MarkStatic(scene->Registry(), obj5.entity());
 			//BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj3);
 		}
 
 		GameObject obj6 = scene->CreateEntity("skullTombstone");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/skull.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/skull.obj");
 			obj6.emplace<RendererComponent>().SetMesh(vao).SetMaterial(snowMat);
 			obj6.get<Transform>().SetLocalPosition(-2.0f, 2.7f, -2.5f);
 			obj6.get<Transform>().SetLocalRotation(500.0f, 0.0f, 30.0f);
 			obj6.get<Transform>().SetLocalScale(glm::vec3(1.0f));
+			TransformSystem::MarkStatic(scene->Registry(), obj6.entity());
 			//BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj3);
 		}
 
 		//Animated Skeleton
 		GameObject obj7 = scene->CreateEntity("skeleton");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/skelleton_final.obj");
+			VertexArrayObject::sptr vao = AssetCache::GetMesh("models/skelleton_final.obj");
 			obj7.emplace<RendererComponent>().SetMesh(vao).SetMaterial(snowMat);
 			obj7.get<Transform>().SetLocalPosition(0.0f, -10.0f, 0.0f);
 			obj7.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
@@ -350,16 +527,24 @@ int main() {
 		glm::vec2 spawnFromHere = glm::vec2(-18.0f, -18.0f);
 		glm::vec2 spawnToHere = glm::vec2(18.0f, 18.0f);
 
-		EnvironmentGenerator::AddObjectToGeneration("models/grass.obj", grassleafMat, 200,
-			spawnFromHere, spawnToHere, allAvoidAreasFrom, allAvoidAreasTo);
-		EnvironmentGenerator::AddObjectToGeneration("models/mushroom.obj", mooshMat, 50,
-			spawnFromHere, spawnToHere, allAvoidAreasFrom, allAvoidAreasTo);
+		// Bigger things go first so the small stuff fills in around them
+		EnvironmentGenerator::AddObjectToGeneration("models/bush.obj", bushMat, 3,
+			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo, 2.0f);
 		EnvironmentGenerator::AddObjectToGeneration("models/simpleRock.obj", simpleFloraMat, 10,
-			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo);
+			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo, 1.5f);
 		EnvironmentGenerator::AddObjectToGeneration("models/flower.obj", flowerMat, 10,
-			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo);
-		EnvironmentGenerator::AddObjectToGeneration("models/bush.obj", bushMat, 3,
-			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo);
+			spawnFromHere, spawnToHere, rockAvoidAreasFrom, rockAvoidAreasTo, 0.5f);
+		EnvironmentGenerator::AddObjectToGeneration("models/mushroom.obj", mooshMat, 50,
+			spawnFromHere, spawnToHere, allAvoidAreasFrom, allAvoidAreasTo, 0.5f);
+		EnvironmentGenerator::AddObjectToGeneration("models/grass.obj", grassleafMat, 200,
+			spawnFromHere, spawnToHere, allAvoidAreasFrom, allAvoidAreasTo, 0.25f);
+		// Simplified meshes further out (sizes are how much of the screen's height they cover), the foliage stops drawing past the last one
+		EnvironmentGenerator::SetObjectLODs("models/bush.obj", { 0.1f, 0.04f, 0.015f, 0.0f });
+		EnvironmentGenerator::SetObjectLODs("models/simpleRock.obj", { 0.06f, 0.02f, 0.0f });
+		EnvironmentGenerator::SetObjectLODs("models/flower.obj", { 0.08f, 0.03f, 0.01f, 0.003f });
+		EnvironmentGenerator::SetObjectLODs("models/mushroom.obj", { 0.08f, 0.03f, 0.01f, 0.003f });
+		EnvironmentGenerator::SetObjectLODs("models/grass.obj", { 0.08f, 0.03f, 0.01f, 0.005f });
+		EnvironmentGenerator::SetSeed(Random::ThreadLocal().Next());
 		EnvironmentGenerator::GenerateEnvironment();
 
 		// Create an object to be our camera
@@ -394,10 +579,7 @@ int main() {
 		/////////////////////////////////// SKYBOX ///////////////////////////////////////////////
 		{
 			// Load our shaders
-			Shader::sptr skybox = std::make_shared<Shader>();
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.vert.glsl", GL_VERTEX_SHADER);
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.frag.glsl", GL_FRAGMENT_SHADER);
-			skybox->Link();
+			Shader::sptr skybox = AssetCache::GetShader("shaders/skybox-shader.vert.glsl", "shaders/skybox-shader.frag.glsl");
 
 			ShaderMaterial::sptr skyboxMat = ShaderMaterial::Create();
 			skyboxMat->Shader = skybox;  
@@ -413,6 +595,7 @@ int main() {
 			GameObject skyboxObj = scene->CreateEntity("skybox");  
 			skyboxObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			skyboxObj.get_or_emplace<RendererComponent>().SetMesh(meshVao).SetMaterial(skyboxMat);
+			TransformSystem::MarkStatic(scene->Registry(), skyboxObj.entity());
 		}
 		////////////////////////////////////////////////////////////////////////////////////////
 
@@ -454,15 +637,15 @@ int main() {
 			{
 
 				if (lighton) {
-					shader->SetUniform("u_LightPos", glm::vec3(0, 0, -1000));
-					shader->SetUniform("u_LightAttenuationLinear", float(0.019));
-					shader->SetUniform("u_LightAttenuationQuadratic", float(0.5));
+					setLighting("u_LightPos", glm::vec3(0, 0, -1000));
+					setLighting("u_LightAttenuationLinear", float(0.019));
+					setLighting("u_LightAttenuationQuadratic", float(0.5));
 					lighton = false;
 				}
 				else {
-					shader->SetUniform("u_LightPos", glm::vec3(0, 0, 10));
-					shader->SetUniform("u_LightAttenuationLinear", float(0.0));
-					shader->SetUniform("u_LightAttenuationQuadratic", float(0.0));
+					setLighting("u_LightPos", glm::vec3(0, 0, 10));
+					setLighting("u_LightAttenuationLinear", float(0.0));
+					setLighting("u_LightAttenuationQuadratic", float(0.0));
 					lighton = true;
 				}
 			});
@@ -473,15 +656,15 @@ int main() {
 				if (lightAmbientPow > 0) {
 					lightAmbientPow = 0;
 					lightSpecularPow = 0;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 			
 				}
 				else {
 					lightAmbientPow = 1;
 					lightSpecularPow = 0;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 					
 				}
 			});
@@ -492,14 +675,14 @@ int main() {
 				if (lightSpecularPow > 0) {
 					lightAmbientPow = 0;
 					lightSpecularPow = 0;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 				}
 				else {
 					lightAmbientPow = 0;
 					lightSpecularPow = 1;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 				}
 			});
 
@@ -509,14 +692,14 @@ int main() {
 				if (lightSpecularPow > 0) {
 					lightAmbientPow = 0;
 					lightSpecularPow = 0;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 				}
 				else {
 					lightAmbientPow = 1;
 					lightSpecularPow = 1;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
 				}
 			});
 
@@ -527,18 +710,18 @@ int main() {
 					lightAmbientPow = 0;
 					lightSpecularPow = 0;
 					diffuse = 0;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-					shader->SetUniform("u_toonShading", diffuse);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_toonShading", diffuse);
 
 				}
 				else {
 					lightAmbientPow = 1;
 					lightSpecularPow = 1;
 					diffuse = 1;
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-					shader->SetUniform("u_toonShading", diffuse);
+					setLighting("u_AmbientLightStrength", lightAmbientPow);
+					setLighting("u_SpecularLightStrength", lightSpecularPow);
+					setLighting("u_toonShading", diffuse);
 				}
 			});
 		}
@@ -550,6 +733,9 @@ int main() {
 		///// Game loop /////
 		while (!glfwWindowShouldClose(BackendHandler::window)) {
 			glfwPollEvents();
+			// Resize once for however many resize events came in
+			BackendHandler::ApplyPendingResize();
+			Profiler::BeginFrame();
 
 			// Update the timing
 			time.CurrentFrame = glfwGetTime();
@@ -563,6 +749,7 @@ int main() {
 			if (frameIx >= 128)
 				frameIx = 0;
 
+			Profiler::BeginScope("Behaviours");
 			// We'll make sure our UI isn't focused before we start handling input for our game
 			if (!ImGui::IsAnyWindowFocused()) {
 				// We need to poll our key watchers so they can do their logic with the GLFW state
@@ -582,101 +769,48 @@ int main() {
 					}
 				}
 			});
+			Profiler::EndScope();
 
-			// Clear the screen
-			testBuffer->Clear();
-
-			glClearColor(0.08f, 0.17f, 0.31f, 1.0f);
-			glEnable(GL_DEPTH_TEST);
-			glClearDepth(1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-			// Update all world matrices for this frame
-			scene->Registry().view<Transform>().each([](entt::entity entity, Transform& t) {
-				t.UpdateWorldMatrix();
-			});
-			
-			// Grab out camera info from the camera object
-			Transform& camTransform = cameraObject.get<Transform>();
-			glm::mat4 view = glm::inverse(camTransform.LocalTransform());
-			glm::mat4 projection = cameraObject.get<Camera>().GetProjection();
-			glm::mat4 viewProjection = projection * view;
-				
-
-			//Adding rotations to transformation animation
-			/*
-			if(obj7.get<Transform>().GetLocalPosition().y< -3.6&& obj7.get<Transform>().GetLocalPosition().y)
-			{
-				obj7.get<Transform>().SetLocalRotation(0.0f, 0.0f, 90.0f);
-			}
-
-			std::cout << obj7.get<Transform>().GetLocalPosition().x << std::endl;
-			std::cout << obj7.get<Transform>().GetLocalPosition().y << std::endl;
-			std::cout << obj7.get<Transform>().GetLocalPosition().z << std::endl;
-			std::cout << std::endl;
-
-			*/
-
-			// Sort the renderers by shader and material, we will go for a minimizing context switches approach here,
-			// but you could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
-			renderGroup.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
-				// Sort by render layer first, higher numbers get drawn last
-				if (l.Material->RenderLayer < r.Material->RenderLayer) return true;
-				if (l.Material->RenderLayer > r.Material->RenderLayer) return false;
-
-				// Sort by shader pointer next (so materials using the same shader run sequentially where possible)
-				if (l.Material->Shader < r.Material->Shader) return true;
-				if (l.Material->Shader > r.Material->Shader) return false;
-
-				// Sort by material pointer last (so we can minimize switching between materials)
-				if (l.Material < r.Material) return true;
-				if (l.Material > r.Material) return false;
-				
-				return false;
-			});
-
-			// Start by assuming no shader or material is applied
-			Shader::sptr current = nullptr;
-			ShaderMaterial::sptr currentMat = nullptr;
-
-			testBuffer->Bind();
-
-			// Iterate over the render group components and draw them
-			renderGroup.each( [&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// If the shader has changed, set up it's uniforms
-				if (current != renderer.Material->Shader) {
-					current = renderer.Material->Shader;
-					current->Bind();
-					BackendHandler::SetupShaderForFrame(current, view, projection);
-				}
-				// If the material has changed, apply it
-				if (currentMat != renderer.Material) {
-					currentMat = renderer.Material;
-					currentMat->Apply();
-				}
-				// Render the mesh
-				BackendHandler::RenderVAO(renderer.Material->Shader, renderer.Mesh, viewProjection, transform);
-			});
-
-			testBuffer->Unbind();
-
-			testBuffer->DrawToBackbuffer();
+			// Draw the scene into our buffer, then run the post effects and put the result on the screen
+			renderer.Render(cameraObject.entity(), *testBuffer);
 
 			// Draw our ImGui content
+			Profiler::BeginScope("ImGui");
+			Profiler::BeginGPU("ImGui");
 			BackendHandler::RenderImGui();
+			Profiler::EndGPU();
+			Profiler::EndScope();
 
 			scene->Poll();
+			Profiler::BeginScope("Swap");
 			glfwSwapBuffers(BackendHandler::window);
+			Profiler::EndScope();
+			Profiler::EndFrame();
 			time.LastFrame = time.CurrentFrame;
 		}
 
+		// Stop listening to the scene before it goes away (and free the post effect targets and shaders)
+		renderer.Unload();
 		// Nullify scene so that we can release references
 		Application::Instance().ActiveScene = nullptr;
 		//Clean up the environment generator so we can release references
 		EnvironmentGenerator::CleanUpPointers();
+		//Unmap and free the transform stream
+		TransformStream::Unload();
+		//Let go of the cached meshes, textures and shaders
+		AssetCache::Clear();
+		//Forget the bounds and buffers kept for every mesh we loaded
+		MeshCache::Clear();
+		//Drop any textures that are still streaming
+		TextureStreamer::Unload();
+		//Delete the profiler's queries
+		Profiler::Unload();
 		BackendHandler::ShutdownImGui();
 	}	
 
+	// Stop our worker threads
+	JobSystem::Shutdown();
+
 	// Clean up the toolkit logger so we don't leak memory
 	Logger::Uninitialize();
 	return 0;